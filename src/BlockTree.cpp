@@ -0,0 +1,399 @@
+#include "BlockTree.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    // Minimum of a range without any keywords
+    constexpr int NONE = std::numeric_limits<int>::max() / 2;
+}
+
+BlockTree::Node BlockTree::Combine(Node const& lhs, Node const& rhs)
+{
+    Node node;
+    node.sum = lhs.sum + rhs.sum;
+    node.min = rhs.min == NONE ? lhs.min : std::min(lhs.min, lhs.sum + rhs.min);
+    return node;
+}
+
+BlockTree::Node BlockTree::Leaf(int line_idx) const
+{
+    Node node = { 0, NONE };
+    for (BlockEdge const& edge : entries[line_idx].edges)
+    {
+        node.sum += edge.open ? 1 : -1;
+        node.min = std::min(node.min, node.sum);
+    }
+    return node;
+}
+
+void BlockTree::UpdateLeaf(int line_idx)
+{
+    int idx = leaf_count + line_idx;
+
+    nodes[idx] = Leaf(line_idx);
+    for (idx /= 2; idx > 0; idx /= 2)
+    {
+        nodes[idx] = Combine(nodes[idx * 2], nodes[idx * 2 + 1]);
+    }
+}
+
+void BlockTree::Build()
+{
+    leaf_count = 1;
+    while (leaf_count < entries.size()) leaf_count *= 2;
+
+    nodes.assign(leaf_count * 2, { 0, NONE });
+
+    for (int line_idx = 0; line_idx < entries.size(); line_idx++)
+    {
+        nodes[leaf_count + line_idx] = Leaf(line_idx);
+    }
+
+    for (int idx = leaf_count - 1; idx > 0; idx--)
+    {
+        nodes[idx] = Combine(nodes[idx * 2], nodes[idx * 2 + 1]);
+    }
+
+    stale = false;
+}
+
+int BlockTree::Prefix(int line_idx) const
+{
+    int depth = 0;
+    for (int idx = leaf_count + line_idx; idx > 1; idx /= 2)
+    {
+        if (idx & 1) depth += nodes[idx - 1].sum;
+    }
+    return depth;
+}
+
+int BlockTree::DepthBefore(int line_idx, int edge_idx) const
+{
+    int depth = Prefix(line_idx);
+
+    Vector<BlockEdge> const& edges = entries[line_idx].edges;
+    for (int idx = 0; idx < edge_idx; idx++)
+    {
+        depth += edges[idx].open ? 1 : -1;
+    }
+    return depth;
+}
+
+int BlockTree::FindFirst(int node, int lo, int hi, int base, int from, int threshold) const
+{
+    // Nodes reaching no lower than the threshold can be skipped, even the ones only partly after from
+    if (hi <= from || base + nodes[node].min > threshold) return -1;
+    if (hi - lo == 1) return lo;
+
+    int mid = (lo + hi) / 2;
+
+    int line_idx = FindFirst(node * 2, lo, mid, base, from, threshold);
+    if (line_idx != -1) return line_idx;
+
+    return FindFirst(node * 2 + 1, mid, hi, base + nodes[node * 2].sum, from, threshold);
+}
+
+int BlockTree::FindLast(int node, int lo, int hi, int base, int limit, int threshold) const
+{
+    if (lo >= limit || base + nodes[node].min > threshold) return -1;
+    if (hi - lo == 1) return lo;
+
+    int mid = (lo + hi) / 2;
+
+    int line_idx = FindLast(node * 2 + 1, mid, hi, base + nodes[node * 2].sum, limit, threshold);
+    if (line_idx != -1) return line_idx;
+
+    return FindLast(node * 2, lo, mid, base, limit, threshold);
+}
+
+BlockKeyword BlockTree::Keyword(int line_idx, int edge_idx) const
+{
+    BlockEdge const& edge = entries[line_idx].edges[edge_idx];
+
+    BlockKeyword keyword;
+    keyword.pos = { line_idx, edge.x };
+    keyword.size = edge.size;
+    keyword.kind = edge.kind;
+    return keyword;
+}
+
+bool BlockTree::FindClose(int line_idx, int edge_idx, int & close_line, int & close_edge) const
+{
+    // The block ends at the first keyword after the opening one that goes back to the depth before it
+    int target = DepthBefore(line_idx, edge_idx);
+    int depth = target + 1;
+
+    Vector<BlockEdge> const& edges = entries[line_idx].edges;
+    for (int idx = edge_idx + 1; idx < edges.size(); idx++)
+    {
+        depth += edges[idx].open ? 1 : -1;
+        if (depth == target)
+        {
+            close_line = line_idx;
+            close_edge = idx;
+            return true;
+        }
+    }
+
+    close_line = FindFirst(1, 0, leaf_count, 0, line_idx + 1, target);
+    if (close_line == -1) return false;
+
+    depth = Prefix(close_line);
+
+    Vector<BlockEdge> const& close_edges = entries[close_line].edges;
+    for (int idx = 0; idx < close_edges.size(); idx++)
+    {
+        depth += close_edges[idx].open ? 1 : -1;
+        if (depth == target)
+        {
+            close_edge = idx;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool BlockTree::FindOpen(int line_idx, int edge_idx, int & open_line, int & open_edge) const
+{
+    int depth = DepthBefore(line_idx, edge_idx);
+    if (depth <= 0) return false;
+
+    // The block starts right after the last keyword before the point that leaves one less block open
+    int target = depth - 1;
+
+    int after_line = -1;
+    int after_edge = -1;
+
+    Vector<BlockEdge> const& edges = entries[line_idx].edges;
+    for (int idx = edge_idx - 1; idx >= 0; idx--)
+    {
+        depth -= edges[idx].open ? 1 : -1;
+        if (depth == target)
+        {
+            // Depth before this keyword is the target, so it is the one opening the block
+            open_line = line_idx;
+            open_edge = idx;
+            return true;
+        }
+    }
+
+    after_line = FindLast(1, 0, leaf_count, 0, line_idx, target);
+    if (after_line != -1)
+    {
+        depth = Prefix(after_line);
+
+        Vector<BlockEdge> const& after_edges = entries[after_line].edges;
+        for (int idx = 0; idx < after_edges.size(); idx++)
+        {
+            depth += after_edges[idx].open ? 1 : -1;
+            if (depth <= target) after_edge = idx;
+        }
+
+        if (after_edge + 1 < after_edges.size())
+        {
+            open_line = after_line;
+            open_edge = after_edge + 1;
+            return true;
+        }
+    }
+
+    // Lines without keywords have a minimum that never passes the threshold below, so this finds the next line with any
+    open_line = FindFirst(1, 0, leaf_count, 0, after_line + 1, NONE / 2);
+    if (open_line == -1 || open_line >= line_idx) return false;
+
+    open_edge = 0;
+    return true;
+}
+
+int BlockTree::EdgeIndex(Position pos) const
+{
+    Vector<BlockEdge> const& edges = entries[pos.y].edges;
+
+    int idx = 0;
+    while (idx < edges.size() && edges[idx].x < pos.x) idx++;
+    return idx;
+}
+
+void BlockTree::Reset(int line_count)
+{
+    entries.clear();
+    entries.resize(line_count);
+
+    first_invalid = 0;
+    invalid_count = line_count;
+
+    stale = true;
+}
+
+void BlockTree::Insert(int line_idx, int count)
+{
+    entries.insert(line_idx, Entry(), count);
+
+    first_invalid = std::min(first_invalid, line_idx);
+    invalid_count += count;
+
+    stale = true;
+}
+
+void BlockTree::Remove(int line_idx, int count)
+{
+    for (int idx = line_idx; idx < line_idx + count; idx++)
+    {
+        if (!entries[idx].valid) invalid_count--;
+    }
+
+    entries.remove(line_idx, count);
+
+    // The line after the removed ones may start in a different state now
+    if (line_idx < entries.size()) Invalidate(line_idx);
+
+    first_invalid = std::min(first_invalid, line_idx);
+
+    stale = true;
+}
+
+void BlockTree::Invalidate(int line_idx)
+{
+    Entry & entry = entries[line_idx];
+    if (entry.valid)
+    {
+        entry.valid = false;
+        invalid_count++;
+    }
+
+    first_invalid = std::min(first_invalid, line_idx);
+}
+
+void BlockTree::Update(Vector<String32> const& lines, Lexer & lexer)
+{
+    // A few leaves are updated in place, past that the whole tree is rebuilt once
+    int budget = std::max(64, entries.size() / 64);
+
+    for (int line_idx = first_invalid; line_idx < entries.size() && invalid_count > 0; line_idx++)
+    {
+        Entry & entry = entries[line_idx];
+        if (entry.valid) continue;
+
+        int state = line_idx == 0 ? 0 : entries[line_idx - 1].state;
+
+        entry.edges.clear();
+        state = lexer.ScanBlocks(lines[line_idx], state, entry.edges);
+
+        if (state != entry.state && line_idx + 1 < entries.size()) Invalidate(line_idx + 1);
+
+        entry.state = state;
+        entry.valid = true;
+        invalid_count--;
+
+        if (!stale && budget-- > 0) UpdateLeaf(line_idx);
+        else                        stale = true;
+    }
+
+    first_invalid = entries.size();
+
+    if (stale) Build();
+}
+
+Vector<BlockEdge> const& BlockTree::Edges(int line_idx) const
+{
+    return entries[line_idx].edges;
+}
+
+int BlockTree::Depth(Position pos) const
+{
+    return DepthBefore(pos.y, EdgeIndex(pos));
+}
+
+bool BlockTree::Enclosing(Position pos, BlockKeyword & open, BlockKeyword & close) const
+{
+    int open_line, open_edge;
+    if (!FindOpen(pos.y, EdgeIndex(pos), open_line, open_edge)) return false;
+
+    int close_line, close_edge;
+    if (!FindClose(open_line, open_edge, close_line, close_edge)) return false;
+
+    // Depth alone pairs keywords up, a block missing its end is matched with the wrong one
+    if (entries[open_line].edges[open_edge].type != entries[close_line].edges[close_edge].type) return false;
+
+    open = Keyword(open_line, open_edge);
+    close = Keyword(close_line, close_edge);
+    return true;
+}
+
+bool BlockTree::Matching(Position pos, BlockKeyword & open, BlockKeyword & close) const
+{
+    Vector<BlockEdge> const& edges = entries[pos.y].edges;
+
+    int edge_idx = 0;
+    while (edge_idx < edges.size() && edges[edge_idx].x + edges[edge_idx].size < pos.x) edge_idx++;
+
+    if (edge_idx == edges.size() || edges[edge_idx].x > pos.x) return false;
+
+    int open_line = pos.y, open_edge = edge_idx;
+    int close_line = pos.y, close_edge = edge_idx;
+
+    if (edges[edge_idx].open)
+    {
+        if (!FindClose(open_line, open_edge, close_line, close_edge)) return false;
+    }
+    else
+    {
+        if (!FindOpen(close_line, close_edge, open_line, open_edge)) return false;
+    }
+
+    if (entries[open_line].edges[open_edge].type != entries[close_line].edges[close_edge].type) return false;
+
+    open = Keyword(open_line, open_edge);
+    close = Keyword(close_line, close_edge);
+    return true;
+}
+
+Vector<Block> BlockTree::Blocks() const
+{
+    struct OpenBlock
+    {
+        int type;
+        int line;
+    };
+
+    Vector<OpenBlock> open_blocks;
+    Vector<Block> blocks;
+
+    for (int line_idx = 0; line_idx < entries.size(); line_idx++)
+    {
+        for (BlockEdge const& edge : entries[line_idx].edges)
+        {
+            if (edge.open)
+            {
+                open_blocks.push_back({ edge.type, line_idx });
+                continue;
+            }
+
+            // Blocks left open inside this one are dropped, the rest of the file still matches up
+            for (int idx = open_blocks.size() - 1; idx >= 0; idx--)
+            {
+                if (open_blocks[idx].type != edge.type) continue;
+
+                if (open_blocks[idx].line != line_idx)
+                {
+                    Block block;
+                    block.first = open_blocks[idx].line;
+                    block.last = line_idx;
+                    block.kind = edge.kind;
+                    blocks.push_back(block);
+                }
+
+                open_blocks.resize(idx);
+                break;
+            }
+        }
+    }
+
+    // They are found in the order they end
+    std::sort(blocks.begin(), blocks.end(), [](Block const& lhs, Block const& rhs) { return lhs.first < rhs.first; });
+
+    return blocks;
+}
@@ -0,0 +1,100 @@
+#ifndef BLOCKTREE_HPP
+#define BLOCKTREE_HPP
+
+#include "String32.hpp"
+#include "Vector.hpp"
+
+#include "Cursor.hpp"
+#include "Lexer.hpp"
+
+// A block keyword and the line it is on
+struct BlockKeyword
+{
+    Position pos;
+    int size;
+    int kind;
+};
+
+// Block keywords per line, kept parallel to the lines of a buffer and rescanned only after they are invalidated.
+// A segment tree over the nesting depth they add up to finds matching keywords in O(log n).
+class BlockTree
+{
+private:
+    struct Entry
+    {
+        Vector<BlockEdge> edges;
+
+        // What the lexer ended the line in, -1 before the line is first scanned
+        int state = -1;
+        bool valid = false;
+    };
+
+    // Depth change over a range of lines and the lowest depth reached after any keyword in it
+    struct Node
+    {
+        int sum;
+        int min;
+    };
+
+    Vector<Entry> entries;
+    Vector<Node> nodes;
+
+    int leaf_count = 1;
+
+    int first_invalid = 0;
+    int invalid_count = 0;
+
+    // Lines were added or removed since the tree was built
+    bool stale = true;
+
+    static Node Combine(Node const& lhs, Node const& rhs);
+
+    Node Leaf(int line_idx) const;
+    void UpdateLeaf(int line_idx);
+    void Build();
+
+    int Prefix(int line_idx) const;
+    int DepthBefore(int line_idx, int edge_idx) const;
+
+    // First line at or after from, or last one before limit, whose keywords reach the threshold depth
+    int FindFirst(int node, int lo, int hi, int base, int from, int threshold) const;
+    int FindLast(int node, int lo, int hi, int base, int limit, int threshold) const;
+
+    BlockKeyword Keyword(int line_idx, int edge_idx) const;
+
+    // The keyword closing the block opened by the given one, and the one opening the block around a point
+    bool FindClose(int line_idx, int edge_idx, int & close_line, int & close_edge) const;
+    bool FindOpen(int line_idx, int edge_idx, int & open_line, int & open_edge) const;
+
+    // How many keywords of the line are before x
+    int EdgeIndex(Position pos) const;
+
+public:
+    BlockTree() = default;
+
+    void Reset(int line_count);
+
+    void Insert(int line_idx, int count);
+    void Remove(int line_idx, int count);
+
+    void Invalidate(int line_idx);
+
+    // Rescans changed lines, and the ones after them for as long as the state they start in changes
+    void Update(Vector<String32> const& lines, Lexer & lexer);
+
+    Vector<BlockEdge> const& Edges(int line_idx) const;
+
+    // How many blocks are open at the position
+    int Depth(Position pos) const;
+
+    // The innermost block around the position, keywords at the position itself are outside of it
+    bool Enclosing(Position pos, BlockKeyword & open, BlockKeyword & close) const;
+
+    // The keyword touching the position and the one it is matched with
+    bool Matching(Position pos, BlockKeyword & open, BlockKeyword & close) const;
+
+    // Every block, sorted by first line, keywords that don't match up are skipped
+    Vector<Block> Blocks() const;
+};
+
+#endif // BLOCKTREE_HPP
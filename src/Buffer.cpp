@@ -1,6 +1,8 @@
 #include "Buffer.hpp"
 
 #include <algorithm>
+#include <iterator>
+#include <limits>
 
 #include <QDebug>
 #include <QTime>
@@ -14,6 +16,7 @@
 #include "Theme.hpp"
 
 #include "SpecialCharacters.hpp"
+#include "ThreadPool.hpp"
 
 void Buffer::SetText(TextView const& text)
 {
@@ -25,11 +28,15 @@ void Buffer::SetText(TextView const& text)
 
     styles[0].push_back(STYLE_DEFAULT);
 
+    LinesReset();
+
     Cursor cursor = { {0, 0}, {0, 0} };
 
     cursors = { cursor };
     CursorReplaceText(text);
     cursors = { cursor };
+
+    InvalidateStyles(0);
 }
 
 Position Buffer::DeleteAdjustedPosition(Position start, Position stop, Position pos)
@@ -51,44 +58,128 @@ Position Buffer::NewlineAdjustedPosition(Position insertion_pos, Position pos)
     return pos;
 }
 
-void Buffer::PaintTextMargin(Painter & painter, int first_line)
+void Buffer::PaintTextMargin(Painter & painter, int first_row, int first_column)
 {
     QRect rect = painter.Rect();
 
-    painter.FillRect(rect, QColor(38, 50, 56));
+    Theme & theme = ThemeManager::Instance().CurrentTheme();
+
+    painter.FillRect(rect, theme.Color(COLOR_TEXT_BACKGROUND));
 
     int ch = CellSize().height();
     int cw = CellSize().width();
 
-    int max_cy = std::min(rect.height() / ch + first_line + 1, LineCount());
+    QRect dirty = painter.DirtyRect();
 
-    for (Cursor cursor : cursors)
+    int first_dirty_row = first_row + std::max(0, dirty.top() / ch);
+    int last_dirty_row  = std::min(first_row + dirty.bottom() / ch + 1, RowCount());
+
+    int first_dirty = LineAtRow(first_dirty_row);
+    int last_dirty  = first_dirty_row < last_dirty_row ? LineAtRow(last_dirty_row - 1) + 1 : first_dirty;
+
+    // Cursors are sorted and never overlap, so the ones touching the dirty lines are a contiguous range
+    auto cursor_pred = [](Cursor const& cursor, int line_idx) { return std::max(cursor.start, cursor.stop).y < line_idx; };
+    auto first_cursor = std::lower_bound(cursors.begin(), cursors.end(), first_dirty, cursor_pred);
+
+    struct CursorShape
     {
-        Position start = cursor.start;
-        Position stop  = cursor.stop;
+        Position start;
+        Position stop;
+        Position pointer;
+        int width;
+    };
+
+    Vector<CursorShape> shapes;
+    Vector<QRect> selection_rects;
+
+    // Selections next to each other are filled as one rect
+    auto add_selection_rect = [&selection_rects](QRect r)
+    {
+        if (r.isEmpty()) return;
+
+        if (!selection_rects.empty())
+        {
+            QRect & last = selection_rects.back();
+
+            if (last.top() == r.top() && last.height() == r.height() && last.right() + 1 >= r.left())
+            {
+                last.setRight(std::max(last.right(), r.right()));
+                return;
+            }
+
+            if (last.left() == r.left() && last.width() == r.width() && last.bottom() + 1 == r.top())
+            {
+                last.setBottom(r.bottom());
+                return;
+            }
+        }
+
+        selection_rects.push_back(r);
+    };
+
+    for (auto it = first_cursor; it != cursors.end(); ++it)
+    {
+        Position start = it->start;
+        Position stop  = it->stop;
+
+        if (std::min(start, stop).y >= last_dirty) break;
 
         start.x = std::min(start.x, LineLength(start.y));
         stop.x  = std::min(stop.x, LineLength(stop.y));
 
         char32_t chr = CharacterAt(stop);
 
-        StringView32 start_line = lines[start.y];
-        StringView32 stop_line  = lines[stop.y];
+        CursorShape shape;
+
+        shape.width = 1;
+        if (chr == U'\t')
+        {
+            shape.width = TabWidth(ColumnAt(stop));
+        }
 
-        start.x = start_line.adjust_for_tabs(start.x);
-        stop.x  = stop_line.adjust_for_tabs(stop.x);
+        // From here on positions are rows and columns on screen, a wrapped line spans several rows
+        start = DisplayPosition(start);
+        stop  = DisplayPosition(stop);
 
-        start.y -= first_line;
-        stop.y  -= first_line;
+        start.x -= first_column;
+        stop.x  -= first_column;
 
-        if (stop.y < 0)        continue;
-        if (start.y >= max_cy) continue;
+        start.y -= first_row;
+        stop.y  -= first_row;
 
-        Position pointer = stop;
+        shape.pointer = stop;
 
         if (start > stop) std::swap(stop, start);
 
-        painter.SetPen(QColor(0, 0, 0));
+        shape.start = start;
+        shape.stop  = stop;
+
+        if (start.y == stop.y)
+        {
+            add_selection_rect(QRect(start.x * cw, start.y * ch, cw * (stop.x - start.x), ch));
+        }
+        else
+        {
+            int top_x = start.x * cw;
+            add_selection_rect(QRect(top_x, start.y * ch, rect.width() - top_x, ch));
+            add_selection_rect(QRect(0, (start.y + 1) * ch, rect.width(), (stop.y - start.y - 1) * ch));
+            add_selection_rect(QRect(0, stop.y * ch, std::max(0, stop.x * cw), ch));
+        }
+
+        shapes.push_back(shape);
+    }
+
+    for (QRect const& selection_rect : selection_rects)
+    {
+        painter.FillRect(selection_rect, theme.Color(COLOR_SELECTION));
+    }
+
+    painter.SetPen(theme.Pen(COLOR_SELECTION_BORDER));
+    for (CursorShape const& shape : shapes)
+    {
+        Position start = shape.start;
+        Position stop  = shape.stop;
+
         if (start.y == stop.y)
         {
             int x = start.x * cw;
@@ -96,7 +187,6 @@ void Buffer::PaintTextMargin(Painter & painter, int first_line)
             int w = cw * (stop.x - start.x);
             int h = ch;
             QRect selection_rect(x, y, w, h);
-            painter.FillRect(selection_rect, QColor(85, 85, 85));
             painter.DrawRect(selection_rect);
         }
         else
@@ -105,22 +195,15 @@ void Buffer::PaintTextMargin(Painter & painter, int first_line)
             int top_y = start.y * ch;
             int top_w = rect.width() - top_x;
             int top_h = ch;
-            QRect top_rect(top_x, top_y, top_w, top_h);
-            painter.FillRect(top_rect, QColor(85, 85, 85));
 
             int bottom_x = 0;
             int bottom_y = stop.y * ch;
-            int bottom_w = stop.x * cw;
+            int bottom_w = std::max(0, stop.x * cw);
             int bottom_h = ch;
-            QRect bottom_rect(bottom_x, bottom_y, bottom_w, bottom_h);
-            painter.FillRect(bottom_rect, QColor(85, 85, 85));
 
             int mid_x = 0;
             int mid_y = top_y + top_h;
             int mid_w = rect.width();
-            int mid_h = bottom_y - mid_y;
-            QRect mid_rect(mid_x, mid_y, mid_w, mid_h);
-            painter.FillRect(mid_rect, QColor(85, 85, 85));
 
             painter.DrawLine(top_x, top_y, top_w, 0);
             painter.DrawLine(top_x, top_y, 0, top_h);
@@ -131,86 +214,190 @@ void Buffer::PaintTextMargin(Painter & painter, int first_line)
             painter.DrawLine(mid_x, mid_y, top_x, 0);
             painter.DrawLine(bottom_w, bottom_y, mid_w - bottom_w, 0);
         }
+    }
 
-        int w = 1;
-        if (chr == U'\t')
+    painter.SetPen(theme.Pen(COLOR_CURSOR));
+    for (CursorShape const& shape : shapes)
+    {
+        QRect cursor_rect(shape.pointer.x * cw, shape.pointer.y * ch, shape.width * cw, ch);
+        painter.DrawRect(cursor_rect);
+    }
+
+    // Folded lines are underlined where the hidden ones would have been
+    painter.SetPen(theme.Pen(COLOR_SELECTION_BORDER));
+
+    auto fold_pred = [](LineRange const& range, int line_idx) { return range.first < line_idx; };
+    for (auto it = std::lower_bound(folds.begin(), folds.end(), first_dirty, fold_pred); it != folds.end() && it->first < last_dirty; ++it)
+    {
+        if (IsHidden(it->first)) continue;
+
+        int bottom = (RowOfLine(it->first) + rows.Rows(it->first) - first_row) * ch - 1;
+        painter.DrawLine(0, bottom, rect.width(), 0);
+    }
+
+    // The block keyword at the cursor and its match are outlined, unless an edit moved them since
+    for (BlockKeyword const& keyword : matched)
+    {
+        Position start = keyword.pos;
+        if (start.y < first_dirty || start.y >= last_dirty || IsHidden(start.y)) continue;
+        if (start.x + keyword.size > LineLength(start.y)) continue;
+
+        Position stop = DisplayPosition({ start.y, start.x + keyword.size });
+        start = DisplayPosition(start);
+
+        if (start.y != stop.y) continue;
+
+        painter.DrawRect(QRect((start.x - first_column) * cw, (start.y - first_row) * ch, (stop.x - start.x) * cw, ch));
+    }
+
+    // Diagnostics are underlined with a zigzag along the bottom of their row, at least a cell wide
+    painter.SetPen(theme.Pen(COLOR_ERROR));
+    for (Diagnostic const& diagnostic : Diagnostics(first_dirty, last_dirty - 1))
+    {
+        Position start = diagnostic.pos;
+        if (IsHidden(start.y)) continue;
+
+        int length = LineLength(start.y);
+        if (start.x > length) continue;
+
+        Position stop = DisplayPosition({ start.y, std::min(start.x + diagnostic.size, length) });
+        start = DisplayPosition(start);
+
+        int left = (start.x - first_column) * cw;
+        int right = start.y == stop.y ? (stop.x - first_column) * cw : rect.width();
+        right = std::max(right, left + cw);
+
+        int bottom = (start.y - first_row + 1) * ch - 1;
+        for (int x = left, step = 0; x < right; x += 2, step++)
         {
-            w = 4 - (pointer.x & 0b11);
+            if (step % 2 == 0) painter.DrawLine(x, bottom, 2, -2);
+            else               painter.DrawLine(x, bottom - 2, 2, 2);
         }
-
-        painter.SetPen(QColor(255, 204, 0));
-        QRect cursor_rect(pointer.x * cw, pointer.y * ch, w * cw, ch);
-        painter.DrawRect(cursor_rect);
     }
 
-    Theme & theme = ThemeManager::Instance().CurrentTheme();
+    struct GlyphRun
+    {
+        int style;
+        int x;
+        int y;
+        StringView32 text;
+    };
 
-    int style = STYLE_DEFAULT;
-    painter.SetPen(theme[style].forecolor);
+    // Runs are collected first and drawn grouped by style so every pen is set once per frame
+    Vector<GlyphRun> glyph_runs;
 
-    int max_x = rect.right();
+    int visible_columns = rect.width() / cw + 1;
 
-    for (int y = first_line; y < max_cy; y++)
+    for (int row = first_dirty_row; row < last_dirty_row; )
     {
+        int y = LineAtRow(row);
+        int line_row = RowOfLine(y);
+
         StringView32 line = lines[y];
 
-        int left = 0;
-        int top = (y - first_line) * ch;
+        int row_count = rows.Rows(y);
 
-        int length = LineLength(y);
+        int first_sub_row = row - line_row;
+        int last_sub_row  = std::min(row_count, last_dirty_row - line_row) - 1;
 
-        int total_padding = 0;
-        int last_x = 0;
-        for (int x = 0; x <= length; x++)
+        auto row_end = [&](int sub_row)
         {
-            int next_style = styles[y][x];
-            if (style != next_style || x == length || line[x] == U'\t')
-            {
-                if (line[last_x] == U'\t')
-                {
-                    int padding = TabWidth(left);
+            return sub_row + 1 < row_count ? wraps.RowStart(y, sub_row + 1) : line.size();
+        };
 
-                    left += padding - 1;
-                    total_padding += padding;
-                }
+        // Only the characters in the visible column window are walked, no matter how long the line is
+        int first = std::max(columns.Index(y, line, wraps.RowColumn(y, first_sub_row) + first_column), wraps.RowStart(y, first_sub_row));
+        int last  = std::min(columns.Index(y, line, wraps.RowColumn(y, last_sub_row) + first_column + visible_columns) + 1, row_end(last_sub_row));
 
-                style = next_style;
+        row = line_row + row_count;
+        if (first >= last) continue;
 
-                int size = x - last_x;
-                if (size != 0)
-                {
-                    StringView32 segment = line.middle_view(last_x, size);
-                    painter.DrawText(left * cw, top, size * cw, ch, segment);
+        int column = columns.Column(y, line, first);
 
-                    left += size;
+        // The runs of a line are cached as a whole and only split where the line wraps
+        int sub_row = first_sub_row;
+        for (TextRun const& run : text_runs.Runs(y, line, styles[y], first, last, column))
+        {
+            int offset = run.offset;
+            int size = run.size;
+            int run_column = run.column;
 
-                    last_x = x;
-                }
+            while (size != 0)
+            {
+                while (row_end(sub_row) <= offset) sub_row++;
 
-                painter.SetPen(theme[style].forecolor);
+                int count = std::min(size, row_end(sub_row) - offset);
+
+                GlyphRun glyph_run;
+                glyph_run.style = run.style;
+                glyph_run.x = (run_column - wraps.RowColumn(y, sub_row) - first_column) * cw;
+                glyph_run.y = (line_row + sub_row - first_row) * ch;
+                glyph_run.text = line.middle_view(offset, count);
+                glyph_runs.push_back(glyph_run);
+
+                offset += count;
+                size -= count;
+                run_column += count;
             }
         }
     }
+
+    auto style_pred = [](GlyphRun const& lhs, GlyphRun const& rhs) { return lhs.style < rhs.style; };
+    std::stable_sort(glyph_runs.begin(), glyph_runs.end(), style_pred);
+
+    int style = -1;
+    for (GlyphRun const& glyph_run : glyph_runs)
+    {
+        if (glyph_run.style != style)
+        {
+            style = glyph_run.style;
+            painter.SetPen(theme.Pen(style));
+        }
+
+        painter.DrawGlyphs(*atlas, glyph_run.x, glyph_run.y, glyph_run.text);
+    }
 }
 
-void Buffer::PaintLineNumberMargin(Painter & painter, int scroll)
+void Buffer::PaintLineNumberMargin(Painter & painter, int first_row)
 {
     QRect rect = painter.Rect();
 
-    painter.FillRect(rect, QColor(30, 42, 48));
-    painter.SetPen(QColor(191, 191, 191));
+    Theme & theme = ThemeManager::Instance().CurrentTheme();
+
+    painter.FillRect(rect, theme.Color(COLOR_MARGIN_BACKGROUND));
+    painter.SetPen(theme.Pen(COLOR_MARGIN_FOREGROUND));
 
     int height = CellSize().height();
     int width  = CellSize().width();
 
-    int last_line = std::min(rect.height() / height + scroll + 1, LineCount());
+    QRect dirty = painter.DirtyRect();
+
+    int first_dirty = first_row + std::max(0, dirty.top() / height);
+    int last_dirty  = std::min(first_row + dirty.bottom() / height + 1, RowCount());
 
-    QRect line_rect(0, 0, rect.width() - width, height);
-    for (int idx = scroll + 1; idx <= last_line; idx++)
+    // Numbers are composed from digit glyphs in the atlas, right aligned one cell before the text
+    int right = rect.width() - width;
+
+    // Only the first row of a line is numbered
+    char32_t digits[16];
+    for (int row = first_dirty; row < last_dirty; )
     {
-        int flags = Qt::AlignVCenter | Qt::AlignRight;
-        painter.DrawText(line_rect, ToStringView32(idx), flags);
-        line_rect.moveTop(line_rect.top() + height);
+        int line_idx = LineAtRow(row);
+        int line_row = RowOfLine(line_idx);
+
+        if (line_row >= first_dirty)
+        {
+            int count = 0;
+            for (int value = line_idx + 1; value != 0; value /= 10)
+            {
+                digits[15 - count++] = U'0' + value % 10;
+            }
+
+            int top = (line_row - first_row) * height;
+            painter.DrawGlyphs(*atlas, right - count * width, top, StringView32(digits + 16 - count, count));
+        }
+
+        row = line_row + rows.Rows(line_idx);
     }
 }
 
@@ -221,6 +408,251 @@ void Buffer::UpdateFontMetrics()
     metrics = QFontMetrics(font);
     cell_size = metrics.size(Qt::TextSingleLine, "W");
     baseline = metrics.ascent();
+
+    atlas = &GlyphAtlas::Find(font, cell_size, baseline);
+}
+
+void Buffer::LinesReset()
+{
+    edit_count++;
+
+    text_runs.Reset(LineCount());
+    columns.Reset(LineCount());
+    wraps.Reset(LineCount());
+    rows.Reset(LineCount());
+    blocks.Reset(LineCount());
+    syntax.Reset(LineCount());
+
+    folds.clear();
+    hidden.clear();
+
+    max_width = -1;
+    width_changes.clear();
+
+    Damage(0, std::numeric_limits<int>::max());
+}
+
+void Buffer::LinesInserted(int line_idx, int count)
+{
+    edit_count++;
+
+    text_runs.Insert(line_idx, count);
+    columns.Insert(line_idx, count);
+    wraps.Insert(line_idx, count);
+    rows.Insert(line_idx, count);
+    blocks.Insert(line_idx, count);
+    syntax.Insert(line_idx, count);
+
+    for (LineRange & range : width_changes)
+    {
+        if (range.first >= line_idx) range.first += count;
+        if (range.last >= line_idx)  range.last += count;
+    }
+    LineWidthsChanged(line_idx, line_idx + count - 1);
+
+    // Folds move with their lines, but adding lines inside one unfolds it
+    Vector<LineRange> changed;
+    for (int idx = folds.size() - 1; idx >= 0; idx--)
+    {
+        LineRange & fold = folds[idx];
+
+        if (fold.first >= line_idx)
+        {
+            fold.first += count;
+            fold.last  += count;
+        }
+        else if (fold.last >= line_idx)
+        {
+            changed.push_back({ fold.first + 1, fold.last + count });
+            folds.remove(idx);
+        }
+    }
+    UpdateFolds(changed);
+
+    // Everything below moves
+    Damage(line_idx, std::numeric_limits<int>::max());
+}
+
+void Buffer::LinesRemoved(int line_idx, int count)
+{
+    edit_count++;
+
+    for (int idx = line_idx; idx < line_idx + count && max_width != -1; idx++)
+    {
+        if (columns.CachedWidth(idx) >= max_width) widest_changed = true;
+    }
+
+    // Changes inside the removed lines end up on the line after them, which is measured for nothing
+    for (LineRange & range : width_changes)
+    {
+        range.first = range.first >= line_idx + count ? range.first - count : std::min(range.first, line_idx);
+        range.last  = range.last >= line_idx + count  ? range.last - count  : std::min(range.last, line_idx);
+    }
+
+    text_runs.Remove(line_idx, count);
+    columns.Remove(line_idx, count);
+    wraps.Remove(line_idx, count);
+    rows.Remove(line_idx, count);
+    blocks.Remove(line_idx, count);
+    syntax.Remove(line_idx, count);
+
+    Vector<LineRange> changed;
+    for (int idx = folds.size() - 1; idx >= 0; idx--)
+    {
+        LineRange & fold = folds[idx];
+
+        if (fold.first >= line_idx + count)
+        {
+            fold.first -= count;
+            fold.last  -= count;
+        }
+        else if (fold.last >= line_idx)
+        {
+            // Whatever is left of the fold around the removed lines is shown again
+            changed.push_back({ std::min(fold.first + 1, line_idx), std::max(line_idx - 1, fold.last - count) });
+            folds.remove(idx);
+        }
+    }
+    UpdateFolds(changed);
+
+    Damage(line_idx, std::numeric_limits<int>::max());
+}
+
+void Buffer::LineChanged(int line_idx, int x)
+{
+    edit_count++;
+
+    if (max_width != -1 && columns.CachedWidth(line_idx) >= max_width) widest_changed = true;
+    LineWidthsChanged(line_idx, line_idx);
+
+    text_runs.Invalidate(line_idx);
+    columns.Invalidate(line_idx, x);
+    wraps.Invalidate(line_idx, x);
+    blocks.Invalidate(line_idx);
+    syntax.Invalidate(line_idx);
+
+    // Editing a hidden line unfolds it, editing the first line of a fold doesn't
+    RevealLine(line_idx);
+
+    // Edited lines are rewrapped right away, a change in their row count moves everything below
+    if (WrapLine(line_idx)) Damage(line_idx, std::numeric_limits<int>::max());
+    else                    Damage(line_idx, line_idx);
+}
+
+void Buffer::LineRestyled(int line_idx)
+{
+    text_runs.Invalidate(line_idx);
+
+    Damage(line_idx, line_idx);
+}
+
+bool Buffer::WrapLine(int line_idx)
+{
+    if (!Flag(SOFT_WRAP) || wraps.IsValid(line_idx)) return false;
+
+    int count = wraps.Wrap(line_idx, lines[line_idx]);
+    if (IsHidden(line_idx)) count = 0;
+
+    if (count == rows.Rows(line_idx)) return false;
+
+    rows.SetRows(line_idx, count);
+    return true;
+}
+
+void Buffer::ResetRows()
+{
+    rows.Reset(LineCount());
+
+    for (LineRange const& range : hidden)
+    {
+        for (int idx = range.first; idx <= range.last; idx++) rows.SetRows(idx, 0);
+    }
+}
+
+void Buffer::LineWidthsChanged(int first_line, int last_line)
+{
+    if (max_width == -1) return;
+
+    if (width_changes.size() >= MAX_WIDTH_CHANGES)
+    {
+        max_width = -1;
+        width_changes.clear();
+        return;
+    }
+
+    width_changes.push_back({ first_line, last_line });
+}
+
+void Buffer::UpdateFolds(Vector<LineRange> const& changed)
+{
+    hidden.clear();
+    for (LineRange const& fold : folds)
+    {
+        LineRange range = { fold.first + 1, fold.last };
+        if (range.first > range.last) continue;
+
+        // Nested folds are inside the one before them
+        if (!hidden.empty() && hidden.back().last + 1 >= range.first)
+        {
+            hidden.back().last = std::max(hidden.back().last, range.last);
+            continue;
+        }
+
+        hidden.push_back(range);
+    }
+
+    // Only the lines of folds that were added or removed can change, no matter how large the buffer is
+    int first_changed = std::numeric_limits<int>::max();
+    for (LineRange const& range : changed)
+    {
+        int last = std::min(range.last, LineCount() - 1);
+        for (int idx = std::max(range.first, 0); idx <= last; idx++)
+        {
+            int count = IsHidden(idx) ? 0 : wraps.Rows(idx);
+            if (count == rows.Rows(idx)) continue;
+
+            rows.SetRows(idx, count);
+            first_changed = std::min(first_changed, idx - 1);
+        }
+    }
+
+    if (first_changed != std::numeric_limits<int>::max())
+    {
+        Damage(std::max(0, first_changed), std::numeric_limits<int>::max());
+    }
+}
+
+void Buffer::RevealLine(int line_idx)
+{
+    Vector<LineRange> changed;
+    for (int idx = folds.size() - 1; idx >= 0; idx--)
+    {
+        LineRange const& fold = folds[idx];
+
+        if (fold.first < line_idx && line_idx <= fold.last)
+        {
+            changed.push_back({ fold.first + 1, fold.last });
+            folds.remove(idx);
+        }
+    }
+    if (!changed.empty()) UpdateFolds(changed);
+}
+
+void Buffer::UpdateBlocks()
+{
+    if (lexer != nullptr) blocks.Update(lines, *lexer);
+}
+
+int Buffer::PrevVisibleLine(int line_idx)
+{
+    int row = RowOfLine(line_idx) - 1;
+    return row < 0 ? line_idx : LineAtRow(row);
+}
+
+int Buffer::NextVisibleLine(int line_idx)
+{
+    int next = LineAtRow(RowOfLine(line_idx) + rows.Rows(line_idx));
+    return next < LineCount() ? next : line_idx;
 }
 
 Buffer::Buffer() : lines(1), styles(1, { STYLE_DEFAULT }), font("Consolas", 9), metrics(font)
@@ -231,6 +663,8 @@ Buffer::Buffer() : lines(1), styles(1, { STYLE_DEFAULT }), font("Consolas", 9),
 
     style_pos.x = 0;
     style_pos.y = 0;
+
+    LinesReset();
 }
 
 bool Buffer::Flag(int flag)
@@ -240,8 +674,18 @@ bool Buffer::Flag(int flag)
 
 void Buffer::SetFlag(int flag, bool value)
 {
+    int old_flags = flags;
+
     if (value) flags |= flag;
     else       flags &= ~flag;
+
+    if ((old_flags ^ flags) & SOFT_WRAP)
+    {
+        wraps.Reset(LineCount());
+        ResetRows();
+
+        Damage(0, std::numeric_limits<int>::max());
+    }
 }
 
 int Buffer::SelectionSizeTotal()
@@ -301,11 +745,12 @@ void Buffer::CursorAdjustUp(int count)
         {
             Position & stop = cursor.stop;
 
-            if (stop.y != 0)
+            int y = PrevVisibleLine(stop.y);
+            if (y != stop.y)
             {
-                int vx = lines[stop.y].adjust_for_tabs(stop.x);
-                stop.y--;
-                stop.x = lines[stop.y].from_tab_adjusted(vx);
+                int vx = ColumnAt(stop);
+                stop.y = y;
+                stop.x = IndexAtColumn(stop.y, vx);
             }
         }
     }
@@ -321,18 +766,18 @@ void Buffer::CursorAdjustRight(int count)
 
 void Buffer::CursorAdjustDown(int count)
 {
-    int max_y = LineCount() - 1;
     while (count--)
     {
         for (Cursor & cursor : cursors)
         {
             Position & stop = cursor.stop;
 
-            if (stop.y != max_y)
+            int y = NextVisibleLine(stop.y);
+            if (y != stop.y)
             {
-                int vx = lines[stop.y].adjust_for_tabs(stop.x);
-                stop.y++;
-                stop.x = lines[stop.y].from_tab_adjusted(vx);
+                int vx = ColumnAt(stop);
+                stop.y = y;
+                stop.x = IndexAtColumn(stop.y, vx);
             }
         }
     }
@@ -491,11 +936,12 @@ void Buffer::CursorCloneUp()
     {
         Position pos = std::min(c.start, c.stop);
 
-        if (pos.y != 0)
+        int y = PrevVisibleLine(pos.y);
+        if (y != pos.y)
         {
-            int vx = lines[pos.y].adjust_for_tabs(pos.x);
-            pos.y--;
-            pos.x = lines[pos.y].from_tab_adjusted(vx);
+            int vx = ColumnAt(pos);
+            pos.y = y;
+            pos.x = IndexAtColumn(pos.y, vx);
         }
 
         c.start = c.stop = pos;
@@ -514,17 +960,16 @@ void Buffer::CursorCloneDown()
     Vector<Cursor> new_cursors;
     new_cursors.reserve(cursors.size());
 
-    int max_y = LineCount() - 1;
-
     for (Cursor c : cursors)
     {
         Position pos = std::max(c.start, c.stop);
 
-        if (pos.y != max_y)
+        int y = NextVisibleLine(pos.y);
+        if (y != pos.y)
         {
-            int vx = lines[pos.y].adjust_for_tabs(pos.x);
-            pos.y++;
-            pos.x = lines[pos.y].from_tab_adjusted(vx);
+            int vx = ColumnAt(pos);
+            pos.y = y;
+            pos.x = IndexAtColumn(pos.y, vx);
         }
 
         c.start = c.stop = pos;
@@ -620,6 +1065,8 @@ int Buffer::CursorReplaceText(TextView const& text)
             lines[start.y].insert(start.x, first_line);
             styles[start.y].insert(start.x, style, first_line.size());
 
+            LineChanged(start.y, start.x);
+
             for (int inner_idx = idx + 1; inner_idx < cursors.size(); inner_idx++)
             {
                 Cursor & cursor = cursors[inner_idx];
@@ -640,6 +1087,8 @@ int Buffer::CursorReplaceText(TextView const& text)
             lines.insert(start.y + 1, {}, added_line_count);
             styles.insert(start.y + 1, {}, added_line_count);
 
+            LinesInserted(start.y + 1, added_line_count);
+
             String32 & cursor_line = lines[start.y];
 
             StringView32 first_half  = cursor_line.middle_view(0, start.x);
@@ -700,6 +1149,9 @@ int Buffer::CursorReplaceText(TextView const& text)
             lines[start.y] += first_line;
             styles[start.y].resize(first_half.size());
             styles[start.y].resize(first_half.size() + first_line.size() + 1, style);
+
+            // After the line is complete, wrapping looks at its text right away
+            LineChanged(start.y, start.x);
         }
     }
 
@@ -713,49 +1165,497 @@ int Buffer::CursorInsertText(TextView const& text)
     return size;
 }
 
-int Buffer::CursorDeleteSelection()
+int Buffer::CursorInsertNewline()
 {
-    int size = SelectionSizeTotal();
+    // Indentation only follows a single cursor, with several of them lines are just split
+    if (cursors.size() != 1) return CursorInsertText(U"\n");
 
-    for (Cursor & cursor : cursors)
-    {
-        Position start = cursor.start;
-        Position stop  = cursor.stop;
+    Position pos = std::min(cursors[0].start, cursors[0].stop);
+    pos.x = std::min(pos.x, LineLength(pos.y));
 
-        if (start > stop) std::swap(stop, start);
+    StringView32 line = lines[pos.y];
 
-        start.x = std::min(start.x, LineLength(start.y));
-        stop.x  = std::min(stop.x, LineLength(stop.y));
+    int indent = 0;
+    while (indent < pos.x && IsSpace(line[indent])) indent++;
 
-        if (stop.y == start.y)
-        {
-            lines[start.y].remove(start.x, stop.x - start.x);
-            styles[start.y].remove(start.x, stop.x - start.x);
-        }
-        else
-        {
-            lines[start.y].resize(start.x);
-            lines[start.y] += lines[stop.y].middle_view(stop.x);
+    String32 text = U"\n";
+    text += line.middle_view(0, indent);
 
-            lines.remove(start.y + 1, stop.y - start.y);
+    if (lexer != nullptr && BlockDepth(pos) > BlockDepth({ pos.y, 0 }))
+    {
+        text += U"\t";
+    }
 
-            styles[start.y].resize(start.x);
-            styles[start.y] += styles[stop.y].middle(stop.x);
+    return CursorInsertText(text);
+}
 
-            styles.remove(start.y + 1, stop.y - start.y);
-        }
+bool Buffer::FindNext(Search const& search, Position from, Cursor & match)
+{
+    int line_count = LineCount();
 
-        cursor.start = start;
-        cursor.stop  = cursor.start;
+    Search::Cache cache;
 
-        InvalidateStyles(cursor.start.y);
+    // The line the search starts on comes up again last, for matches before from
+    for (int step = 0; step <= line_count; step++)
+    {
+        int line_idx = (from.y + step) % line_count;
+        int x = step == 0 ? std::min(from.x, LineLength(line_idx)) : 0;
 
-        for (Cursor & c : cursors)
+        int start, stop;
+        while (search.Find(lines[line_idx], x, start, stop, cache))
         {
-            c.start = DeleteAdjustedPosition(start, stop, c.start);
-            c.stop  = DeleteAdjustedPosition(start, stop, c.stop);
-        }
-    }
+            // An empty match at from is the one already selected
+            if (step == 0 && start == stop && start == from.x)
+            {
+                x = start + 1;
+                continue;
+            }
+
+            match.start = { line_idx, start };
+            match.stop  = { line_idx, stop };
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Buffer::FindPrev(Search const& search, Position from, Cursor & match)
+{
+    int line_count = LineCount();
+
+    Search::Cache cache;
+
+    Vector<Cursor> line_matches;
+    for (int step = 0; step <= line_count; step++)
+    {
+        int line_idx = ((from.y - step) % line_count + line_count) % line_count;
+
+        line_matches.clear();
+        search.FindAll(lines[line_idx], line_idx, line_matches, cache);
+
+        for (int idx = line_matches.size() - 1; idx >= 0; idx--)
+        {
+            if (step == 0 && line_matches[idx].start.x >= from.x) continue;
+
+            match = line_matches[idx];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Buffer::CursorFind(Search const& search, bool backwards)
+{
+    if (!search.IsValid()) return false;
+
+    Cursor first = FirstCursor();
+    Cursor last  = LastCursor();
+
+    Cursor match;
+
+    bool found;
+    if (backwards) found = FindPrev(search, std::min(first.start, first.stop), match);
+    else           found = FindNext(search, std::max(last.start, last.stop), match);
+
+    if (!found) return false;
+
+    RevealLine(match.start.y);
+
+    cursors.clear();
+    cursors.push_back(match);
+
+    return true;
+}
+
+int Buffer::CursorReplace(Search const& search, TextView const& replacement)
+{
+    if (!search.IsValid()) return 0;
+
+    int changes = 0;
+
+    // With several cursors this only moves to the next match
+    if (cursors.size() == 1)
+    {
+        Position start = std::min(cursors[0].start, cursors[0].stop);
+        Position stop  = std::max(cursors[0].start, cursors[0].stop);
+
+        Search::Cache cache;
+
+        int match_start, match_stop;
+        if (start.y == stop.y && search.Find(lines[start.y], start.x, match_start, match_stop, cache) && match_start == start.x && match_stop == stop.x)
+        {
+            changes = CursorInsertText(replacement);
+        }
+    }
+
+    CursorFind(search);
+
+    return changes;
+}
+
+Vector<Cursor> Buffer::FindAll(Search const& search)
+{
+    return FindAll(search, 0, LineCount());
+}
+
+Vector<Cursor> Buffer::FindAll(Search const& search, int first_line, int last_line)
+{
+    Vector<Cursor> matches;
+    if (!search.IsValid() || first_line >= last_line) return matches;
+
+    ThreadPool & pool = ThreadPool::Instance();
+
+    // Lines are never split, so a chunk is just a range of them
+    int line_count = last_line - first_line;
+    int chunk_size = std::max(1024, line_count / (pool.ThreadCount() * 4));
+    int chunk_count = (line_count + chunk_size - 1) / chunk_size;
+
+    if (chunk_count == 1)
+    {
+        Search::Cache cache;
+        for (int line_idx = first_line; line_idx < last_line; line_idx++)
+        {
+            search.FindAll(lines[line_idx], line_idx, matches, cache);
+        }
+        return matches;
+    }
+
+    Vector<Vector<Cursor>> chunks(chunk_count);
+    pool.ParallelFor(chunk_count,
+        [&](int idx)
+        {
+            Search::Cache cache;
+
+            int first = first_line + idx * chunk_size;
+            int last = std::min(first + chunk_size, last_line);
+
+            for (int line_idx = first; line_idx < last; line_idx++)
+            {
+                search.FindAll(lines[line_idx], line_idx, chunks[idx], cache);
+            }
+        }
+    );
+
+    int match_count = 0;
+    for (Vector<Cursor> const& chunk : chunks)
+    {
+        match_count += chunk.size();
+    }
+
+    matches.reserve(match_count);
+    for (Vector<Cursor> const& chunk : chunks)
+    {
+        matches.insert(matches.end(), chunk.begin(), chunk.end());
+    }
+
+    return matches;
+}
+
+int Buffer::ReplaceAll(Search const& search, TextView const& replacement)
+{
+    if (!search.IsValid()) return 0;
+
+    ThreadPool & pool = ThreadPool::Instance();
+
+    int line_count = LineCount();
+    int chunk_size = std::max(1024, line_count / (pool.ThreadCount() * 4));
+    int chunk_count = (line_count + chunk_size - 1) / chunk_size;
+
+    // Only replacements with newlines change the line count, then every line is swapped at once
+    bool whole = replacement.LineCount() > 1;
+
+    Vector<LineSwap> chunks(chunk_count);
+    Vector<int> counts(chunk_count, 0);
+    Vector<Position> firsts(chunk_count, { -1, -1 });
+
+    pool.ParallelFor(chunk_count,
+        [&](int idx)
+        {
+            Search::Cache cache;
+
+            LineSwap & chunk = chunks[idx];
+
+            Vector<Cursor> matches;
+
+            int first = idx * chunk_size;
+            int last = std::min(first + chunk_size, line_count);
+
+            for (int line_idx = first; line_idx < last; line_idx++)
+            {
+                String32 const& line = lines[line_idx];
+                Vector<int> const& line_styles = styles[line_idx];
+
+                matches.clear();
+                search.FindAll(line, line_idx, matches, cache);
+
+                if (matches.empty())
+                {
+                    if (whole)
+                    {
+                        chunk.lines.push_back(line);
+                        chunk.styles.push_back(line_styles);
+                    }
+                    continue;
+                }
+
+                if (counts[idx] == 0) firsts[idx] = matches.front().start;
+                counts[idx] += matches.size();
+
+                chunk.line_ids.push_back(line_idx);
+                chunk.lines.emplace_back();
+                chunk.styles.emplace_back();
+
+                if (!whole)
+                {
+                    int size = line.size();
+                    for (Cursor const& match : matches) size += replacement.TextSize() - (match.stop.x - match.start.x);
+
+                    chunk.lines.back().reserve(size);
+                    chunk.styles.back().reserve(size + 1);
+                }
+
+                // The text between matches is copied as it is, the replacement takes the style before it until it is restyled
+                int x = 0;
+                for (Cursor const& match : matches)
+                {
+                    int start = std::min(match.start.x, line.size());
+                    int stop = std::min(match.stop.x, line.size());
+
+                    chunk.lines.back().append(line, x, start - x);
+                    chunk.styles.back().insert(chunk.styles.back().end(), line_styles.begin() + x, line_styles.begin() + start);
+
+                    int style = start != 0 ? line_styles[start - 1] : STYLE_DEFAULT;
+
+                    for (int replacement_idx = 0; replacement_idx < replacement.LineCount(); replacement_idx++)
+                    {
+                        if (replacement_idx != 0)
+                        {
+                            chunk.styles.back().push_back(style);
+
+                            chunk.lines.emplace_back();
+                            chunk.styles.emplace_back();
+                        }
+
+                        StringView32 text = replacement.LineAt(replacement_idx);
+
+                        chunk.lines.back().append(text.begin(), text.end());
+                        chunk.styles.back().resize(chunk.styles.back().size() + text.size(), style);
+                    }
+
+                    x = stop;
+                }
+
+                chunk.lines.back().append(line, x, line.size() - x);
+                chunk.styles.back().insert(chunk.styles.back().end(), line_styles.begin() + x, line_styles.end());
+            }
+        }
+    );
+
+    LineSwap swap;
+
+    int count = 0;
+    Position first_match = { -1, -1 };
+
+    for (int idx = 0; idx < chunk_count; idx++)
+    {
+        LineSwap & chunk = chunks[idx];
+
+        if (first_match.y == -1) first_match = firsts[idx];
+        count += counts[idx];
+
+        swap.line_ids.insert(swap.line_ids.end(), chunk.line_ids.begin(), chunk.line_ids.end());
+        std::move(chunk.lines.begin(), chunk.lines.end(), std::back_inserter(swap.lines));
+        std::move(chunk.styles.begin(), chunk.styles.end(), std::back_inserter(swap.styles));
+    }
+
+    if (count == 0) return 0;
+
+    // Lines before the first match are the same in both, so the first match is where it was
+    if (whole)
+    {
+        swap.first_line = first_match.y;
+        swap.line_ids.clear();
+    }
+
+    swap.cursors = { { first_match, first_match } };
+
+    ApplySwap(swap);
+
+    undo_swaps.push_back(std::move(swap));
+    redo_swaps.clear();
+
+    return count;
+}
+
+void Buffer::ApplySwap(LineSwap & swap)
+{
+    if (swap.line_ids.empty())
+    {
+        std::swap(lines, swap.lines);
+        std::swap(styles, swap.styles);
+
+        LinesReset();
+        InvalidateStyles(swap.first_line);
+    }
+    else
+    {
+        for (int idx = 0; idx < swap.line_ids.size(); idx++)
+        {
+            int line_idx = swap.line_ids[idx];
+
+            std::swap(lines[line_idx], swap.lines[idx]);
+            std::swap(styles[line_idx], swap.styles[idx]);
+
+            LineChanged(line_idx);
+        }
+
+        // The swap holds the lines as they were before now
+        UpdateLineStates(swap.line_ids, swap.styles);
+    }
+
+    std::swap(cursors, swap.cursors);
+    RevealCursors();
+
+    swap.edit_count = edit_count;
+}
+
+void Buffer::UpdateLineStates(Vector<int> const& line_ids, Vector<Vector<int>> const& old_styles)
+{
+    int first_line = line_ids.front();
+
+    style_pos = std::min(style_pos, LineStart(first_line));
+
+    if (lexer == nullptr) return;
+
+    // A line that ends in the state it ended in before leaves the lines after it as they were,
+    // otherwise those are scanned until one of them does
+    std::uint8_t state = STYLE_DEFAULT;
+    bool settled = true;
+
+    int next = 0;
+    int line_idx = first_line;
+
+    for (;;)
+    {
+        if (settled)
+        {
+            if (next == line_ids.size()) return;
+
+            line_idx = line_ids[next];
+            state = line_idx != 0 ? styles[line_idx - 1].back() : STYLE_DEFAULT;
+        }
+
+        // States past this aren't known in the first place
+        if (line_idx >= trusted_state_line || line_idx >= LineCount()) return;
+
+        bool changed = next < line_ids.size() && line_ids[next] == line_idx;
+
+        std::uint8_t old_state = changed ? old_styles[next++].back() : styles[line_idx].back();
+
+        if (!lexer->AdvanceLineState(lines[line_idx], state))
+        {
+            trusted_state_line = std::min(trusted_state_line, first_line);
+            return;
+        }
+
+        styles[line_idx].back() = state;
+        settled = state == old_state;
+
+        line_idx++;
+    }
+}
+
+bool Buffer::Undo()
+{
+    if (undo_swaps.empty()) return false;
+
+    // Edits since then weren't recorded, so the lines no longer match the swap
+    if (undo_swaps.back().edit_count != edit_count)
+    {
+        undo_swaps.clear();
+        redo_swaps.clear();
+        return false;
+    }
+
+    LineSwap swap = std::move(undo_swaps.back());
+    undo_swaps.pop_back();
+
+    ApplySwap(swap);
+
+    redo_swaps.push_back(std::move(swap));
+    return true;
+}
+
+bool Buffer::Redo()
+{
+    if (redo_swaps.empty()) return false;
+
+    if (redo_swaps.back().edit_count != edit_count)
+    {
+        undo_swaps.clear();
+        redo_swaps.clear();
+        return false;
+    }
+
+    LineSwap swap = std::move(redo_swaps.back());
+    redo_swaps.pop_back();
+
+    ApplySwap(swap);
+
+    undo_swaps.push_back(std::move(swap));
+    return true;
+}
+
+int Buffer::CursorDeleteSelection()
+{
+    int size = SelectionSizeTotal();
+
+    for (Cursor & cursor : cursors)
+    {
+        Position start = cursor.start;
+        Position stop  = cursor.stop;
+
+        if (start > stop) std::swap(stop, start);
+
+        start.x = std::min(start.x, LineLength(start.y));
+        stop.x  = std::min(stop.x, LineLength(stop.y));
+
+        if (stop.y == start.y)
+        {
+            lines[start.y].remove(start.x, stop.x - start.x);
+            styles[start.y].remove(start.x, stop.x - start.x);
+
+            LineChanged(start.y, start.x);
+        }
+        else
+        {
+            lines[start.y].resize(start.x);
+            lines[start.y] += lines[stop.y].middle_view(stop.x);
+
+            lines.remove(start.y + 1, stop.y - start.y);
+
+            styles[start.y].resize(start.x);
+            styles[start.y] += styles[stop.y].middle(stop.x);
+
+            styles.remove(start.y + 1, stop.y - start.y);
+
+            LinesRemoved(start.y + 1, stop.y - start.y);
+            LineChanged(start.y, start.x);
+        }
+
+        cursor.start = start;
+        cursor.stop  = cursor.start;
+
+        InvalidateStyles(cursor.start.y);
+
+        for (Cursor & c : cursors)
+        {
+            c.start = DeleteAdjustedPosition(start, stop, c.start);
+            c.stop  = DeleteAdjustedPosition(start, stop, c.stop);
+        }
+    }
 
     return -size;
 }
@@ -784,6 +1684,8 @@ int Buffer::ConvertTabsToSpaces()
             }
         }
 
+        if (count != 0) LineChanged(y);
+
         total += count;
     }
 
@@ -792,35 +1694,52 @@ int Buffer::ConvertTabsToSpaces()
 
 void Buffer::ConsolidateCursors()
 {
-    for (int outer = 0; outer < cursors.size(); outer++)
+    auto pred = [](Cursor const& lhs, Cursor const& rhs)
+    {
+        return std::min(lhs.start, lhs.stop) < std::min(rhs.start, rhs.stop);
+    };
+
+    // Cursors almost always stay sorted, so this is usually a single linear pass
+    if (!std::is_sorted(cursors.begin(), cursors.end(), pred))
     {
-        Position start_a = cursors[outer].start;
-        Position stop_a = cursors[outer].stop;
+        std::stable_sort(cursors.begin(), cursors.end(), pred);
+    }
 
-        bool is_backward_a = start_a > stop_a;
-        if (is_backward_a) std::swap(start_a, stop_a);
+    int count = 0;
+    for (int idx = 0; idx < cursors.size(); idx++)
+    {
+        Position start_b = cursors[idx].start;
+        Position stop_b  = cursors[idx].stop;
 
-        for (int inner = cursors.size() - 1; inner > outer; inner--)
+        bool is_backward_b = start_b > stop_b;
+        if (is_backward_b) std::swap(start_b, stop_b);
+
+        if (count != 0)
         {
-            Position start_b = cursors[inner].start;
-            Position stop_b = cursors[inner].stop;
+            Cursor & last = cursors[count - 1];
+
+            Position start_a = last.start;
+            Position stop_a  = last.stop;
 
-            bool is_backward_b = start_b > stop_b;
-            if (is_backward_b)     std::swap(start_b, stop_b);
-            if (start_b > stop_a)  continue;
-            if (start_a > stop_b)  continue;
-            if (start_b < start_a) std::swap(start_a, start_b);
-            if (stop_b > stop_a)   std::swap(stop_a, stop_b);
+            bool is_backward_a = start_a > stop_a;
+            if (is_backward_a) std::swap(start_a, stop_a);
 
-            cursors.remove(inner);
+            if (start_b <= stop_a)
+            {
+                last.start = start_a;
+                last.stop  = std::max(stop_a, stop_b);
 
-            cursors[outer].start = start_a;
-            cursors[outer].stop  = stop_a;
+                bool is_backward = is_backward_a || is_backward_b;
+                if (is_backward) std::swap(last.start, last.stop);
 
-            bool is_backward = is_backward_a || is_backward_b;
-            if (is_backward) std::swap(cursors[outer].start, cursors[outer].stop);
+                continue;
+            }
         }
+
+        cursors[count++] = cursors[idx];
     }
+
+    cursors.resize(count);
 }
 
 int Buffer::StyleAt(Position pos)
@@ -842,7 +1761,12 @@ void Buffer::SetStyle(int count, int style)
 
         if (style_pos.x <= LineLength(style_pos.y))
         {
-            styles[style_pos.y][style_pos.x] = style;
+            int & current = styles[style_pos.y][style_pos.x];
+            if (current != style)
+            {
+                current = style;
+                LineRestyled(style_pos.y);
+            }
         }
         style_pos = NextPosition(style_pos);
     }
@@ -870,25 +1794,63 @@ void Buffer::EnsureStyled(int line_idx)
     }
 }
 
+void Buffer::EnsureStyled(int first_line, int last_line)
+{
+    // Lines past the styled area can be styled on their own as long as
+    // the state at the end of the line before them is known
+    if (lexer != nullptr && first_line > style_pos.y && first_line <= trusted_state_line)
+    {
+        Position styled_pos = style_pos;
+
+        style_pos = LineStart(first_line);
+        EnsureStyled(last_line);
+
+        style_pos = styled_pos;
+        return;
+    }
+
+    EnsureStyled(last_line);
+}
+
 void Buffer::InvalidateStyles()
 {
+    // NOTE@Daniel:
+    //  Keywords don't change where comments and strings end, so the known line states stay valid
     style_pos = FirstPosition();
 }
 
 void Buffer::InvalidateStyles(Position pos)
 {
     style_pos = pos;
+    trusted_state_line = std::min(trusted_state_line, pos.y);
 }
 
 void Buffer::InvalidateStyles(int line_idx)
 {
     style_pos = std::min(style_pos, LineStart(line_idx));
+    trusted_state_line = std::min(trusted_state_line, line_idx);
+}
+
+void Buffer::RestoreLineStates(Vector<std::uint8_t> const& states)
+{
+    if (states.size() != LineCount()) return;
+
+    for (int idx = 0; idx < LineCount(); idx++)
+    {
+        // Only the part past the styled area, the rest is already correct
+        if (idx >= style_pos.y) styles[idx].back() = states[idx];
+    }
+
+    trusted_state_line = LineCount();
 }
 
 void Buffer::SetLexer(Lexer * new_lexer)
 {
     lexer = new_lexer;
     new_lexer->SetParent(this);
+
+    blocks.Reset(LineCount());
+    syntax.Reset(LineCount());
 }
 
 QSize const& Buffer::CellSize()
@@ -898,8 +1860,15 @@ QSize const& Buffer::CellSize()
 
 int Buffer::LineNumberMarginWidth()
 {
-    int count = (int)std::log10(LineCount()) + 1;
-    return CellSize().width() * (count + 1);
+    if (margin_line_count != LineCount())
+    {
+        margin_line_count = LineCount();
+
+        margin_digits = 1;
+        for (int value = margin_line_count; value >= 10; value /= 10) margin_digits++;
+    }
+
+    return CellSize().width() * (margin_digits + 1);
 }
 
 void Buffer::ClearCursors()
@@ -914,6 +1883,34 @@ void Buffer::AddCursor(Cursor cursor)
     ConsolidateCursors();
 }
 
+void Buffer::SetCursors(Vector<Cursor> new_cursors)
+{
+    cursors = std::move(new_cursors);
+    RevealCursors();
+    ConsolidateCursors();
+}
+
+void Buffer::AppendCursors(Vector<Cursor> const& more)
+{
+    if (more.empty()) return;
+
+    int first = cursors.size();
+    cursors.insert(cursors.end(), more.begin(), more.end());
+    RevealCursors(first);
+    ConsolidateCursors();
+}
+
+void Buffer::RevealCursors(int first)
+{
+    if (folds.empty()) return;
+
+    for (int idx = first; idx < cursors.size(); idx++)
+    {
+        if (IsHidden(cursors[idx].start.y)) RevealLine(cursors[idx].start.y);
+        if (IsHidden(cursors[idx].stop.y))  RevealLine(cursors[idx].stop.y);
+    }
+}
+
 int Buffer::CursorCount()
 {
     return cursors.size();
@@ -1003,7 +2000,387 @@ void Buffer::ZoomOut(int amount)
     SetPointSize(std::max(font.pointSize() - amount, 1));
 }
 
-void Buffer::Paint(Painter & painter, int scroll)
+void Buffer::Damage(int first_line, int last_line)
+{
+    // Consecutive edits usually hit the same line
+    if (!damage.empty())
+    {
+        LineRange & range = damage.back();
+        if (first_line >= range.first && last_line <= range.last) return;
+    }
+
+    LineRange range;
+    range.first = first_line;
+    range.last = last_line;
+
+    // Restyling a large area shouldn't grow this without bound
+    if (damage.size() == 256)
+    {
+        for (LineRange const& other : damage)
+        {
+            range.first = std::min(range.first, other.first);
+            range.last  = std::max(range.last, other.last);
+        }
+        damage.clear();
+    }
+
+    damage.push_back(range);
+}
+
+void Buffer::DamageCursors()
+{
+    for (Cursor const& cursor : cursors)
+    {
+        Damage(std::min(cursor.start.y, cursor.stop.y), std::max(cursor.start.y, cursor.stop.y));
+    }
+
+    for (BlockKeyword const& keyword : matched)
+    {
+        Damage(keyword.pos.y, keyword.pos.y);
+    }
+    matched.clear();
+
+    if (lexer == nullptr || cursors.size() != 1) return;
+
+    UpdateBlocks();
+
+    BlockKeyword open, close;
+    if (blocks.Matching(cursors[0].stop, open, close))
+    {
+        matched.push_back(open);
+        matched.push_back(close);
+
+        Damage(open.pos.y, open.pos.y);
+        Damage(close.pos.y, close.pos.y);
+    }
+}
+
+Vector<LineRange> Buffer::TakeDamage()
+{
+    Vector<LineRange> result;
+    std::swap(result, damage);
+    return result;
+}
+
+int Buffer::ColumnAt(Position pos)
+{
+    return columns.Column(pos.y, lines[pos.y], pos.x);
+}
+
+int Buffer::IndexAtColumn(int line_idx, int column)
+{
+    return columns.Index(line_idx, lines[line_idx], column);
+}
+
+int Buffer::LineWidth(int line_idx)
+{
+    return columns.Width(line_idx, lines[line_idx]);
+}
+
+int Buffer::MaximumLineWidth()
+{
+    if (max_width != -1)
+    {
+        int changed_max = -1;
+        for (LineRange const& range : width_changes)
+        {
+            int last = std::min(range.last, LineCount() - 1);
+            for (int idx = range.first; idx <= last; idx++) changed_max = std::max(changed_max, LineWidth(idx));
+        }
+
+        // Lines that didn't change are no wider than before
+        if (changed_max >= max_width || !widest_changed) max_width = std::max(max_width, changed_max);
+        else                                             max_width = -1;
+    }
+
+    width_changes.clear();
+    widest_changed = false;
+
+    if (max_width == -1)
+    {
+        max_width = 0;
+        for (int idx = 0; idx < LineCount(); idx++)
+        {
+            max_width = std::max(max_width, LineWidth(idx));
+        }
+    }
+
+    return max_width;
+}
+
+int Buffer::WrapWidth()
+{
+    return wraps.Width();
+}
+
+void Buffer::SetWrapWidth(int columns)
+{
+    if (std::max(1, columns) == wraps.Width()) return;
+
+    // Row counts are kept as estimates until every line is wrapped again
+    wraps.SetWidth(columns);
+
+    if (Flag(SOFT_WRAP)) Damage(0, std::numeric_limits<int>::max());
+}
+
+void Buffer::EnsureWrapped(int first_line, int row_count)
+{
+    if (!Flag(SOFT_WRAP)) return;
+
+    int row = RowOfLine(first_line);
+    int last_row = row + row_count;
+
+    for (int line_idx = first_line; line_idx < LineCount() && row < last_row; line_idx = LineAtRow(row))
+    {
+        if (WrapLine(line_idx)) Damage(line_idx, std::numeric_limits<int>::max());
+
+        row = RowOfLine(line_idx) + rows.Rows(line_idx);
+    }
+}
+
+bool Buffer::WrapPending(int budget)
+{
+    if (!Flag(SOFT_WRAP)) return false;
+
+    // Visible lines are wrapped before they are painted, so nothing here needs to be repainted
+    for (int count = 0; count < budget; count++)
+    {
+        int line_idx = wraps.NextPending();
+        if (line_idx == -1) return false;
+
+        WrapLine(line_idx);
+    }
+
+    return wraps.NextPending() != -1;
+}
+
+int Buffer::RowCount()
+{
+    return rows.RowCount();
+}
+
+int Buffer::RowOfLine(int line_idx)
+{
+    return rows.RowOf(line_idx);
+}
+
+int Buffer::LineAtRow(int row)
+{
+    return rows.LineAt(row);
+}
+
+bool Buffer::RowsAreLines()
+{
+    return rows.IsUniform();
+}
+
+Position Buffer::DisplayPosition(Position pos)
+{
+    WrapLine(pos.y);
+
+    int sub_row = wraps.RowAt(pos.y, pos.x);
+
+    Position result;
+    result.y = RowOfLine(pos.y) + sub_row;
+    result.x = ColumnAt(pos) - wraps.RowColumn(pos.y, sub_row);
+    return result;
+}
+
+Position Buffer::PositionAtDisplay(int row, int column)
+{
+    row = std::clamp(row, 0, RowCount() - 1);
+
+    Position pos;
+    pos.y = LineAtRow(row);
+
+    WrapLine(pos.y);
+
+    int row_count = wraps.Rows(pos.y);
+    int sub_row = std::min(row - RowOfLine(pos.y), row_count - 1);
+
+    int first = wraps.RowStart(pos.y, sub_row);
+    pos.x = std::max(IndexAtColumn(pos.y, wraps.RowColumn(pos.y, sub_row) + column), first);
+
+    // Past the end of a wrapped row is the last character of that row, its end is already the next row
+    if (sub_row + 1 < row_count)
+    {
+        pos.x = std::min(pos.x, wraps.RowStart(pos.y, sub_row + 1) - 1);
+    }
+
+    return pos;
+}
+
+int Buffer::BlockDepth(Position pos)
+{
+    if (lexer == nullptr) return 0;
+
+    UpdateBlocks();
+    return blocks.Depth(pos);
+}
+
+void Buffer::UpdateSyntax()
+{
+    if (lexer == nullptr) return;
+
+    int first_line, last_line;
+    if (syntax.Update(lines, *lexer, first_line, last_line)) Damage(first_line, last_line);
+}
+
+Vector<Diagnostic> Buffer::Diagnostics(int first_line, int last_line)
+{
+    if (lexer == nullptr) return {};
+
+    return syntax.Diagnostics(first_line, last_line);
+}
+
+bool Buffer::IsHidden(int line_idx)
+{
+    auto pred = [](int line_idx, LineRange const& range) { return line_idx < range.first; };
+    auto it = std::upper_bound(hidden.begin(), hidden.end(), line_idx, pred);
+
+    return it != hidden.begin() && line_idx <= (it - 1)->last;
+}
+
+bool Buffer::IsFolded(int line_idx)
+{
+    auto pred = [](LineRange const& range, int line_idx) { return range.first < line_idx; };
+    auto it = std::lower_bound(folds.begin(), folds.end(), line_idx, pred);
+
+    return it != folds.end() && it->first == line_idx;
+}
+
+void Buffer::MoveCursorsOutOfFolds()
+{
+    // Cursors can't stay on lines that aren't shown, they go to the end of the fold's first line
+    for (Cursor & cursor : cursors)
+    {
+        if (IsHidden(cursor.start.y)) cursor.start = LineEnd(PrevVisibleLine(cursor.start.y));
+        if (IsHidden(cursor.stop.y))  cursor.stop  = LineEnd(PrevVisibleLine(cursor.stop.y));
+    }
+
+    ConsolidateCursors();
+}
+
+void Buffer::CursorFold()
+{
+    if (lexer == nullptr) return;
+
+    UpdateBlocks();
+
+    auto pred = [](LineRange const& lhs, LineRange const& rhs) { return lhs.first < rhs.first; };
+
+    Vector<LineRange> added;
+    for (Cursor const& cursor : cursors)
+    {
+        int line_idx = cursor.stop.y;
+
+        // A block opened on the cursor line is folded before the one around it, so is one closed on it
+        Position pos = { line_idx, LineLength(line_idx) };
+
+        Vector<BlockEdge> const& edges = blocks.Edges(line_idx);
+        if (edges.empty() || !edges.back().open) pos.x = 0;
+
+        BlockKeyword open, close;
+        bool found = blocks.Enclosing(pos, open, close);
+
+        // Keywords are outside of the blocks they open, so this steps out past folded ones
+        while (found && (open.pos.y == close.pos.y || IsFolded(open.pos.y)))
+        {
+            found = blocks.Enclosing(open.pos, open, close);
+        }
+
+        if (!found) continue;
+
+        added.push_back({ open.pos.y, close.pos.y });
+    }
+
+    // Cursors in the same block fold it once, not it and then the block around it
+    auto same = [](LineRange const& lhs, LineRange const& rhs) { return lhs.first == rhs.first; };
+    std::sort(added.begin(), added.end(), pred);
+    added.erase(std::unique(added.begin(), added.end(), same), added.end());
+
+    Vector<LineRange> changed;
+    for (LineRange const& fold : added)
+    {
+        folds.insert(std::upper_bound(folds.begin(), folds.end(), fold, pred), fold);
+
+        changed.push_back({ fold.first + 1, fold.last });
+    }
+
+    UpdateFolds(changed);
+    MoveCursorsOutOfFolds();
+}
+
+void Buffer::CursorUnfold()
+{
+    Vector<int> removed;
+    for (Cursor const& cursor : cursors)
+    {
+        int line_idx = cursor.stop.y;
+
+        int innermost = -1;
+        for (int idx = 0; idx < folds.size() && folds[idx].first <= line_idx; idx++)
+        {
+            if (folds[idx].last >= line_idx) innermost = idx;
+        }
+
+        if (innermost != -1) removed.push_back(innermost);
+    }
+
+    // Cursors in the same fold remove it once, not it and then the fold around it
+    std::sort(removed.begin(), removed.end());
+    removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+
+    Vector<LineRange> changed;
+    for (int idx = removed.size() - 1; idx >= 0; idx--)
+    {
+        changed.push_back({ folds[removed[idx]].first + 1, folds[removed[idx]].last });
+        folds.remove(removed[idx]);
+    }
+
+    UpdateFolds(changed);
+}
+
+void Buffer::FoldAll()
+{
+    if (lexer == nullptr) return;
+
+    UpdateBlocks();
+
+    Vector<LineRange> changed;
+    for (Block const& block : blocks.Blocks())
+    {
+        if (block.kind != BLOCK_FUNCTION || IsFolded(block.first)) continue;
+
+        changed.push_back({ block.first, block.last });
+    }
+
+    // Both are sorted, so they are merged instead of inserted one at a time
+    Vector<LineRange> merged;
+    merged.reserve(folds.size() + changed.size());
+
+    auto pred = [](LineRange const& lhs, LineRange const& rhs) { return lhs.first < rhs.first; };
+    std::merge(folds.begin(), folds.end(), changed.begin(), changed.end(), std::back_inserter(merged), pred);
+
+    folds = std::move(merged);
+
+    for (LineRange & range : changed) range.first++;
+
+    UpdateFolds(changed);
+    MoveCursorsOutOfFolds();
+}
+
+void Buffer::UnfoldAll()
+{
+    Vector<LineRange> changed = std::move(folds);
+    folds.clear();
+
+    for (LineRange & range : changed) range.first++;
+
+    UpdateFolds(changed);
+}
+
+void Buffer::Paint(Painter & painter, int scroll, int hscroll)
 {
     QRect rect = painter.Rect();
 
@@ -1015,8 +2392,8 @@ void Buffer::Paint(Painter & painter, int scroll)
     painter.SetFont(font);
 
     painter.SetClipRect(text_rect);
-    PaintTextMargin(painter, scroll);
+    if (!painter.DirtyRect().isEmpty()) PaintTextMargin(painter, scroll, hscroll);
 
     painter.SetClipRect(margin_rect);
-    PaintLineNumberMargin(painter, scroll);
+    if (!painter.DirtyRect().isEmpty()) PaintLineNumberMargin(painter, scroll);
 }
@@ -10,12 +10,27 @@
 #include "Cursor.hpp"
 
 #include "Painter.hpp"
+#include "GlyphAtlas.hpp"
+#include "TextRunCache.hpp"
+#include "ColumnIndex.hpp"
+#include "WrapIndex.hpp"
+#include "RowIndex.hpp"
+#include "BlockTree.hpp"
+#include "SyntaxTree.hpp"
+#include "Search.hpp"
 
 #include "Lexer.hpp"
 
+struct LineRange
+{
+    int first;
+    int last;
+};
+
 enum WhitespaceFlag
 {
-    EXPAND_TABS
+    EXPAND_TABS = 1 << 0,
+    SOFT_WRAP   = 1 << 1
 };
 
 class Buffer : public TextContainer<Buffer>
@@ -36,24 +51,128 @@ private:
     QSize cell_size;
     int baseline;
 
+    GlyphAtlas * atlas;
+
     Position style_pos;
 
+    // Lines before this have a known state at their end even if they aren't styled yet
+    int trusted_state_line = 0;
+
     int flags = EXPAND_TABS;
 
-protected:
-    void SetText(TextView const& text);
+    TextRunCache text_runs;
+    ColumnIndex columns;
+
+    // Width of the widest line, -1 until every line has to be measured again. Lines added or changed since are
+    // measured on their own, unless one of them or a removed one used to be the widest and nothing is as wide now.
+    static constexpr int MAX_WIDTH_CHANGES = 1024;
+
+    int max_width = -1;
+    Vector<LineRange> width_changes;
+    bool widest_changed = false;
+
+    // Lines are split into rows only while SOFT_WRAP is set, otherwise every line is one row
+    WrapIndex wraps;
+    RowIndex rows;
+
+    // Folded blocks sorted by their first line, which stays visible, and the lines they hide merged together
+    Vector<LineRange> folds;
+    Vector<LineRange> hidden;
+
+    // Block keywords of every line, rescanned by the lexer only for lines that changed
+    BlockTree blocks;
+
+    // Statements of every line nested into blocks, reparsed by the lexer only around lines that changed
+    SyntaxTree syntax;
+
+    // The block keyword at the cursor and the one it matches, outlined while there is a single cursor
+    Vector<BlockKeyword> matched;
+
+    // The digit count only changes when the line count crosses a power of ten
+    int margin_line_count = -1;
+    int margin_digits = 1;
 
+    // Lines that need to be repainted since the last call to TakeDamage
+    Vector<LineRange> damage;
+
+    // Lines swapped in by a bulk edit. Swapping them back undoes it and swapping them once more redoes it.
+    struct LineSwap
+    {
+        // Empty when every line was swapped
+        Vector<int> line_ids;
+
+        Vector<String32> lines;
+        Vector<Vector<int>> styles;
+        Vector<Cursor> cursors;
+
+        // The first line that differs when every line was swapped
+        int first_line = 0;
+
+        // The swap only fits the lines as they were right after it
+        int edit_count = 0;
+    };
+
+    Vector<LineSwap> undo_swaps;
+    Vector<LineSwap> redo_swaps;
+
+    // Counts changes to lines, so a swap can tell whether anything else was edited since
+    int edit_count = 0;
+
+protected:
     Position DeleteAdjustedPosition(Position start, Position stop, Position pos);
     Position NewlineAdjustedPosition(Position insertion_pos, Position pos);
 
-    void PaintTextMargin(Painter & painter, int scroll);
-    void PaintLineNumberMargin(Painter & painter, int scroll);
+    void PaintTextMargin(Painter & painter, int first_row, int first_column);
+    void PaintLineNumberMargin(Painter & painter, int first_row);
 
     void UpdateFontMetrics();
 
+    // Every change to lines and styles goes through these so per-line caches stay in sync
+    void LinesReset();
+    void LinesInserted(int line_idx, int count);
+    void LinesRemoved(int line_idx, int count);
+    void LineChanged(int line_idx, int x = 0);
+    void LineRestyled(int line_idx);
+
+    // Returns whether the row count of the line changed
+    bool WrapLine(int line_idx);
+
+    void ResetRows();
+
+    // Rebuilds the hidden lines from the folds and fixes the row counts of the given lines
+    void UpdateFolds(Vector<LineRange> const& changed);
+
+    // Moves cursors on hidden lines to the end of the line their fold starts on
+    void MoveCursorsOutOfFolds();
+
+    // Past MAX_WIDTH_CHANGES measuring every line again is cheaper than keeping track
+    void LineWidthsChanged(int first_line, int last_line);
+
+    int PrevVisibleLine(int line_idx);
+    int NextVisibleLine(int line_idx);
+
+    void UpdateBlocks();
+
+    // Unfolds every fold hiding the line
+    void RevealLine(int line_idx);
+
+    // Opens the folds hiding any cursor from first on
+    void RevealCursors(int first = 0);
+
+    void ApplySwap(LineSwap & swap);
+
+    // Rescans the states at the end of the changed lines, and of the lines after them until they end up in the same state as before
+    void UpdateLineStates(Vector<int> const& line_ids, Vector<Vector<int>> const& old_styles);
+
+    // The first match after from and the last one before it, both wrap around the end of the buffer
+    bool FindNext(Search const& search, Position from, Cursor & match);
+    bool FindPrev(Search const& search, Position from, Cursor & match);
+
 public:
     Buffer();
 
+    void SetText(TextView const& text);
+
     bool Flag(int flag);
     void SetFlag(int flag, bool value = true);
 
@@ -107,8 +226,29 @@ public:
 
     int CursorInsertText(TextView const& text);
 
+    // Keeps the indentation of the line, one level deeper after a line opening a block
+    int CursorInsertNewline();
+
     int CursorDeleteSelection();
 
+    // Selects the next match after the last cursor, or the one before the first cursor
+    bool CursorFind(Search const& search, bool backwards = false);
+
+    // Replaces the selection if it is exactly a match, then selects the next one
+    int CursorReplace(Search const& search, TextView const& replacement);
+
+    // Every match in the buffer, or in [first_line, last_line), searched a chunk of lines per thread
+    Vector<Cursor> FindAll(Search const& search);
+    Vector<Cursor> FindAll(Search const& search, int first_line, int last_line);
+
+    // Replaces every match in one pass over the lines, a chunk of lines per thread, and can be undone as a whole.
+    // Returns the number of matches replaced.
+    int ReplaceAll(Search const& search, TextView const& replacement);
+
+    // Only bulk edits are recorded, any other edit drops what could be undone or redone
+    bool Undo();
+    bool Redo();
+
     int ConvertTabsToSpaces();
 
     void ConsolidateCursors();
@@ -120,20 +260,71 @@ public:
 
     void EnsureStyled(Position pos);
     void EnsureStyled(int line_idx);
+    void EnsureStyled(int first_line, int last_line);
 
     void InvalidateStyles();
     void InvalidateStyles(Position pos);
     void InvalidateStyles(int line_idx);
 
+    void RestoreLineStates(Vector<std::uint8_t> const& states);
+
     void SetLexer(Lexer * new_lexer);
 
     QSize const& CellSize();
 
     int LineNumberMarginWidth();
 
+    int ColumnAt(Position pos);
+    int IndexAtColumn(int line_idx, int column);
+    int LineWidth(int line_idx);
+    int MaximumLineWidth();
+
+    int WrapWidth();
+    void SetWrapWidth(int columns);
+
+    // Wraps the lines shown from first_line on right away, the rest are left to WrapPending
+    void EnsureWrapped(int first_line, int row_count);
+
+    // Wraps up to budget lines that still use an estimate, returns whether any are left
+    bool WrapPending(int budget);
+
+    int RowCount();
+    int RowOfLine(int line_idx);
+    int LineAtRow(int row);
+
+    // True while every line takes exactly one row
+    bool RowsAreLines();
+
+    // The row of the position and its column within that row
+    Position DisplayPosition(Position pos);
+    Position PositionAtDisplay(int row, int column);
+
+    // How many blocks are open at the position
+    int BlockDepth(Position pos);
+
+    // Reparses what changed since the last call and damages the lines whose diagnostics may have changed
+    void UpdateSyntax();
+
+    // Syntax errors on the lines as of the last UpdateSyntax, sorted by position
+    Vector<Diagnostic> Diagnostics(int first_line, int last_line);
+
+    bool IsHidden(int line_idx);
+    bool IsFolded(int line_idx);
+
+    void CursorFold();
+    void CursorUnfold();
+
+    void FoldAll();
+    void UnfoldAll();
+
     void ClearCursors();
     void AddCursor(Cursor cursor);
 
+    // Bulk versions of AddCursor, sorted cursors are consolidated in one linear pass
+    void SetCursors(Vector<Cursor> new_cursors);
+    // The cursors have to come after the existing ones, so results can be added as they are found
+    void AppendCursors(Vector<Cursor> const& more);
+
     int CursorCount();
 
     Cursor FirstCursor();
@@ -152,7 +343,12 @@ public:
     void ZoomIn(int amount = 1);
     void ZoomOut(int amount = 1);
 
-    void Paint(Painter & painter, int scroll);
+    void Damage(int first_line, int last_line);
+    void DamageCursors();
+    Vector<LineRange> TakeDamage();
+
+    // Scroll is in rows, hscroll in columns
+    void Paint(Painter & painter, int scroll, int hscroll = 0);
 };
 
 #endif // BUFFER_HPP
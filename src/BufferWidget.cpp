@@ -1,17 +1,42 @@
 #include "BufferWidget.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
 #include <QDebug>
 
 #include <QApplication>
+#include <QFile>
+#include <QFileDialog>
+#include <QElapsedTimer>
+#include <QInputDialog>
+#include <QLineEdit>
 #include <QPixmap>
+#include <QSignalBlocker>
+#include <QToolTip>
 
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QKeyEvent>
 #include <QPaintEvent>
+#include <QHelpEvent>
 
 #include "Painter.hpp"
 #include "Clipboard.hpp"
+#include "NativeDatabase.hpp"
+#include "SymbolCache.hpp"
+#include "Theme.hpp"
+#include "Workspace.hpp"
+
+namespace
+{
+    constexpr int MAX_COMPLETIONS = 10;
+
+    // Shorter names complete to too much to be worth showing while typing
+    constexpr int MIN_COMPLETION_PREFIX = 2;
+}
 
 int BufferWidget::CellWidth()
 {
@@ -30,12 +55,12 @@ QSize BufferWidget::CellArea()
 
 int BufferWidget::FirstVisibleLine()
 {
-    return scrollBarVertical->value();
+    return std::min(buffer.LineAtRow(VScroll()), buffer.LineCount() - 1);
 }
 
 int BufferWidget::LastVisibleLine()
 {
-    return std::min(FirstVisibleLine() + CellHeight(), buffer.LineCount() - 1);
+    return std::min(buffer.LineAtRow(VScroll() + CellHeight()), buffer.LineCount() - 1);
 }
 
 Position BufferWidget::FirstVisiblePosition()
@@ -58,13 +83,418 @@ void BufferWidget::EnsureCursorIsVisible()
 {
     if (buffer.CursorCount() == 1)
     {
+        // Folds may have just been opened, so the scroll range is updated first
+        UpdateScrollbar();
 
+        Position pos = buffer.DisplayPosition(buffer.LastCursor().stop);
+
+        // A cursor out of view is centered, like after a jump
+        if (pos.y < VScroll() || pos.y >= VScroll() + CellHeight())
+        {
+            SetVScroll(std::max(0, pos.y - CellHeight() / 2));
+        }
+
+        if (pos.x < HScroll() || pos.x >= HScroll() + CellWidth())
+        {
+            SetHScroll(std::max(0, pos.x - CellWidth() / 2));
+        }
     }
 }
 
 void BufferWidget::EnsureVisibleAreaIsStyled()
 {
-    buffer.EnsureStyled(LastVisibleLine());
+    buffer.EnsureWrapped(FirstVisibleLine(), CellHeight() + 1);
+    buffer.EnsureStyled(FirstVisibleLine(), LastVisibleLine());
+}
+
+int BufferWidget::WrapColumns()
+{
+    return std::max(1, (dummyWidget->size().width() - buffer.LineNumberMarginWidth()) / buffer.CellSize().width());
+}
+
+void BufferWidget::UpdateWrapWidth()
+{
+    if (buffer.Flag(SOFT_WRAP) && buffer.WrapWidth() != WrapColumns()) Rewrap(FirstVisibleLine());
+}
+
+void BufferWidget::Rewrap(int line_idx)
+{
+    // Only what is about to be shown is wrapped now, the line at the top stays there
+    if (buffer.Flag(SOFT_WRAP))
+    {
+        buffer.SetWrapWidth(WrapColumns());
+        buffer.EnsureWrapped(line_idx, CellHeight() + 1);
+
+        wrap_timer.start();
+    }
+
+    UpdateScrollbar();
+    SetVScroll(buffer.RowOfLine(line_idx));
+
+    update();
+}
+
+void BufferWidget::ToggleSoftWrap()
+{
+    int line_idx = FirstVisibleLine();
+
+    buffer.SetFlag(SOFT_WRAP, !buffer.Flag(SOFT_WRAP));
+
+    SetHScroll(0);
+    Rewrap(line_idx);
+}
+
+void BufferWidget::Refold(std::function<void()> const& change)
+{
+    // Folds above the view move everything, so it is kept on the same line
+    int line_idx = FirstVisibleLine();
+
+    change();
+
+    UpdateScrollbar();
+    SetVScroll(buffer.RowOfLine(line_idx));
+}
+
+bool BufferWidget::PromptSearch(QString const& title)
+{
+    bool ok = false;
+
+    QString text = QInputDialog::getText(this, title, "Find:", QLineEdit::Normal, search_text, &ok);
+    if (!ok || text.isEmpty()) return false;
+
+    search_text = text;
+
+    String32 pattern = search_text.toStdU32String();
+    return search.SetPattern(pattern, search_flags);
+}
+
+void BufferWidget::Find(bool backwards)
+{
+    if (!search.IsValid() && !PromptSearch("Find")) return;
+
+    if (buffer.CursorFind(search, backwards)) EnsureCursorIsVisible();
+}
+
+int BufferWidget::Replace()
+{
+    if (!search.IsValid()) return 0;
+
+    String32 replacement = replace_text.toStdU32String();
+
+    int changes = buffer.CursorReplace(search, replacement);
+    EnsureCursorIsVisible();
+
+    return changes;
+}
+
+int BufferWidget::ReplaceAll()
+{
+    if (!search.IsValid()) return 0;
+
+    String32 replacement = replace_text.toStdU32String();
+
+    int line_idx = FirstVisibleLine();
+
+    int count = buffer.ReplaceAll(search, replacement);
+    if (count == 0) return 0;
+
+    // Replacements with newlines swap in every line at once, which leaves them all to be wrapped again
+    Rewrap(std::min(line_idx, buffer.LineCount() - 1));
+    EnsureCursorIsVisible();
+
+    return count;
+}
+
+void BufferWidget::ToggleSearchFlag(int flag)
+{
+    search_flags ^= flag;
+
+    String32 pattern = search_text.toStdU32String();
+    if (!pattern.empty()) search.SetPattern(pattern, search_flags);
+}
+
+void BufferWidget::SelectAllOccurrences()
+{
+    CancelSelectAll();
+
+    Cursor cursor = buffer.LastCursor();
+
+    Position start = std::min(cursor.start, cursor.stop);
+    Position stop  = std::max(cursor.start, cursor.stop);
+
+    String32 word = buffer.IdentifierAt(cursor.stop);
+
+    if (start.y == stop.y && start != stop)
+    {
+        select_search.SetPattern(buffer.Text(start, stop), SEARCH_MATCH_CASE);
+    }
+    else if (!word.empty())
+    {
+        select_search.SetPattern(word, SEARCH_MATCH_CASE);
+    }
+    else
+    {
+        select_search = search;
+    }
+
+    if (!select_search.IsValid()) return;
+
+    select_line = 0;
+    select_slice = 16384;
+    select_count = 0;
+    select_timer.start();
+}
+
+void BufferWidget::CancelSelectAll()
+{
+    select_timer.stop();
+}
+
+int BufferWidget::Undo(bool redo)
+{
+    int line_idx = FirstVisibleLine();
+
+    bool changed = redo ? buffer.Redo() : buffer.Undo();
+    if (!changed) return 0;
+
+    Rewrap(std::min(line_idx, buffer.LineCount() - 1));
+    EnsureCursorIsVisible();
+
+    return 1;
+}
+
+void BufferWidget::ShowCompletion(bool requested)
+{
+    Cursor cursor = buffer.LastCursor();
+
+    // Every cursor could be in the middle of a different name
+    if (buffer.CursorCount() != 1 || cursor.start != cursor.stop)
+    {
+        HideCompletion();
+        return;
+    }
+
+    String32 prefix = buffer.IdentifierBefore(cursor.stop);
+    if (prefix.size() < (requested ? 1 : MIN_COMPLETION_PREFIX))
+    {
+        HideCompletion();
+        return;
+    }
+
+    candidates = completion.Complete(prefix, MAX_COMPLETIONS);
+    if (candidates.empty())
+    {
+        HideCompletion();
+        return;
+    }
+
+    Theme const& theme = ThemeManager::Instance().CurrentTheme();
+
+    completion_list->clear();
+    for (CompletionCandidate const& candidate : candidates)
+    {
+        QListWidgetItem * item = new QListWidgetItem(QString::fromStdU32String(candidate.name), completion_list);
+        item->setForeground(theme[candidate.style].forecolor);
+    }
+    completion_list->setCurrentRow(0);
+
+    // Lined up with the start of the name, below it unless that runs off the bottom
+    Position start = cursor.stop;
+    start.x -= prefix.size();
+
+    Position pos = buffer.DisplayPosition(start);
+    QSize cs = buffer.CellSize();
+
+    int frame = 2 * completion_list->frameWidth();
+
+    int width = completion_list->sizeHintForColumn(0) + frame;
+    int height = completion_list->sizeHintForRow(0) * completion_list->count() + frame;
+
+    int x = buffer.LineNumberMarginWidth() + (pos.x - HScroll()) * cs.width();
+    int y = (pos.y - VScroll() + 1) * cs.height();
+
+    if (y + height > dummyWidget->height()) y -= height + cs.height();
+
+    completion_list->setGeometry(x, y, width, height);
+    completion_list->show();
+    completion_list->raise();
+}
+
+void BufferWidget::HideCompletion()
+{
+    completion_list->hide();
+}
+
+int BufferWidget::AcceptCompletion()
+{
+    int row = completion_list->currentRow();
+
+    HideCompletion();
+
+    if (row < 0 || row >= candidates.size()) return 0;
+
+    String32 name = candidates[row].name;
+
+    Cursor cursor = buffer.LastCursor();
+    cursor.start.x -= buffer.IdentifierBefore(cursor.stop).size();
+
+    buffer.ClearCursors();
+    buffer.AddCursor(cursor);
+
+    int changes = buffer.CursorReplaceText(name);
+
+    completion.Accept(name);
+
+    return changes;
+}
+
+bool BufferWidget::CompletionKey(Hotkey hotkey)
+{
+    int count = completion_list->count();
+    int row = completion_list->currentRow();
+
+    if (hotkey == Qt::Key_Up)
+    {
+        completion_list->setCurrentRow((row + count - 1) % count);
+        return true;
+    }
+
+    if (hotkey == Qt::Key_Down)
+    {
+        completion_list->setCurrentRow((row + 1) % count);
+        return true;
+    }
+
+    if (hotkey == Qt::Key_Tab || hotkey == Qt::Key_Return || hotkey == Qt::Key_Enter)
+    {
+        if (AcceptCompletion() != 0) timer.start();
+        return true;
+    }
+
+    if (hotkey == Qt::Key_Escape)
+    {
+        HideCompletion();
+        return true;
+    }
+
+    return false;
+}
+
+bool BufferWidget::UpdateDamage()
+{
+    Vector<LineRange> damage = buffer.TakeDamage();
+
+    int margin_width = buffer.LineNumberMarginWidth();
+    if (margin_width != painted_margin_width)
+    {
+        painted_margin_width = margin_width;
+        update();
+        return true;
+    }
+
+    int ch = buffer.CellSize().height();
+
+    int first_row = VScroll();
+    int last_row  = first_row + CellHeight();
+
+    bool damaged = false;
+
+    int line_count = buffer.LineCount();
+    if (line_count != painted_line_count)
+    {
+        int top = std::max(0, (buffer.RowOfLine(std::min(line_count, painted_line_count)) - first_row) * ch);
+        if (top < height())
+        {
+            update(QRect(0, top, margin_width, height() - top));
+            damaged = true;
+        }
+
+        painted_line_count = line_count;
+    }
+
+    // The line number margin is left alone, the numbers don't move when text does unless lines span several rows
+    bool rows_are_lines = buffer.RowsAreLines();
+
+    int left = rows_are_lines && painted_rows_are_lines ? margin_width : 0;
+    painted_rows_are_lines = rows_are_lines;
+
+    for (LineRange const& range : damage)
+    {
+        int first = buffer.RowOfLine(std::min(range.first, line_count));
+        int last  = range.last >= line_count ? buffer.RowCount() : buffer.RowOfLine(range.last + 1);
+
+        first = std::max(first, first_row);
+        last  = std::min(last, last_row + 1);
+
+        int top = (first - first_row) * ch;
+
+        // Lines that were removed at the end leave behind an area that has to be cleared as well
+        int bottom = range.last == std::numeric_limits<int>::max() ? height() : (last - first_row) * ch;
+        if (top >= bottom) continue;
+
+        update(QRect(left, top, width() - left, bottom - top));
+        damaged = true;
+    }
+
+    return damaged;
+}
+
+bool BufferWidget::Frame()
+{
+    UpdateWrapWidth();
+
+    EnsureVisibleAreaIsStyled();
+    UpdateScrollbar();
+
+    // Lines added since the last frame are only wrapped when they come into view
+    if (buffer.WrapPending(0)) wrap_timer.start();
+
+    buffer.UpdateSyntax();
+
+    buffer.DamageCursors();
+    return UpdateDamage();
+}
+
+void BufferWidget::ScrollBackBuffer(int delta)
+{
+    if (delta == 0) return;
+
+    int dy = -delta * buffer.CellSize().height();
+
+    // The scrollbars are transparent, so the area under them has to be redrawn instead of moved
+    QRect area = rect();
+    if (scrollBarVertical->isVisible())   area.setRight(scrollBarVertical->x() - 1);
+    if (scrollBarHorizontal->isVisible()) area.setBottom(scrollBarHorizontal->y() - 1);
+
+    if (back_buffer.size() != size() || std::abs(dy) >= area.height())
+    {
+        update();
+        return;
+    }
+
+    int bytes = area.width() * sizeof(QRgb);
+    int offset = area.left() * sizeof(QRgb);
+
+    if (dy < 0)
+    {
+        for (int y = area.top(); y <= area.bottom() + dy; y++)
+        {
+            std::memcpy(back_buffer.scanLine(y) + offset, back_buffer.constScanLine(y - dy) + offset, bytes);
+        }
+    }
+    else
+    {
+        for (int y = area.bottom(); y >= area.top() + dy; y--)
+        {
+            std::memcpy(back_buffer.scanLine(y) + offset, back_buffer.constScanLine(y - dy) + offset, bytes);
+        }
+    }
+
+    // Moves what is already on screen the same way and only asks for the exposed lines to be painted
+    scroll(0, dy, area);
+
+    if (scrollBarVertical->isVisible())   update(scrollBarVertical->geometry());
+    if (scrollBarHorizontal->isVisible()) update(scrollBarHorizontal->geometry());
 }
 
 int BufferWidget::VScroll()
@@ -88,6 +518,16 @@ void BufferWidget::ScrollDown(int amount)
     EnsureVisibleAreaIsStyled();
 }
 
+int BufferWidget::HScroll()
+{
+    return scrollBarHorizontal->value();
+}
+
+void BufferWidget::SetHScroll(int value)
+{
+    scrollBarHorizontal->setValue(value);
+}
+
 Position BufferWidget::ScreenToCell(QPoint pt, bool round)
 {
     QSize cs = buffer.CellSize();
@@ -98,33 +538,130 @@ Position BufferWidget::ScreenToCell(QPoint pt, bool round)
     int px = pt.x() - mw;
 
     int sy = VScroll() + py / cs.height();
-    int sx = px / cs.width();
+    int sx = HScroll() + px / cs.width();
 
-    Position pos;
-    pos.y = std::min(sy, buffer.LineCount() - 1);
+    Position pos = buffer.PositionAtDisplay(sy, sx);
 
     StringView32 line = buffer.LineAt(pos.y);
-    pos.x = line.from_tab_adjusted(sx);
 
     if (round && pos.x < line.size())
     {
-        int start = line.adjust_for_tabs(pos.x);
+        int start = buffer.DisplayPosition(pos).x;
         char32_t ch = line[pos.x];
 
         int w = 1;
-        if (ch == U'\t') w = TabWidth(start);
+        if (ch == U'\t') w = TabWidth(buffer.ColumnAt(pos));
 
-        int rem = px - start * cs.width();
+        int rem = px - (start - HScroll()) * cs.width();
         if (2 * rem > w * cs.width()) pos.x++;
     }
 
     return buffer.ClampPosition(pos);
 }
 
+void BufferWidget::JumpTo(Position pos)
+{
+    pos = buffer.ClampPosition(pos);
+
+    Cursor cursor;
+    cursor.start = pos;
+    cursor.stop = pos;
+
+    buffer.ClearCursors();
+    buffer.AddCursor(cursor);
+
+    SetVScroll(std::max(0, buffer.RowOfLine(pos.y) - CellHeight() / 2));
+    update();
+}
+
+void BufferWidget::GoToDefinition()
+{
+    String32 name = buffer.IdentifierAt(buffer.LastCursor().stop);
+    if (name.empty()) return;
+
+    Workspace & workspace = Workspace::Instance();
+
+    Vector<SymbolDefinition> definitions = workspace.Definitions(name);
+    if (definitions.empty()) return;
+
+    int file = filename.isEmpty() ? -1 : workspace.FileId(filename);
+
+    // Prefer a definition from the current file
+    SymbolLocation location = definitions.front().location;
+    for (SymbolDefinition const& definition : definitions)
+    {
+        if (definition.location.file == file)
+        {
+            location = definition.location;
+            break;
+        }
+    }
+
+    if (location.file != file)
+    {
+        OpenFile(workspace.FilePath(location.file));
+        if (workspace.FileId(filename) != location.file) return;
+    }
+
+    JumpTo(location.pos);
+}
+
+void BufferWidget::SelectReferences()
+{
+    String32 name = buffer.IdentifierAt(buffer.LastCursor().stop);
+    if (name.empty() || filename.isEmpty()) return;
+
+    Workspace & workspace = Workspace::Instance();
+
+    int file = workspace.FileId(filename);
+    if (file == -1) return;
+
+    Vector<Cursor> cursors;
+    for (SymbolLocation const& location : workspace.References(name))
+    {
+        if (location.file != file) continue;
+
+        Cursor cursor;
+        cursor.start = buffer.ClampPosition(location.pos);
+        cursor.stop = cursor.start;
+        cursor.stop.x = std::min(cursor.start.x + name.size(), buffer.LineLength(cursor.start.y));
+        cursors.push_back(cursor);
+    }
+
+    if (cursors.empty()) return;
+
+    auto pred = [](Cursor const& lhs, Cursor const& rhs) { return lhs.stop < rhs.stop; };
+    std::sort(cursors.begin(), cursors.end(), pred);
+
+    buffer.SetCursors(std::move(cursors));
+}
+
+void BufferWidget::SetSymbols(HashMap<String32, int> const& symbols)
+{
+    lexer.ClearKeywords();
+
+    lexer.SetKeywordStyle(symbols);
+
+    completion.SetSymbols(symbols);
+
+    lexer.SetKeywordStyle(U"integer", JASS_TYPE);
+    lexer.SetKeywordStyle(U"real", JASS_TYPE);
+    lexer.SetKeywordStyle(U"boolean", JASS_TYPE);
+    lexer.SetKeywordStyle(U"string", JASS_TYPE);
+    lexer.SetKeywordStyle(U"code", JASS_TYPE);
+    lexer.SetKeywordStyle(U"handle", JASS_TYPE);
+
+    buffer.InvalidateStyles();
+    EnsureVisibleAreaIsStyled();
+    UpdateDamage();
+}
+
 void BufferWidget::UpdateScrollbar()
 {
-    int sy = buffer.LineCount();
-    int sx = buffer.MaximumTabAdjustedLineLength();
+    int sy = buffer.RowCount();
+
+    // Wrapped lines never need to be scrolled sideways
+    int sx = buffer.Flag(SOFT_WRAP) ? 0 : buffer.MaximumLineWidth();
 
     int cw = CellWidth();
     int ch = CellHeight();
@@ -142,10 +679,13 @@ void BufferWidget::UpdateScrollbar()
     scrollBarVertical->setHidden(vshow);
 }
 
-BufferWidget::BufferWidget(QWidget * parent) : QWidget(parent), timer(this)
+BufferWidget::BufferWidget(QWidget * parent) : QWidget(parent), timer(this), scheduler(this, [this] { return Frame(); }), wrap_timer(this), select_timer(this)
 {
     setupUi(this);
 
+    // Every pixel comes from the back buffer, so Qt doesn't need to clear anything before painting
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
     timer.setSingleShot(true);
     timer.setInterval(250);
 
@@ -154,27 +694,106 @@ BufferWidget::BufferWidget(QWidget * parent) : QWidget(parent), timer(this)
         {
             qDebug() << "Updating lexer...";
 
-            lexer.ClearKeywords();
+            String32 text = buffer.Text();
 
-            lexer.SetKeywordStyle(Jass::Scrape(buffer.Text()));
+            if (!filename.isEmpty()) Workspace::Instance().UpdateFile(filename, text);
 
-            lexer.SetKeywordStyle(U"integer", JASS_TYPE);
-            lexer.SetKeywordStyle(U"real", JASS_TYPE);
-            lexer.SetKeywordStyle(U"boolean", JASS_TYPE);
-            lexer.SetKeywordStyle(U"string", JASS_TYPE);
-            lexer.SetKeywordStyle(U"code", JASS_TYPE);
-            lexer.SetKeywordStyle(U"handle", JASS_TYPE);
+            SetSymbols(Jass::Scrape(text));
+        }
+    );
 
-            buffer.InvalidateStyles();
-            EnsureVisibleAreaIsStyled();
-            update();
+    completion_list = new QListWidget(this);
+    completion_list->setFocusPolicy(Qt::NoFocus);
+    completion_list->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    completion_list->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    completion_list->setUniformItemSizes(true);
+    completion_list->hide();
+
+    connect(completion_list, &QListWidget::itemClicked,
+        [this](...)
+        {
+            if (AcceptCompletion() != 0) timer.start();
+            scheduler.Schedule();
         }
     );
 
-    connect(scrollBarVertical, &QScrollBar::valueChanged,
+    completion.SetNatives(NativeDatabase::Instance());
+
+    wrap_timer.setInterval(0);
+
+    connect(&wrap_timer, &QTimer::timeout,
         [this](...)
         {
+            // Rows above the view can change, so the view is kept on the same line instead of the same row
+            int line_idx = FirstVisibleLine();
+            int offset = VScroll() - buffer.RowOfLine(line_idx);
+
+            if (!buffer.WrapPending(4096)) wrap_timer.stop();
+
+            int row = buffer.RowOfLine(line_idx) + offset;
+
+            QSignalBlocker blocker(scrollBarVertical);
+            UpdateScrollbar();
+            SetVScroll(row);
+
+            painted_scroll = row;
+        }
+    );
+
+    select_timer.setInterval(0);
+
+    connect(&select_timer, &QTimer::timeout,
+        [this](...)
+        {
+            QElapsedTimer clock;
+            clock.start();
+
+            int last_line = std::min(select_line + select_slice, buffer.LineCount());
+            Vector<Cursor> matches = buffer.FindAll(select_search, select_line, last_line);
+
+            // The cursor the search started from stays until there is a match to replace it
+            if (!matches.empty())
+            {
+                int count = matches.size();
+
+                Refold(
+                    [&]
+                    {
+                        if (select_count == 0) buffer.SetCursors(std::move(matches));
+                        else                   buffer.AppendCursors(matches);
+                    }
+                );
+
+                select_count += count;
+            }
+
+            select_line = last_line;
+            if (select_line >= buffer.LineCount()) select_timer.stop();
+
+            // Each tick should take about a frame, whatever the lines look like
+            if (clock.elapsed() < 8)       select_slice *= 2;
+            else if (clock.elapsed() > 16) select_slice = std::max(1024, select_slice / 2);
+
+            scheduler.Schedule();
+        }
+    );
+
+    connect(scrollBarVertical, &QScrollBar::valueChanged,
+        [this](int value)
+        {
+            int delta = value - painted_scroll;
+            painted_scroll = value;
+
             EnsureVisibleAreaIsStyled();
+
+            ScrollBackBuffer(delta);
+            UpdateDamage();
+        }
+    );
+
+    connect(scrollBarHorizontal, &QScrollBar::valueChanged,
+        [this](...)
+        {
             update();
         }
     );
@@ -215,8 +834,8 @@ BufferWidget::BufferWidget(QWidget * parent) : QWidget(parent), timer(this)
 
     keymap[Control & Qt::Key_A] = [this] { buffer.CursorSelectAll(); };
 
-    keymap[Qt::Key_Return] = [this] { return buffer.CursorInsertText(U"\n"); };
-    keymap[Qt::Key_Enter]  = [this] { return buffer.CursorInsertText(U"\n"); };
+    keymap[Qt::Key_Return] = [this] { return buffer.CursorInsertNewline(); };
+    keymap[Qt::Key_Enter]  = [this] { return buffer.CursorInsertNewline(); };
 
     keymap[Control & Qt::Key_Return] = [this] { return buffer.CursorInsertText(U"\n"); };
     keymap[Control & Qt::Key_Enter]  = [this] { return buffer.CursorInsertText(U"\n"); };
@@ -235,17 +854,176 @@ BufferWidget::BufferWidget(QWidget * parent) : QWidget(parent), timer(this)
 
     keymap[Control & Alt & Qt::Key_L] = [this] { return buffer.ConvertTabsToSpaces(); };
 
+    keymap[Control & Qt::Key_O] = [this]
+    {
+        QString name = QFileDialog::getOpenFileName(this, "Open", {}, "Jass (*.j *.vj *.ai);;All files (*)");
+        if (!name.isEmpty()) OpenFile(name);
+    };
+
+    keymap[Control & Shift & Qt::Key_O] = [this]
+    {
+        QString name = QFileDialog::getExistingDirectory(this, "Open Folder");
+        if (!name.isEmpty()) Workspace::Instance().Open(name);
+    };
+
+    keymap[Alt & Qt::Key_Z] = [this] { ToggleSoftWrap(); };
+
+    // Shift turns the brackets into braces on most layouts
+    keymap[Control & Shift & Qt::Key_BracketLeft]  = [this] { Refold([this] { buffer.CursorFold();   }); };
+    keymap[Control & Shift & Qt::Key_BracketRight] = [this] { Refold([this] { buffer.CursorUnfold(); }); };
+    keymap[Control & Shift & Qt::Key_BraceLeft]    = [this] { Refold([this] { buffer.CursorFold();   }); };
+    keymap[Control & Shift & Qt::Key_BraceRight]   = [this] { Refold([this] { buffer.CursorUnfold(); }); };
+
+    keymap[Control & Alt & Qt::Key_BracketLeft]  = [this] { Refold([this] { buffer.FoldAll();   }); };
+    keymap[Control & Alt & Qt::Key_BracketRight] = [this] { Refold([this] { buffer.UnfoldAll(); }); };
+
+    keymap[Control & Qt::Key_F] = [this]
+    {
+        if (PromptSearch("Find")) Find();
+    };
+
+    keymap[Qt::Key_F3]         = [this] { Find();     };
+    keymap[Shift & Qt::Key_F3] = [this] { Find(true); };
+
+    keymap[Control & Qt::Key_H] = [this]
+    {
+        if (!PromptSearch("Replace")) return 0;
+
+        bool ok = false;
+
+        QString text = QInputDialog::getText(this, "Replace", "Replace with:", QLineEdit::Normal, replace_text, &ok);
+        if (!ok) return 0;
+
+        replace_text = text;
+        return Replace();
+    };
+
+    keymap[Control & Shift & Qt::Key_H] = [this] { return Replace(); };
+
+    keymap[Control & Alt & Qt::Key_H] = [this]
+    {
+        if (!PromptSearch("Replace All")) return 0;
+
+        bool ok = false;
+
+        QString text = QInputDialog::getText(this, "Replace All", "Replace with:", QLineEdit::Normal, replace_text, &ok);
+        if (!ok) return 0;
+
+        replace_text = text;
+        return ReplaceAll();
+    };
+
+    keymap[Control & Qt::Key_Z]         = [this] { return Undo();     };
+    keymap[Control & Qt::Key_Y]         = [this] { return Undo(true); };
+    keymap[Control & Shift & Qt::Key_Z] = [this] { return Undo(true); };
+
+    keymap[Alt & Qt::Key_C] = [this] { ToggleSearchFlag(SEARCH_MATCH_CASE); };
+    keymap[Alt & Qt::Key_R] = [this] { ToggleSearchFlag(SEARCH_REGEX);      };
+
+    keymap[Control & Shift & Qt::Key_L] = [this] { SelectAllOccurrences(); };
+    keymap[Qt::Key_Escape]              = [this] { CancelSelectAll();      };
+
+    keymap[Qt::Key_F12]         = [this] { GoToDefinition();   };
+    keymap[Shift & Qt::Key_F12] = [this] { SelectReferences(); };
+
+    keymap[Control & Qt::Key_Space] = [this] { ShowCompletion(true); };
+
     UpdateScrollbar();
 
     buffer.SetLexer(&lexer);
 }
 
+void BufferWidget::OpenLocation(QString const& path, Cursor match)
+{
+    if (path != filename)
+    {
+        OpenFile(path);
+        if (filename != path) return;
+    }
+
+    JumpTo(match.stop);
+
+    match.start = buffer.ClampPosition(match.start);
+    match.stop = buffer.ClampPosition(match.stop);
+
+    buffer.ClearCursors();
+    buffer.AddCursor(match);
+
+    setFocus();
+}
+
+void BufferWidget::OpenFile(QString const& name)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QByteArray data = file.readAll();
+
+    filename = name;
+
+    CancelSelectAll();
+    HideCompletion();
+
+    String32 text = QString::fromUtf8(data).replace("\r\n", "\n").toStdU32String();
+    buffer.SetText(text);
+
+    std::uint64_t hash = SymbolCache::Hash(data.constData(), data.size());
+
+    SymbolCacheEntry entry;
+    if (!SymbolCache::Instance().Load(hash, entry))
+    {
+        entry.symbols = Jass::Scrape(text);
+        entry.line_states = lexer.LineStates(text);
+
+        SymbolCache::Instance().Store(hash, entry);
+    }
+
+    buffer.RestoreLineStates(entry.line_states);
+
+    Rewrap(0);
+
+    SetSymbols(entry.symbols);
+}
+
+bool BufferWidget::event(QEvent * event)
+{
+    if (event->type() != QEvent::ToolTip) return QWidget::event(event);
+
+    // Hovering over a diagnostic tells what is wrong there
+    QHelpEvent * help = static_cast<QHelpEvent *>(event);
+
+    Position pos = ScreenToCell(help->pos(), false);
+
+    QString text;
+    if (pos.x >= 0 && pos.y < buffer.LineCount())
+    {
+        for (Diagnostic const& diagnostic : buffer.Diagnostics(pos.y, pos.y))
+        {
+            if (pos.x < diagnostic.pos.x || pos.x >= diagnostic.pos.x + diagnostic.size) continue;
+
+            if (!text.isEmpty()) text += '\n';
+            text += QString::fromStdU32String(diagnostic.message);
+        }
+    }
+
+    if (text.isEmpty()) QToolTip::hideText();
+    else                QToolTip::showText(help->globalPos(), text, this);
+
+    return true;
+}
+
 void BufferWidget::mousePressEvent(QMouseEvent * event)
 {
     setFocus();
 
+    // Matches are found by line index, which any change to the cursors or the text makes stale
+    CancelSelectAll();
+    HideCompletion();
+
     Position pos = ScreenToCell(event->pos());
 
+    buffer.DamageCursors();
+
     if (pos.y < buffer.LineCount())
     {
         Qt::KeyboardModifiers modifiers = event->modifiers();
@@ -282,7 +1060,7 @@ void BufferWidget::mousePressEvent(QMouseEvent * event)
         }
     }
 
-    update();
+    scheduler.Schedule();
 }
 
 void BufferWidget::mouseReleaseEvent(QMouseEvent * event)
@@ -296,6 +1074,8 @@ void BufferWidget::mouseDoubleClickEvent(QMouseEvent * event)
 
     Position pos = ScreenToCell(event->pos(), false);
 
+    buffer.DamageCursors();
+
     if (pos.y < buffer.LineCount())
     {
         Qt::KeyboardModifiers modifiers = event->modifiers();
@@ -306,7 +1086,7 @@ void BufferWidget::mouseDoubleClickEvent(QMouseEvent * event)
         else           buffer.AddWordSelection(pos);
     }
 
-    update();
+    scheduler.Schedule();
 }
 
 void BufferWidget::mouseMoveEvent(QMouseEvent * event)
@@ -320,20 +1100,27 @@ void BufferWidget::wheelEvent(QWheelEvent * event)
 
     Qt::KeyboardModifiers modifiers = QApplication::keyboardModifiers();
 
+    HideCompletion();
+
     int delta = event->angleDelta().y();
     delta = (delta > 0) - (delta < 0);
     if (modifiers & Qt::ControlModifier)
     {
         if (delta > 0) buffer.ZoomIn();
         if (delta < 0) buffer.ZoomOut();
+
+        UpdateWrapWidth();
+        update();
+    }
+    else if (modifiers & Qt::ShiftModifier)
+    {
+        if (scrollBarHorizontal->isVisible()) SetHScroll(HScroll() - 8 * delta);
     }
     else if (scrollBarVertical->isVisible())
     {
         if (delta > 0) ScrollUp(2);
         if (delta < 0) ScrollDown(2);
     }
-
-    update();
 }
 
 void BufferWidget::keyPressEvent(QKeyEvent * event)
@@ -354,6 +1141,18 @@ void BufferWidget::keyPressEvent(QKeyEvent * event)
 
     Hotkey hotkey(control, shift, alt, key);
 
+    CancelSelectAll();
+
+    buffer.DamageCursors();
+
+    if (completion_list->isVisible() && CompletionKey(hotkey))
+    {
+        scheduler.Schedule();
+        return;
+    }
+
+    bool typing_name = false;
+
     if (keymap.contains(hotkey))
     {
         int changes = keymap[hotkey]();
@@ -364,35 +1163,54 @@ void BufferWidget::keyPressEvent(QKeyEvent * event)
     {
         buffer.CursorInsertText(text);
         timer.start();
+
+        typing_name = std::all_of(text.begin(), text.end(), IsIdentifierChar);
     }
 
-    EnsureVisibleAreaIsStyled();
+    // The list follows the name as it is typed or erased, any other key puts it away
+    bool erasing_name = hotkey == Qt::Key_Backspace && completion_list->isVisible();
 
-    buffer.ConsolidateCursors();
+    if (typing_name || erasing_name)              ShowCompletion();
+    else if (hotkey != (Control & Qt::Key_Space)) HideCompletion();
 
-    {
-        UpdateScrollbar();
-    }
+    // The next event in the burst may be handled before the frame, so it must see non-overlapping cursors
+    buffer.ConsolidateCursors();
 
-    update();
+    scheduler.Schedule();
 }
 
 void BufferWidget::paintEvent(QPaintEvent * event)
 {
-    Painter painter(this);
+    if (back_buffer.size() != size())
+    {
+        back_buffer = QImage(size(), QImage::Format_RGB32);
+    }
+
+    {
+        Painter painter(&back_buffer);
+
+        for (QRect const& r : event->region())
+        {
+            painter.SetDirtyRect(r);
+            buffer.Paint(painter, VScroll(), HScroll());
+        }
+    }
 
-    buffer.Paint(painter, scrollBarVertical->value());
+    QPainter painter(this);
+    painter.drawImage(event->rect(), back_buffer, event->rect());
 
+    // Drawn over the widget rather than the back buffer so partial repaints don't darken it repeatedly
     if (!hasFocus())
     {
-        QRect r = rect();
-        painter.SetClipRect(r);
-        painter.FillRect(r, QColor(0, 0, 0, 63));
+        painter.fillRect(event->rect(), QColor(0, 0, 0, 63));
     }
+
+    scheduler.Presented();
 }
 
 void BufferWidget::resizeEvent(QResizeEvent * event)
 {
+    UpdateWrapWidth();
     UpdateScrollbar();
     EnsureVisibleAreaIsStyled();
 }
@@ -5,13 +5,17 @@
 
 #include <QWidget>
 #include <QTimer>
+#include <QImage>
+#include <QListWidget>
 
 #include "HashMap.hpp"
 
 #include "Buffer.hpp"
 #include "LexerJass.hpp"
+#include "Completion.hpp"
 
 #include "KeyMap.hpp"
+#include "FrameScheduler.hpp"
 
 class BufferWidget : public QWidget, private Ui::BufferWidget
 {
@@ -25,6 +29,50 @@ private:
 
     QTimer timer;
 
+    // Input is applied as it arrives, but styling, scrollbars and repaints wait for the next frame
+    FrameScheduler scheduler;
+
+    // Wraps the lines that aren't visible a chunk at a time after the wrap width changes
+    QTimer wrap_timer;
+
+    QString filename;
+
+    // Kept between searches so F3 can repeat the last one
+    Search search;
+    int search_flags = 0;
+
+    QString search_text;
+    QString replace_text;
+
+    // Selecting every occurrence searches a slice of lines per tick, so huge files fill in while it runs
+    QTimer select_timer;
+    Search select_search;
+
+    int select_line = 0;
+    int select_slice = 0;
+    int select_count = 0;
+
+    Completion completion;
+
+    // Shown under the name being typed, it never takes the focus so typing goes on in the buffer
+    QListWidget * completion_list;
+    Vector<CompletionCandidate> candidates;
+
+    // Everything is painted here first so text can be blended straight into memory
+    QImage back_buffer;
+
+    // A change in width shifts the whole text area, so it needs a full repaint
+    int painted_margin_width = 0;
+
+    // Rows past the end of the buffer have no number, so the margin only changes with the line count
+    int painted_line_count = 0;
+
+    // The vertical scroll the back buffer was rendered at
+    int painted_scroll = 0;
+
+    // Line numbers only stay put while no line is wrapped or folded away
+    bool painted_rows_are_lines = true;
+
     int CellWidth();
     int CellHeight();
 
@@ -40,21 +88,73 @@ private:
 
     void EnsureVisibleAreaIsStyled();
 
+    int WrapColumns();
+    void UpdateWrapWidth();
+    void Rewrap(int line_idx);
+    void ToggleSoftWrap();
+
+    void Refold(std::function<void()> const& change);
+
+    // Asks for the text to search for, returns false if it was cancelled or isn't a valid pattern
+    bool PromptSearch(QString const& title);
+
+    void Find(bool backwards = false);
+    int Replace();
+    int ReplaceAll();
+    void ToggleSearchFlag(int flag);
+
+    // Looks for the selection, the word under the cursor or the last search, and puts a cursor on every match
+    void SelectAllOccurrences();
+    void CancelSelectAll();
+
+    int Undo(bool redo = false);
+
+    // Names shorter than two characters are only completed when asked for
+    void ShowCompletion(bool requested = false);
+    void HideCompletion();
+    int AcceptCompletion();
+
+    // Returns whether the key was used to pick from the completion list
+    bool CompletionKey(Hotkey hotkey);
+
+    // Returns whether anything was asked to be repainted
+    bool UpdateDamage();
+
+    bool Frame();
+
+    void ScrollBackBuffer(int delta);
+
     int VScroll();
     void SetVScroll(int value);
     void ScrollUp(int amount = 1);
     void ScrollDown(int amount = 1);
 
+    int HScroll();
+    void SetHScroll(int value);
+
     Position ScreenToCell(QPoint pt, bool round = true);
 
+    void JumpTo(Position pos);
+
+    void GoToDefinition();
+    void SelectReferences();
+
+    void SetSymbols(HashMap<String32, int> const& symbols);
+
 private slots:
     void UpdateScrollbar();
 
 public:
     explicit BufferWidget(QWidget * parent = nullptr);
 
+    void OpenFile(QString const& name);
+
+    // Opens the file unless it is already open and selects the match
+    void OpenLocation(QString const& path, Cursor match);
+
     // QWidget interface
 protected:
+    bool event(QEvent * event);
     void mousePressEvent(QMouseEvent * event);
     void mouseReleaseEvent(QMouseEvent * event);
     void mouseDoubleClickEvent(QMouseEvent * event);
@@ -0,0 +1,111 @@
+#include "ColumnIndex.hpp"
+
+#include <algorithm>
+
+#include "SpecialCharacters.hpp"
+
+int ColumnIndex::Advance(StringView32 line, int column, int first, int last)
+{
+    for (int idx = first; idx < last; idx++)
+    {
+        if (line[idx] == U'\t') column += TabWidth(column);
+        else                    column++;
+    }
+    return column;
+}
+
+void ColumnIndex::Extend(Entry & entry, StringView32 line, int count)
+{
+    count = std::min(count, line.size() / STRIDE + 1);
+
+    if (entry.checkpoints.empty()) entry.checkpoints.push_back(0);
+
+    while (entry.checkpoints.size() < count)
+    {
+        int k = entry.checkpoints.size();
+        entry.checkpoints.push_back(Advance(line, entry.checkpoints.back(), (k - 1) * STRIDE, k * STRIDE));
+    }
+}
+
+void ColumnIndex::Reset(int line_count)
+{
+    entries.clear();
+    entries.resize(line_count);
+}
+
+void ColumnIndex::Insert(int line_idx, int count)
+{
+    entries.insert(line_idx, {}, count);
+}
+
+void ColumnIndex::Remove(int line_idx, int count)
+{
+    entries.remove(line_idx, count);
+}
+
+void ColumnIndex::Invalidate(int line_idx, int x)
+{
+    Entry & entry = entries[line_idx];
+
+    entry.width = -1;
+
+    if (entry.checkpoints.size() > x / STRIDE + 1)
+    {
+        entry.checkpoints.resize(x / STRIDE + 1);
+    }
+}
+
+int ColumnIndex::Column(int line_idx, StringView32 line, int x)
+{
+    x = std::clamp(x, 0, line.size());
+
+    Entry & entry = entries[line_idx];
+
+    int k = x / STRIDE;
+    Extend(entry, line, k + 1);
+
+    return Advance(line, entry.checkpoints[k], k * STRIDE, x);
+}
+
+int ColumnIndex::Index(int line_idx, StringView32 line, int column)
+{
+    if (column < 0) return 0;
+
+    Entry & entry = entries[line_idx];
+
+    int max_count = line.size() / STRIDE + 1;
+
+    Extend(entry, line, 1);
+    while (entry.checkpoints.back() <= column && entry.checkpoints.size() < max_count)
+    {
+        Extend(entry, line, entry.checkpoints.size() + 1);
+    }
+
+    Vector<int> const& checkpoints = entry.checkpoints;
+
+    int k = std::upper_bound(checkpoints.begin(), checkpoints.end(), column) - checkpoints.begin() - 1;
+
+    int count = checkpoints[k];
+    for (int idx = k * STRIDE; idx < line.size(); idx++)
+    {
+        if (line[idx] == U'\t') count += TabWidth(count);
+        else                    count++;
+
+        if (count > column) return idx;
+    }
+
+    return line.size();
+}
+
+int ColumnIndex::Width(int line_idx, StringView32 line)
+{
+    Entry & entry = entries[line_idx];
+    if (entry.width == -1) entry.width = Column(line_idx, line, line.size());
+
+    return entry.width;
+}
+
+int ColumnIndex::CachedWidth(int line_idx) const
+{
+    return entries[line_idx].width;
+}
@@ -0,0 +1,45 @@
+#ifndef COLUMNINDEX_HPP
+#define COLUMNINDEX_HPP
+
+#include "Vector.hpp"
+#include "StringView32.hpp"
+
+// Maps between character indices and tab adjusted columns without scanning from the start of the line
+class ColumnIndex
+{
+private:
+    static constexpr int STRIDE = 64;
+
+    struct Entry
+    {
+        // The column at every STRIDE characters, only the prefix that was needed so far is built
+        Vector<int> checkpoints;
+        int width = -1;
+    };
+
+    Vector<Entry> entries;
+
+    static int Advance(StringView32 line, int column, int first, int last);
+
+    void Extend(Entry & entry, StringView32 line, int count);
+
+public:
+    ColumnIndex() = default;
+
+    void Reset(int line_count);
+
+    void Insert(int line_idx, int count);
+    void Remove(int line_idx, int count);
+
+    // Characters before x are unchanged, so are the checkpoints up to it
+    void Invalidate(int line_idx, int x = 0);
+
+    int Column(int line_idx, StringView32 line, int x);
+    int Index(int line_idx, StringView32 line, int column);
+    int Width(int line_idx, StringView32 line);
+
+    // The width as of the last call to Width, -1 if the line changed since
+    int CachedWidth(int line_idx) const;
+};
+
+#endif // COLUMNINDEX_HPP
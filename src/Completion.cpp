@@ -0,0 +1,256 @@
+#include "Completion.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "HashSet.hpp"
+#include "NativeDatabase.hpp"
+#include "SpecialCharacters.hpp"
+
+bool Completion::Less(StringView32 lhs, StringView32 rhs)
+{
+    int size = std::min(lhs.size(), rhs.size());
+    for (int idx = 0; idx < size; idx++)
+    {
+        if (lhs[idx] == rhs[idx]) continue;
+
+        char32_t a = FoldCase(lhs[idx]);
+        char32_t b = FoldCase(rhs[idx]);
+
+        if (a != b) return a < b;
+    }
+
+    if (lhs.size() != rhs.size()) return lhs.size() < rhs.size();
+
+    return lhs < rhs;
+}
+
+int Completion::ComparePrefix(StringView32 name, StringView32 prefix)
+{
+    int size = std::min(name.size(), prefix.size());
+    for (int idx = 0; idx < size; idx++)
+    {
+        if (name[idx] == prefix[idx]) continue;
+
+        char32_t a = FoldCase(name[idx]);
+        char32_t b = FoldCase(prefix[idx]);
+
+        if (a != b) return a < b ? -1 : 1;
+    }
+
+    // A name shorter than the prefix sorts before everything starting with it
+    return name.size() < prefix.size() ? -1 : 0;
+}
+
+void Completion::PrefixRange(Vector<Entry> const& entries, StringView32 prefix, int & first, int & last)
+{
+    auto begin = std::partition_point(entries.begin(), entries.end(),
+        [prefix](Entry const& entry) { return ComparePrefix(entry.name, prefix) < 0; });
+
+    auto end = std::partition_point(begin, entries.end(),
+        [prefix](Entry const& entry) { return ComparePrefix(entry.name, prefix) == 0; });
+
+    first = begin - entries.begin();
+    last = end - entries.begin();
+}
+
+Completion::Entry * Completion::Find(Vector<Entry> & entries, StringView32 name)
+{
+    auto it = std::partition_point(entries.begin(), entries.end(),
+        [name](Entry const& entry) { return Less(entry.name, name); });
+
+    if (it == entries.end() || StringView32(it->name) != name) return nullptr;
+    return &*it;
+}
+
+void Completion::UpdateFuzzy()
+{
+    fuzzy.Clear();
+    fuzzy.Reserve(natives.size() + symbols.size(), 0);
+
+    for (Entry const& entry : natives)
+    {
+        fuzzy.Add(entry.name);
+    }
+
+    for (Entry const& entry : symbols)
+    {
+        fuzzy.Add(entry.name);
+    }
+}
+
+void Completion::SetNatives(NativeDatabase const& database)
+{
+    natives.clear();
+    natives.reserve(database.Count());
+
+    for (int idx = 0; idx < database.Count(); idx++)
+    {
+        NativeDatabase::Symbol symbol = database.At(idx);
+
+        Entry entry;
+        entry.name = symbol.Name();
+        entry.style = symbol.Style();
+        natives.push_back(std::move(entry));
+    }
+
+    std::sort(natives.begin(), natives.end(),
+        [](Entry const& lhs, Entry const& rhs) { return Less(lhs.name, rhs.name); });
+
+    UpdateFuzzy();
+}
+
+void Completion::SetSymbols(HashMap<String32, int> const& names)
+{
+    // A scrape usually finds the same names as the one before, so most entries stay where they are
+    // and there is nothing to add once every name was kept
+    int old_count = symbols.size();
+
+    int count = 0;
+    for (int idx = 0; idx < symbols.size(); idx++)
+    {
+        auto it = names.find(symbols[idx].name);
+        if (it == names.end()) continue;
+
+        symbols[idx].style = it->second;
+        if (count != idx) symbols[count] = std::move(symbols[idx]);
+        count++;
+    }
+    symbols.resize(count);
+
+    if (count == names.size())
+    {
+        if (count != old_count) UpdateFuzzy();
+        return;
+    }
+
+    HashSet<StringView32> kept;
+    kept.reserve(count);
+
+    for (Entry const& entry : symbols) kept.insert(entry.name);
+
+    Vector<Entry> added;
+    for (auto const& name : names)
+    {
+        if (kept.count(name.first) != 0) continue;
+
+        Entry entry;
+        entry.name = name.first;
+        entry.style = name.second;
+        added.push_back(std::move(entry));
+    }
+
+    auto pred = [](Entry const& lhs, Entry const& rhs) { return Less(lhs.name, rhs.name); };
+
+    std::sort(added.begin(), added.end(), pred);
+
+    Vector<Entry> merged;
+    merged.reserve(symbols.size() + added.size());
+
+    std::merge(std::make_move_iterator(symbols.begin()), std::make_move_iterator(symbols.end()),
+               std::make_move_iterator(added.begin()), std::make_move_iterator(added.end()),
+               std::back_inserter(merged), pred);
+
+    symbols = std::move(merged);
+
+    UpdateFuzzy();
+}
+
+int Completion::Count() const
+{
+    return natives.size() + symbols.size();
+}
+
+Vector<CompletionCandidate> Completion::Complete(StringView32 prefix, int count) const
+{
+    if (prefix.empty() || count <= 0) return {};
+
+    struct Ranked
+    {
+        Entry const* entry;
+
+        bool exact;
+        bool local;
+    };
+
+    auto better = [](Ranked const& lhs, Ranked const& rhs)
+    {
+        if (lhs.exact != rhs.exact) return lhs.exact;
+        if (lhs.entry->uses != rhs.entry->uses) return lhs.entry->uses > rhs.entry->uses;
+        if (lhs.local != rhs.local) return lhs.local;
+        if (lhs.entry->name.size() != rhs.entry->name.size()) return lhs.entry->name.size() < rhs.entry->name.size();
+        return Less(lhs.entry->name, rhs.entry->name);
+    };
+
+    // Only the best few are kept while going through the range, however large it is
+    Vector<Ranked> best;
+    best.reserve(count + 1);
+
+    auto rank = [&](Vector<Entry> const& entries, bool local)
+    {
+        int first, last;
+        PrefixRange(entries, prefix, first, last);
+
+        for (int idx = first; idx < last; idx++)
+        {
+            Entry const& entry = entries[idx];
+
+            // Exactly what was typed has nothing left to complete
+            if (entry.name.size() == prefix.size()) continue;
+
+            Ranked ranked;
+            ranked.entry = &entry;
+            ranked.exact = std::equal(prefix.begin(), prefix.end(), entry.name.begin());
+            ranked.local = local;
+
+            if (best.size() == count && !better(ranked, best.back())) continue;
+
+            // A buffer that declares a native again has it show up once, the buffer's one always ranks higher
+            if (!local && std::any_of(best.begin(), best.end(), [&](Ranked const& other) { return other.entry->name == entry.name; })) continue;
+
+            best.insert(std::upper_bound(best.begin(), best.end(), ranked, better), ranked);
+            if (best.size() > count) best.pop_back();
+        }
+    };
+
+    rank(symbols, true);
+    rank(natives, false);
+
+    // Names starting with the prefix were all ranked already, names that only match fuzzily come after them
+    Vector<FuzzyMatch> matches;
+    if (best.size() < count) matches = fuzzy.Match(prefix, count * 2);
+
+    for (FuzzyMatch const& match : matches)
+    {
+        if (best.size() == count) break;
+
+        bool local = match.candidate >= natives.size();
+
+        Entry const& entry = local ? symbols[match.candidate - natives.size()] : natives[match.candidate];
+        if (ComparePrefix(entry.name, prefix) == 0) continue;
+
+        if (std::any_of(best.begin(), best.end(), [&](Ranked const& other) { return other.entry->name == entry.name; })) continue;
+
+        Ranked ranked;
+        ranked.entry = &entry;
+        ranked.exact = false;
+        ranked.local = local;
+        best.push_back(ranked);
+    }
+
+    Vector<CompletionCandidate> candidates;
+    candidates.reserve(best.size());
+
+    for (Ranked const& ranked : best)
+    {
+        candidates.push_back({ ranked.entry->name, ranked.entry->style });
+    }
+
+    return candidates;
+}
+
+void Completion::Accept(StringView32 name)
+{
+    if (Entry * entry = Find(symbols, name)) entry->uses++;
+    if (Entry * entry = Find(natives, name)) entry->uses++;
+}
@@ -0,0 +1,66 @@
+#ifndef COMPLETION_HPP
+#define COMPLETION_HPP
+
+#include "FuzzyMatcher.hpp"
+#include "HashMap.hpp"
+#include "String32.hpp"
+#include "StringView32.hpp"
+#include "Vector.hpp"
+
+class NativeDatabase;
+
+struct CompletionCandidate
+{
+    String32 name;
+    int style;
+};
+
+// Names that can complete what is typed, from the natives and from the symbols scraped from the buffer.
+// Both are kept sorted ignoring case, so every name starting with a prefix is in one range found by binary search.
+class Completion
+{
+private:
+    struct Entry
+    {
+        String32 name;
+        int style;
+
+        // How often it was picked, picked names come first from then on
+        int uses = 0;
+    };
+
+    // The natives only change when the database does, the symbols change every time the buffer is scraped
+    Vector<Entry> natives;
+    Vector<Entry> symbols;
+
+    // The natives followed by the symbols, for when too few names start with what was typed
+    FuzzyMatcher fuzzy;
+
+    // Ignoring case first, so names differing only in case are next to each other
+    static bool Less(StringView32 lhs, StringView32 rhs);
+
+    // Compares the first prefix.size() characters of name to prefix, ignoring case
+    static int ComparePrefix(StringView32 name, StringView32 prefix);
+
+    static void PrefixRange(Vector<Entry> const& entries, StringView32 prefix, int & first, int & last);
+
+    static Entry * Find(Vector<Entry> & entries, StringView32 name);
+
+    void UpdateFuzzy();
+
+public:
+    void SetNatives(NativeDatabase const& database);
+
+    // Keeps the entries of names that are still there and merges in the new ones
+    void SetSymbols(HashMap<String32, int> const& names);
+
+    int Count() const;
+
+    // The best count names starting with prefix. Names matching its case, names picked before,
+    // names from the buffer and shorter names come first. The rest is filled with names that only match fuzzily.
+    Vector<CompletionCandidate> Complete(StringView32 prefix, int count) const;
+
+    void Accept(StringView32 name);
+};
+
+#endif // COMPLETION_HPP
@@ -2,12 +2,66 @@
 
 #include <QDebug>
 
+#include <QShortcut>
 #include <QWheelEvent>
 
+#include "BufferWidget.hpp"
 #include "Painter.hpp"
 
 Editor::Editor(QWidget * parent) :
     QMainWindow(parent)
 {
     setupUi(this);
+
+    search_results = new SearchResults(this);
+
+    search_dock = new QDockWidget("Find in Files", this);
+    search_dock->setObjectName("search_dock");
+    search_dock->setWidget(search_results);
+    search_dock->hide();
+
+    addDockWidget(Qt::BottomDockWidgetArea, search_dock);
+
+    QShortcut * find_in_files = new QShortcut(QKeySequence("Ctrl+Shift+F"), this);
+
+    connect(find_in_files, &QShortcut::activated,
+        [this](...)
+        {
+            search_dock->show();
+            search_results->Prompt();
+        }
+    );
+
+    connect(search_results, &SearchResults::MatchActivated,
+        [this](QString const& path, Cursor match)
+        {
+            buffer1->OpenLocation(path, match);
+        }
+    );
+
+    quick_open = new QuickOpen(this);
+
+    QShortcut * open_file = new QShortcut(QKeySequence("Ctrl+P"), this);
+    QShortcut * go_to_symbol = new QShortcut(QKeySequence("Ctrl+T"), this);
+
+    connect(open_file, &QShortcut::activated,
+        [this](...)
+        {
+            quick_open->PromptFile();
+        }
+    );
+
+    connect(go_to_symbol, &QShortcut::activated,
+        [this](...)
+        {
+            quick_open->PromptSymbol();
+        }
+    );
+
+    connect(quick_open, &QuickOpen::Activated,
+        [this](QString const& path, Cursor cursor)
+        {
+            buffer1->OpenLocation(path, cursor);
+        }
+    );
 }
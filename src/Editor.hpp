@@ -3,13 +3,21 @@
 
 #include "ui_Editor.h"
 
+#include <QDockWidget>
+
 #include "Buffer.hpp"
+#include "QuickOpen.hpp"
+#include "SearchResults.hpp"
 
 class Editor : public QMainWindow, private Ui::Editor
 {
     Q_OBJECT
 
 private:
+    QDockWidget * search_dock;
+    SearchResults * search_results;
+
+    QuickOpen * quick_open;
 
 public:
     explicit Editor(QWidget * parent = nullptr);
@@ -0,0 +1,87 @@
+#include "FrameScheduler.hpp"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QtGlobal>
+
+namespace
+{
+    constexpr int LOG_INTERVAL = 120;
+}
+
+void FrameScheduler::Tick()
+{
+    last_frame = clock.nsecsElapsed();
+
+    qint64 frame_input = input_time;
+    input_time = -1;
+
+    // Input that led to nothing to paint isn't waited for, the next paint could be an unrelated expose
+    if (frame() && frame_input_time == -1) frame_input_time = frame_input;
+}
+
+FrameScheduler::FrameScheduler(QObject * parent, std::function<bool()> frame) : timer(parent), frame(std::move(frame))
+{
+    log_latency = qEnvironmentVariableIsSet("EDITOR_FRAME_LATENCY");
+
+    qreal refresh_rate = 60.0;
+
+    QScreen * screen = QGuiApplication::primaryScreen();
+    if (screen != nullptr && screen->refreshRate() > 0.0) refresh_rate = screen->refreshRate();
+
+    frame_interval = (qint64)(1000000000.0 / refresh_rate);
+
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+
+    QObject::connect(&timer, &QTimer::timeout, [this] { Tick(); });
+
+    clock.start();
+}
+
+void FrameScheduler::Schedule()
+{
+    qint64 now = clock.nsecsElapsed();
+
+    if (input_time == -1) input_time = now;
+
+    if (timer.isActive()) return;
+
+    qint64 wait = std::max<qint64>(0, last_frame + frame_interval - now);
+    timer.start((int)(wait / 1000000));
+}
+
+void FrameScheduler::Presented()
+{
+    if (frame_input_time == -1) return;
+
+    qint64 latency = clock.nsecsElapsed() - frame_input_time;
+    frame_input_time = -1;
+
+    latency_count++;
+    latency_total += latency;
+    latency_max = std::max(latency_max, latency);
+
+    if (!log_latency || latency_count < LOG_INTERVAL) return;
+
+    qDebug() << "Input to paint over" << latency_count << "frames:" << AverageLatency() << "ms average," << MaximumLatency() << "ms worst";
+
+    latency_count = 0;
+    latency_total = 0;
+    latency_max = 0;
+}
+
+double FrameScheduler::AverageLatency() const
+{
+    if (latency_count == 0) return 0.0;
+
+    return (double)latency_total / latency_count / 1000000.0;
+}
+
+double FrameScheduler::MaximumLatency() const
+{
+    return (double)latency_max / 1000000.0;
+}
@@ -0,0 +1,47 @@
+#ifndef FRAMESCHEDULER_HPP
+#define FRAMESCHEDULER_HPP
+
+#include <functional>
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// Runs the frame callback at most once per display refresh no matter how much input arrives in between
+class FrameScheduler
+{
+private:
+    QTimer timer;
+    QElapsedTimer clock;
+
+    // Returns whether the frame asked for a repaint, only then the input it covers is waited for in Presented
+    std::function<bool()> frame;
+
+    qint64 frame_interval;
+    qint64 last_frame = 0;
+
+    // Time of the oldest input that hasn't reached a frame yet, and of the one waiting to be painted
+    qint64 input_time = -1;
+    qint64 frame_input_time = -1;
+
+    // Logged and started over every LOG_INTERVAL frames when EDITOR_FRAME_LATENCY is set
+    bool log_latency = false;
+
+    int latency_count = 0;
+    qint64 latency_total = 0;
+    qint64 latency_max = 0;
+
+    void Tick();
+
+public:
+    FrameScheduler(QObject * parent, std::function<bool()> frame);
+
+    void Schedule();
+    void Presented();
+
+    // Input to end of paint, in milliseconds
+    double AverageLatency() const;
+    double MaximumLatency() const;
+};
+
+#endif // FRAMESCHEDULER_HPP
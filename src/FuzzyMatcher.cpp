@@ -0,0 +1,402 @@
+#include "FuzzyMatcher.hpp"
+
+#include <algorithm>
+
+#include "Grep.hpp"
+#include "Simd.hpp"
+#include "SpecialCharacters.hpp"
+#include "ThreadPool.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    constexpr int SCORE_MATCH = 16;
+    constexpr int SCORE_GAP_START = -3;
+    constexpr int SCORE_GAP_EXTENSION = -1;
+
+    constexpr int BONUS_BOUNDARY = SCORE_MATCH / 2;
+    constexpr int BONUS_BOUNDARY_WHITE = BONUS_BOUNDARY + 2;
+    constexpr int BONUS_BOUNDARY_DELIMITER = BONUS_BOUNDARY + 1;
+    constexpr int BONUS_NONWORD = SCORE_MATCH / 2;
+    constexpr int BONUS_CAMEL = BONUS_BOUNDARY + SCORE_GAP_EXTENSION;
+    constexpr int BONUS_CONSECUTIVE = -(SCORE_GAP_START + SCORE_GAP_EXTENSION);
+    constexpr int BONUS_FIRST_CHAR_MULTIPLIER = 2;
+
+    // Loads read up to this many bytes past the end of a candidate
+    constexpr int PADDING = 16;
+
+    enum CharClass
+    {
+        CHAR_WHITE,
+        CHAR_DELIMITER,
+        CHAR_NONWORD,
+        CHAR_LOWER,
+        CHAR_UPPER,
+        CHAR_NUMBER
+    };
+
+    struct Pattern
+    {
+        Vector<std::uint8_t> bytes;
+
+        // 0x20 where a letter is compared ignoring case, or'ed into the candidate so its upper case letters become lower case
+        Vector<std::uint8_t> folds;
+
+        std::uint64_t mask = 0;
+    };
+
+    // Bytes of characters outside ASCII count as lower case letters
+    constexpr CharClass ClassOf(std::uint8_t byte)
+    {
+        if (byte >= 'a' && byte <= 'z') return CHAR_LOWER;
+        if (byte >= 'A' && byte <= 'Z') return CHAR_UPPER;
+        if (byte >= '0' && byte <= '9') return CHAR_NUMBER;
+        if (byte >= 0x80)               return CHAR_LOWER;
+
+        switch (byte)
+        {
+        case ' ':
+        case '\t':
+            return CHAR_WHITE;
+
+        case '/':
+        case '\\':
+        case '_':
+        case '.':
+        case '-':
+        case ':':
+        case ',':
+        case ';':
+        case '|':
+            return CHAR_DELIMITER;
+        }
+
+        return CHAR_NONWORD;
+    }
+
+    constexpr int Bonus(CharClass prev, CharClass cur)
+    {
+        if (cur > CHAR_NONWORD)
+        {
+            if (prev == CHAR_WHITE)     return BONUS_BOUNDARY_WHITE;
+            if (prev == CHAR_DELIMITER) return BONUS_BOUNDARY_DELIMITER;
+            if (prev == CHAR_NONWORD)   return BONUS_BOUNDARY;
+        }
+
+        if (prev == CHAR_LOWER && cur == CHAR_UPPER)   return BONUS_CAMEL;
+        if (prev != CHAR_NUMBER && cur == CHAR_NUMBER) return BONUS_CAMEL;
+
+        if (cur == CHAR_WHITE) return BONUS_BOUNDARY_WHITE;
+        if (cur != CHAR_LOWER && cur != CHAR_UPPER && cur != CHAR_NUMBER) return BONUS_NONWORD;
+
+        return 0;
+    }
+
+    // Scoring looks both up for every byte of the match, so they are worked out once up front
+    struct Tables
+    {
+        CharClass classes[256] = {};
+        int bonuses[CHAR_NUMBER + 1][CHAR_NUMBER + 1] = {};
+
+        constexpr Tables()
+        {
+            for (int byte = 0; byte < 256; byte++)
+            {
+                classes[byte] = ClassOf(byte);
+            }
+
+            for (int prev = 0; prev <= CHAR_NUMBER; prev++)
+            {
+                for (int cur = 0; cur <= CHAR_NUMBER; cur++)
+                {
+                    bonuses[prev][cur] = Bonus(CharClass(prev), CharClass(cur));
+                }
+            }
+        }
+    };
+
+    constexpr Tables TABLES;
+
+    Pattern Prepare(StringView32 pattern)
+    {
+        Pattern prepared;
+        for (char32_t ch : pattern)
+        {
+            EncodeUtf8(ch, prepared.bytes);
+        }
+
+        bool match_case = std::any_of(prepared.bytes.begin(), prepared.bytes.end(),
+            [](std::uint8_t byte) { return byte >= 'A' && byte <= 'Z'; });
+
+        for (std::uint8_t byte : prepared.bytes)
+        {
+            bool fold = !match_case && byte >= 'a' && byte <= 'z';
+            prepared.folds.push_back(fold ? 0x20 : 0);
+
+            prepared.mask |= std::uint64_t(1) << (FoldAscii(byte) & 63);
+        }
+
+        return prepared;
+    }
+
+    int LowestSetBit(unsigned int mask)
+    {
+#ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanForward(&idx, mask);
+        return idx;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    // The first place from pos on where the byte is, -1 if it isn't before end
+    int FindByte(std::uint8_t const* data, int pos, int end, std::uint8_t byte, std::uint8_t fold)
+    {
+#ifdef HAVE_SSE2
+        __m128i needle = _mm_set1_epi8((char)byte);
+        __m128i folds = _mm_set1_epi8((char)fold);
+
+        // Lanes past end come after every lane before it, so the lowest set lane is the one to check
+        for (; pos < end; pos += 16)
+        {
+            __m128i chunk = _mm_or_si128(_mm_loadu_si128((__m128i const*)(data + pos)), folds);
+
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+            if (mask == 0) continue;
+
+            int lane = LowestSetBit(mask);
+            return pos + lane < end ? pos + lane : -1;
+        }
+#else
+        for (; pos < end; pos++)
+        {
+            if ((data[pos] | fold) == byte) return pos;
+        }
+#endif
+
+        return -1;
+    }
+
+    int ScoreCandidate(std::uint8_t const* data, int size, Pattern const& pattern)
+    {
+        int count = pattern.bytes.size();
+        if (count == 0) return 0;
+
+        // Forward to the first place the whole pattern has been seen
+        int pos = 0;
+        for (int pidx = 0; pidx < count; pidx++)
+        {
+            pos = FindByte(data, pos, size, pattern.bytes[pidx], pattern.folds[pidx]);
+            if (pos < 0) return -1;
+
+            pos++;
+        }
+
+        int last = pos - 1;
+
+        // Then back to the last place it can start, which gives the shortest match ending there
+        int first = last;
+        for (int pidx = count - 1; ; first--)
+        {
+            if ((data[first] | pattern.folds[pidx]) != pattern.bytes[pidx]) continue;
+            if (pidx == 0) break;
+
+            pidx--;
+        }
+
+        // The matched characters of the window are found again, so only they and the gaps between them are looked at
+        int score = 0;
+        int first_bonus = 0;
+
+        pos = first;
+        for (int pidx = 0; pidx < count; pidx++)
+        {
+            int prev_pos = pos;
+            if (pidx != 0) pos = FindByte(data, pos + 1, last + 1, pattern.bytes[pidx], pattern.folds[pidx]);
+
+            CharClass prev = pos > 0 ? TABLES.classes[data[pos - 1]] : CHAR_WHITE;
+            CharClass cur = TABLES.classes[data[pos]];
+
+            int bonus = TABLES.bonuses[prev][cur];
+
+            // A run keeps the bonus it started with, unless a word starts within it
+            if (pidx == 0 || pos != prev_pos + 1)
+            {
+                if (pidx != 0) score += SCORE_GAP_START + (pos - prev_pos - 2) * SCORE_GAP_EXTENSION;
+                first_bonus = bonus;
+            }
+            else
+            {
+                if (bonus >= BONUS_BOUNDARY && bonus > first_bonus) first_bonus = bonus;
+                bonus = std::max({ bonus, first_bonus, BONUS_CONSECUTIVE });
+            }
+
+            score += SCORE_MATCH;
+            score += pidx == 0 ? bonus * BONUS_FIRST_CHAR_MULTIPLIER : bonus;
+        }
+
+        // Long gaps can cost more than the matches score, it still is a match
+        return std::max(0, score);
+    }
+}
+
+FuzzyMatcher::FuzzyMatcher()
+{
+    Clear();
+}
+
+void FuzzyMatcher::Clear()
+{
+    text.assign(PADDING, 0);
+    offsets.assign(1, 0);
+    masks.clear();
+
+    version++;
+}
+
+void FuzzyMatcher::Reserve(int count, int bytes)
+{
+    text.reserve(bytes + PADDING);
+    offsets.reserve(count + 1);
+    masks.reserve(count);
+}
+
+void FuzzyMatcher::Add(StringView32 candidate)
+{
+    text.resize(offsets.back());
+
+    for (char32_t ch : candidate)
+    {
+        EncodeUtf8(ch, text);
+    }
+
+    std::uint64_t mask = 0;
+    for (int idx = offsets.back(); idx < text.size(); idx++)
+    {
+        mask |= std::uint64_t(1) << (FoldAscii(text[idx]) & 63);
+    }
+
+    offsets.push_back(text.size());
+    masks.push_back(mask);
+
+    text.resize(text.size() + PADDING, 0);
+
+    version++;
+}
+
+int FuzzyMatcher::Count() const
+{
+    return masks.size();
+}
+
+int FuzzyMatcher::Score(int candidate, StringView32 pattern) const
+{
+    Pattern prepared = Prepare(pattern);
+    if ((prepared.mask & ~masks[candidate]) != 0) return -1;
+
+    return ScoreCandidate(text.data() + offsets[candidate], offsets[candidate + 1] - offsets[candidate], prepared);
+}
+
+Vector<FuzzyMatch> FuzzyMatcher::Match(StringView32 pattern, int count, FuzzyFilter * filter) const
+{
+    Vector<FuzzyMatch> best;
+    if (count <= 0) return best;
+
+    Pattern prepared = Prepare(pattern);
+
+    // Whatever matches the longer pattern also matches the one it starts with, even when only the longer one has to match case
+    bool narrowed = filter != nullptr && filter->version == version && filter->pattern.size() <= pattern.size() &&
+                    std::equal(filter->pattern.begin(), filter->pattern.end(), pattern.begin());
+
+    int candidate_count = narrowed ? filter->candidates.size() : Count();
+
+    auto candidate_at = [&](int idx) { return narrowed ? filter->candidates[idx] : idx; };
+
+    auto better = [this](FuzzyMatch const& lhs, FuzzyMatch const& rhs)
+    {
+        if (lhs.score != rhs.score) return lhs.score > rhs.score;
+
+        int lhs_size = offsets[lhs.candidate + 1] - offsets[lhs.candidate];
+        int rhs_size = offsets[rhs.candidate + 1] - offsets[rhs.candidate];
+
+        if (lhs_size != rhs_size) return lhs_size < rhs_size;
+        return lhs.candidate < rhs.candidate;
+    };
+
+    // Only the best few are kept, however many candidates match
+    auto keep = [&](Vector<FuzzyMatch> & ranked, FuzzyMatch match)
+    {
+        if (ranked.size() == count && !better(match, ranked.back())) return;
+
+        ranked.insert(std::upper_bound(ranked.begin(), ranked.end(), match, better), match);
+        if (ranked.size() > count) ranked.pop_back();
+    };
+
+    auto rank = [&](int first, int last, Vector<FuzzyMatch> & ranked, Vector<int> & matched)
+    {
+        for (int idx = first; idx < last; idx++)
+        {
+            int candidate = candidate_at(idx);
+            if ((prepared.mask & ~masks[candidate]) != 0) continue;
+
+            int score = ScoreCandidate(text.data() + offsets[candidate], offsets[candidate + 1] - offsets[candidate], prepared);
+            if (score < 0) continue;
+
+            keep(ranked, { candidate, score });
+            if (filter != nullptr) matched.push_back(candidate);
+        }
+    };
+
+    ThreadPool & pool = ThreadPool::Instance();
+
+    int chunk_size = std::max(16384, candidate_count / (pool.ThreadCount() * 4));
+    int chunk_count = (candidate_count + chunk_size - 1) / chunk_size;
+
+    Vector<int> matched;
+
+    if (chunk_count <= 1 || pool.ThreadCount() == 1)
+    {
+        rank(0, candidate_count, best, matched);
+    }
+    else
+    {
+        Vector<Vector<FuzzyMatch>> chunks(chunk_count);
+        Vector<Vector<int>> chunk_matches(chunk_count);
+
+        pool.ParallelFor(chunk_count,
+            [&](int idx)
+            {
+                int first = idx * chunk_size;
+                int last = std::min(first + chunk_size, candidate_count);
+
+                rank(first, last, chunks[idx], chunk_matches[idx]);
+            }
+        );
+
+        for (Vector<FuzzyMatch> const& chunk : chunks)
+        {
+            for (FuzzyMatch match : chunk)
+            {
+                keep(best, match);
+            }
+        }
+
+        for (Vector<int> const& chunk : chunk_matches)
+        {
+            matched.insert(matched.end(), chunk.begin(), chunk.end());
+        }
+    }
+
+    if (filter != nullptr)
+    {
+        filter->pattern = pattern;
+        filter->candidates = std::move(matched);
+        filter->version = version;
+    }
+
+    return best;
+}
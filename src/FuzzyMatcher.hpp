@@ -0,0 +1,61 @@
+#ifndef FUZZYMATCHER_HPP
+#define FUZZYMATCHER_HPP
+
+#include <cstdint>
+
+#include "String32.hpp"
+#include "StringView32.hpp"
+#include "Vector.hpp"
+
+struct FuzzyMatch
+{
+    int candidate;
+    int score;
+};
+
+// What a pattern matched in one matcher, so a longer pattern starting with it only has to look at those candidates
+struct FuzzyFilter
+{
+    String32 pattern;
+    Vector<int> candidates;
+
+    // The candidates the filter was made from, it is ignored once they changed
+    int version = -1;
+};
+
+// Ranks candidates by how well a pattern matches them as a subsequence, scored like fzf: characters at the start of a word,
+// after a separator or on a camel case hump score more, gaps cost and consecutive characters make up for them.
+// Candidates are packed one after the other as UTF-8. Only ASCII is folded, and a pattern with an upper case letter has to match case.
+class FuzzyMatcher
+{
+private:
+    Vector<std::uint8_t> text;
+
+    // Where every candidate starts, followed by where the last one ends
+    Vector<int> offsets;
+
+    // A bit for every byte the candidate has, folded and modulo 64, so most candidates are rejected without reading them
+    Vector<std::uint64_t> masks;
+
+    // Changes with every candidate, so a filter can tell whether it still fits
+    int version = 0;
+
+public:
+    FuzzyMatcher();
+
+    void Clear();
+    void Reserve(int count, int bytes);
+
+    void Add(StringView32 candidate);
+
+    int Count() const;
+
+    // The score of one candidate, -1 if the pattern doesn't match it
+    int Score(int candidate, StringView32 pattern) const;
+
+    // The best count candidates, best first. Ties go to the shorter candidate, then to the one added first.
+    // Given a filter, only what it kept is looked at if the pattern extends its pattern, and it is updated to the new one.
+    Vector<FuzzyMatch> Match(StringView32 pattern, int count, FuzzyFilter * filter = nullptr) const;
+};
+
+#endif // FUZZYMATCHER_HPP
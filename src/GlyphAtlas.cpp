@@ -0,0 +1,182 @@
+#include "GlyphAtlas.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#include <QFontInfo>
+#include <QVector>
+
+#include "SpecialCharacters.hpp"
+
+namespace
+{
+    String32 FontKey(QString const& family, bool bold, bool italic)
+    {
+        String32 key = family.toLower().toStdU32String();
+        key += bold   ? U'B' : U'R';
+        key += italic ? U'I' : U'N';
+        return key;
+    }
+
+    QRgb Blend(QRgb dst, QRgb src, std::uint32_t alpha)
+    {
+        std::uint32_t inverse = 255 - alpha;
+
+        std::uint32_t rb = (((src & 0x00ff00ff) * alpha + (dst & 0x00ff00ff) * inverse) >> 8) & 0x00ff00ff;
+        std::uint32_t ag = (((src >> 8) & 0x00ff00ff) * alpha + ((dst >> 8) & 0x00ff00ff) * inverse) & 0xff00ff00;
+
+        return rb | ag;
+    }
+}
+
+int GlyphAtlas::Rasterize(char32_t ch)
+{
+    if (IsSpace(ch)) return SLOT_BLANK;
+
+    if (!raw_font.supportsCharacter(ch)) return SLOT_MISSING;
+
+    QVector<quint32> glyphs = raw_font.glyphIndexesForString(QString::fromUcs4(&ch, 1));
+    if (glyphs.size() != 1 || glyphs[0] == 0) return SLOT_MISSING;
+
+    QImage bitmap = raw_font.alphaMapForGlyph(glyphs[0], QRawFont::PixelAntialiasing);
+    if (bitmap.isNull()) return SLOT_BLANK;
+
+    // NOTE@Daniel:
+    //  The alpha map is usually an 8 bit indexed image whose index is the coverage, anything else gets converted
+    if (bitmap.format() != QImage::Format_Indexed8 && bitmap.format() != QImage::Format_Alpha8)
+    {
+        bitmap = bitmap.convertToFormat(QImage::Format_Alpha8);
+    }
+
+    QRectF bounds = raw_font.boundingRect(glyphs[0]);
+
+    int width = cell_size.width();
+    int height = cell_size.height();
+
+    int slot = slot_count++;
+    if ((slot / SLOTS_PER_ROW + 1) * height > atlas.height())
+    {
+        QImage grown(atlas.width(), atlas.height() * 2, QImage::Format_Alpha8);
+        grown.fill(0);
+
+        for (int y = 0; y < atlas.height(); y++)
+        {
+            std::memcpy(grown.scanLine(y), atlas.constScanLine(y), atlas.width());
+        }
+
+        atlas = std::move(grown);
+    }
+
+    int slot_x = (slot % SLOTS_PER_ROW) * width;
+    int slot_y = (slot / SLOTS_PER_ROW) * height;
+
+    int left = (int)std::floor(bounds.x());
+    int top  = baseline + (int)std::floor(bounds.y());
+
+    for (int row = 0; row < bitmap.height(); row++)
+    {
+        int y = top + row;
+        if (y < 0 || y >= height) continue;
+
+        uchar const* src = bitmap.constScanLine(row);
+        uchar * dst = atlas.scanLine(slot_y + y) + slot_x;
+
+        for (int col = 0; col < bitmap.width(); col++)
+        {
+            int x = left + col;
+            if (x < 0 || x >= width) continue;
+
+            dst[x] = src[col];
+        }
+    }
+
+    return slot;
+}
+
+int GlyphAtlas::Slot(char32_t ch)
+{
+    if (ch < latin_slots.size())
+    {
+        int & slot = latin_slots[ch];
+        if (slot == SLOT_UNKNOWN) slot = Rasterize(ch);
+
+        return slot;
+    }
+
+    auto it = glyph_slots.find(ch);
+    if (it != glyph_slots.end()) return it->second;
+
+    int slot = Rasterize(ch);
+    glyph_slots[ch] = slot;
+    return slot;
+}
+
+GlyphAtlas::GlyphAtlas(QFont const& font, QSize cell_size, int baseline) : cell_size(cell_size), baseline(baseline)
+{
+    latin_slots.fill(SLOT_UNKNOWN);
+
+    if (cell_size.isEmpty()) return;
+
+    raw_font = QRawFont::fromFont(font);
+    if (!raw_font.isValid()) return;
+
+    atlas = QImage(cell_size.width() * SLOTS_PER_ROW, cell_size.height() * 4, QImage::Format_Alpha8);
+    atlas.fill(0);
+}
+
+GlyphAtlas & GlyphAtlas::Find(QFont const& font, QSize cell_size, int baseline)
+{
+    static HashMap<String32, std::unique_ptr<GlyphAtlas>> atlases;
+
+    QFontInfo info(font);
+
+    String32 key = FontKey(info.family(), info.bold(), info.italic());
+    key += QString(":%1:%2x%3:%4").arg(info.pixelSize()).arg(cell_size.width()).arg(cell_size.height()).arg(baseline).toStdU32String();
+
+    std::unique_ptr<GlyphAtlas> & atlas = atlases[key];
+    if (!atlas) atlas.reset(new GlyphAtlas(font, cell_size, baseline));
+
+    return *atlas;
+}
+
+bool GlyphAtlas::IsValid() const
+{
+    return raw_font.isValid();
+}
+
+QSize const& GlyphAtlas::CellSize() const
+{
+    return cell_size;
+}
+
+bool GlyphAtlas::Draw(QImage & target, QRect const& clip, int x, int y, char32_t ch, QRgb color)
+{
+    int slot = Slot(ch);
+    if (slot == SLOT_MISSING) return false;
+    if (slot == SLOT_BLANK)   return true;
+
+    QRect cell = QRect(QPoint(x, y), cell_size) & clip & target.rect();
+    if (cell.isEmpty()) return true;
+
+    int slot_x = (slot % SLOTS_PER_ROW) * cell_size.width()  + cell.x() - x;
+    int slot_y = (slot / SLOTS_PER_ROW) * cell_size.height() + cell.y() - y;
+
+    color |= 0xff000000;
+
+    for (int row = 0; row < cell.height(); row++)
+    {
+        uchar const* coverage = atlas.constScanLine(slot_y + row) + slot_x;
+        QRgb * dst = reinterpret_cast<QRgb *>(target.scanLine(cell.y() + row)) + cell.x();
+
+        for (int col = 0; col < cell.width(); col++)
+        {
+            std::uint32_t alpha = coverage[col];
+
+            if (alpha == 0)   continue;
+            if (alpha == 255) dst[col] = color;
+            else              dst[col] = Blend(dst[col], color, alpha);
+        }
+    }
+
+    return true;
+}
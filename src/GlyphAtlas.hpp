@@ -0,0 +1,58 @@
+#ifndef GLYPHATLAS_HPP
+#define GLYPHATLAS_HPP
+
+#include <array>
+#include <memory>
+
+#include <QFont>
+#include <QImage>
+#include <QRawFont>
+#include <QSize>
+
+#include "HashMap.hpp"
+#include "String32.hpp"
+
+// Rasterizes glyphs of a monospace font once into fixed size cells and blends them straight into a QImage
+class GlyphAtlas
+{
+private:
+    static constexpr int SLOTS_PER_ROW = 32;
+
+    static constexpr int SLOT_MISSING = -1;
+    static constexpr int SLOT_BLANK   = -2;
+    static constexpr int SLOT_UNKNOWN = -3;
+
+    QRawFont raw_font;
+
+    QSize cell_size;
+    int baseline;
+
+    QImage atlas;
+    int slot_count = 0;
+
+    std::array<int, 256> latin_slots;
+    HashMap<char32_t, int> glyph_slots;
+
+    int Rasterize(char32_t ch);
+    int Slot(char32_t ch);
+
+    GlyphAtlas(GlyphAtlas const& other) = delete;
+    GlyphAtlas(GlyphAtlas && other) = delete;
+
+    GlyphAtlas & operator=(GlyphAtlas const& other) = delete;
+    GlyphAtlas & operator=(GlyphAtlas && other) = delete;
+
+public:
+    GlyphAtlas(QFont const& font, QSize cell_size, int baseline);
+
+    static GlyphAtlas & Find(QFont const& font, QSize cell_size, int baseline);
+
+    bool IsValid() const;
+
+    QSize const& CellSize() const;
+
+    // Returns false if the glyph isn't in the font and has to be drawn some other way
+    bool Draw(QImage & target, QRect const& clip, int x, int y, char32_t ch, QRgb color);
+};
+
+#endif // GLYPHATLAS_HPP
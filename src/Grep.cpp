@@ -0,0 +1,311 @@
+#include "Grep.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#include "HashSet.hpp"
+#include "Simd.hpp"
+#include "SpecialCharacters.hpp"
+#include "ThreadPool.hpp"
+
+namespace
+{
+    std::uint8_t UpperAscii(std::uint8_t byte)
+    {
+        return byte >= 'a' && byte <= 'z' ? byte - ('a' - 'A') : byte;
+    }
+}
+
+void EncodeUtf8(char32_t ch, Vector<std::uint8_t> & bytes)
+{
+    if (ch < 0x80)
+    {
+        bytes.push_back(ch);
+    }
+    else if (ch < 0x800)
+    {
+        bytes.push_back(0xC0 | (ch >> 6));
+        bytes.push_back(0x80 | (ch & 0x3F));
+    }
+    else if (ch < 0x10000)
+    {
+        bytes.push_back(0xE0 | (ch >> 12));
+        bytes.push_back(0x80 | ((ch >> 6) & 0x3F));
+        bytes.push_back(0x80 | (ch & 0x3F));
+    }
+    else
+    {
+        bytes.push_back(0xF0 | (ch >> 18));
+        bytes.push_back(0x80 | ((ch >> 12) & 0x3F));
+        bytes.push_back(0x80 | ((ch >> 6) & 0x3F));
+        bytes.push_back(0x80 | (ch & 0x3F));
+    }
+}
+
+bool IsTextFile(QString const& path)
+{
+    // Scripts and the text data that goes with them, binary files would only add noise
+    static HashSet<String32> const suffixes =
+    {
+        U"j", U"vj", U"ai", U"zn", U"lua", U"txt", U"slk", U"fdf", U"toc", U"ini", U"wts", U"csv", U"xml", U"json", U"md"
+    };
+
+    return suffixes.count(QFileInfo(path).suffix().toLower().toStdU32String()) != 0;
+}
+
+Needle::Needle(Search const& search)
+{
+    match_case = search.Flags() & SEARCH_MATCH_CASE;
+
+    for (String32 const& literal : search.Literals())
+    {
+        Vector<std::uint8_t> run;
+
+        auto finish = [&]
+        {
+            if (run.size() > bytes.size()) bytes = run;
+            run.clear();
+        };
+
+        for (char32_t ch : literal)
+        {
+            // Other cases of a character outside ASCII are different bytes altogether, so are the ones that fold to ASCII
+            if (!match_case && (ch >= 0x80 || HasFoldVariants(ch)))
+            {
+                finish();
+                continue;
+            }
+
+            EncodeUtf8(ch, run);
+        }
+
+        finish();
+    }
+
+    if (!match_case)
+    {
+        for (std::uint8_t & byte : bytes) byte = FoldAscii(byte);
+    }
+}
+
+bool Needle::MatchesAt(std::uint8_t const* data) const
+{
+    if (match_case) return std::memcmp(data, bytes.data(), bytes.size()) == 0;
+
+    for (int idx = 0; idx < bytes.size(); idx++)
+    {
+        if (FoldAscii(data[idx]) != bytes[idx]) return false;
+    }
+    return true;
+}
+
+bool Needle::IsEmpty() const
+{
+    return bytes.empty();
+}
+
+std::int64_t Needle::Find(std::uint8_t const* data, std::int64_t size) const
+{
+    std::int64_t count = bytes.size();
+    if (count == 0) return size > 0 ? 0 : -1;
+
+    // The last place the needle can start at
+    std::int64_t end = size - count;
+
+    std::uint8_t first[2] = { bytes.front(), match_case ? bytes.front() : UpperAscii(bytes.front()) };
+    std::uint8_t last[2]  = { bytes.back(),  match_case ? bytes.back()  : UpperAscii(bytes.back())  };
+
+    std::int64_t idx = 0;
+
+#ifdef HAVE_SSE2
+    __m128i first0 = _mm_set1_epi8((char)first[0]);
+    __m128i first1 = _mm_set1_epi8((char)first[1]);
+    __m128i last0  = _mm_set1_epi8((char)last[0]);
+    __m128i last1  = _mm_set1_epi8((char)last[1]);
+
+    // Sixteen candidates at a time, only the ones with the right bytes at both ends are compared in full
+    for (; idx + 15 <= end; idx += 16)
+    {
+        __m128i head = _mm_loadu_si128((__m128i const*)(data + idx));
+        __m128i tail = _mm_loadu_si128((__m128i const*)(data + idx + count - 1));
+
+        __m128i head_eq = _mm_or_si128(_mm_cmpeq_epi8(head, first0), _mm_cmpeq_epi8(head, first1));
+        __m128i tail_eq = _mm_or_si128(_mm_cmpeq_epi8(tail, last0), _mm_cmpeq_epi8(tail, last1));
+
+        int mask = _mm_movemask_epi8(_mm_and_si128(head_eq, tail_eq));
+
+        for (int lane = 0; mask != 0; lane++, mask >>= 1)
+        {
+            if ((mask & 1) && MatchesAt(data + idx + lane)) return idx + lane;
+        }
+    }
+#endif
+
+    for (; idx <= end; idx++)
+    {
+        std::uint8_t head = data[idx];
+        std::uint8_t tail = data[idx + count - 1];
+
+        if (head != first[0] && head != first[1]) continue;
+        if (tail != last[0] && tail != last[1]) continue;
+
+        if (MatchesAt(data + idx)) return idx;
+    }
+
+    return -1;
+}
+
+void GrepLines(QString const& path, std::uint8_t const* data, std::int64_t begin, std::int64_t end, int first_line,
+               Search const& search, Search::Cache & cache, Needle const& needle, Vector<FileMatch> & matches)
+{
+    Vector<Cursor> line_matches;
+
+    int line_idx = first_line;
+    std::int64_t line_start = begin;
+
+    while (line_start < end)
+    {
+        std::int64_t hit = line_start;
+        if (!needle.IsEmpty())
+        {
+            std::int64_t offset = needle.Find(data + line_start, end - line_start);
+            if (offset == -1) return;
+
+            hit = line_start + offset;
+        }
+
+        // Lines skipped over still have to be counted
+        for (;;)
+        {
+            void const* newline = std::memchr(data + line_start, '\n', hit - line_start);
+            if (newline == nullptr) break;
+
+            line_start = (std::uint8_t const*)newline - data + 1;
+            line_idx++;
+        }
+
+        void const* newline = std::memchr(data + hit, '\n', end - hit);
+
+        std::int64_t line_end = newline != nullptr ? (std::uint8_t const*)newline - data : end;
+        std::int64_t next = line_end + 1;
+
+        if (line_end > line_start && data[line_end - 1] == '\r') line_end--;
+
+        String32 line = QString::fromUtf8((char const*)data + line_start, line_end - line_start).toStdU32String();
+
+        line_matches.clear();
+        search.FindAll(line, line_idx, line_matches, cache);
+
+        for (Cursor const& match : line_matches)
+        {
+            FileMatch result;
+            result.path = path;
+            result.match = match;
+            result.line = line;
+            matches.push_back(std::move(result));
+        }
+
+        line_start = next;
+        line_idx++;
+    }
+}
+
+void FileSearch::SearchFile(std::shared_ptr<State> const& state, QString const& path)
+{
+    if (state->cancelled) return;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    std::int64_t size = file.size();
+    std::uint8_t const* data = size > 0 ? file.map(0, size) : nullptr;
+    if (data == nullptr) return;
+
+    Search::Cache cache;
+
+    Vector<FileMatch> matches;
+    GrepLines(path, data, 0, size, 0, state->search, cache, state->needle, matches);
+
+    file.unmap((uchar *)data);
+
+    state->files_searched++;
+
+    if (matches.empty()) return;
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    std::move(matches.begin(), matches.end(), std::back_inserter(state->found));
+}
+
+FileSearch::~FileSearch()
+{
+    Cancel();
+}
+
+void FileSearch::Start(QString const& directory, Search const& search)
+{
+    Cancel();
+
+    state = std::make_shared<State>();
+    state->search = search;
+    state->needle = Needle(search);
+    state->pending = 1;
+
+    std::shared_ptr<State> shared = state;
+
+    // Walking a big tree takes a while as well, so it runs on the pool and every file is searched as soon as it is found.
+    // The files queue up on the walking thread and the other threads take them from there.
+    ThreadPool::Instance().Submit(
+        [shared, directory]
+        {
+            QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext() && !shared->cancelled)
+            {
+                QString path = it.next();
+                if (!IsTextFile(path)) continue;
+
+                shared->pending++;
+                ThreadPool::Instance().Submit(
+                    [shared, path]
+                    {
+                        SearchFile(shared, path);
+                        shared->pending--;
+                    }
+                );
+            }
+
+            shared->pending--;
+        }
+    );
+}
+
+void FileSearch::Cancel()
+{
+    if (state != nullptr) state->cancelled = true;
+    state.reset();
+}
+
+bool FileSearch::IsRunning() const
+{
+    return state != nullptr && state->pending > 0;
+}
+
+int FileSearch::FilesSearched() const
+{
+    return state != nullptr ? state->files_searched.load() : 0;
+}
+
+Vector<FileMatch> FileSearch::Take()
+{
+    Vector<FileMatch> matches;
+    if (state == nullptr) return matches;
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    std::swap(matches, state->found);
+    return matches;
+}
@@ -0,0 +1,101 @@
+#ifndef GREP_HPP
+#define GREP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <QString>
+
+#include "String32.hpp"
+#include "Vector.hpp"
+
+#include "Cursor.hpp"
+#include "Search.hpp"
+
+struct FileMatch
+{
+    QString path;
+    Cursor match;
+
+    // The whole line the match is on
+    String32 line;
+};
+
+// Whether a file is one of the scripts or text data files that searches across files look at
+bool IsTextFile(QString const& path);
+
+void EncodeUtf8(char32_t ch, Vector<std::uint8_t> & bytes);
+
+// Bytes every match of a search contains, looked for in the raw UTF-8 of a file so lines without them are never decoded.
+// Only ASCII is folded, a search ignoring case uses the longest run of ASCII in its literals.
+class Needle
+{
+private:
+    Vector<std::uint8_t> bytes;
+    bool match_case = true;
+
+    bool MatchesAt(std::uint8_t const* data) const;
+
+public:
+    Needle() = default;
+    explicit Needle(Search const& search);
+
+    bool IsEmpty() const;
+
+    // Offset of the first occurrence in data, -1 if there is none
+    std::int64_t Find(std::uint8_t const* data, std::int64_t size) const;
+};
+
+// Searches the lines of data from begin to end, where begin is the start of line first_line
+void GrepLines(QString const& path, std::uint8_t const* data, std::int64_t begin, std::int64_t end, int first_line,
+               Search const& search, Search::Cache & cache, Needle const& needle, Vector<FileMatch> & matches);
+
+// Searches every text file under a directory without an index. Files are mapped and searched on the thread pool,
+// matches are collected as they are found and taken by the caller while the search goes on.
+class FileSearch
+{
+private:
+    // Shared with the tasks, which may still be running after the search was cancelled or replaced
+    struct State
+    {
+        Search search;
+        Needle needle;
+
+        std::mutex mutex;
+        Vector<FileMatch> found;
+
+        std::atomic<bool> cancelled{ false };
+
+        // Tasks not finished yet, the walk counts as one
+        std::atomic<int> pending{ 0 };
+
+        std::atomic<int> files_searched{ 0 };
+    };
+
+    std::shared_ptr<State> state;
+
+    static void SearchFile(std::shared_ptr<State> const& state, QString const& path);
+
+public:
+    FileSearch() = default;
+    ~FileSearch();
+
+    FileSearch(FileSearch const& other) = delete;
+    FileSearch(FileSearch && other) = delete;
+
+    FileSearch & operator=(FileSearch const& other) = delete;
+    FileSearch & operator=(FileSearch && other) = delete;
+
+    void Start(QString const& directory, Search const& search);
+    void Cancel();
+
+    bool IsRunning() const;
+    int FilesSearched() const;
+
+    // Matches found since the last call
+    Vector<FileMatch> Take();
+};
+
+#endif // GREP_HPP
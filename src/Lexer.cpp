@@ -41,3 +41,28 @@ void Lexer::SetParent(Buffer * new_parent)
 {
     parent = new_parent;
 }
+
+Vector<std::uint8_t> Lexer::LineStates(StringView32)
+{
+    return {};
+}
+
+bool Lexer::AdvanceLineState(StringView32, std::uint8_t &)
+{
+    return false;
+}
+
+int Lexer::ScanBlocks(StringView32, int, Vector<BlockEdge> &)
+{
+    return 0;
+}
+
+int Lexer::ParseLine(StringView32, int, LineSyntax &, Vector<Diagnostic> &)
+{
+    return 0;
+}
+
+String32 Lexer::NestingError(int, int)
+{
+    return {};
+}
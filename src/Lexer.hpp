@@ -5,6 +5,7 @@
 
 #include "HashMap.hpp"
 #include "String32.hpp"
+#include "Vector.hpp"
 
 #include "Cursor.hpp"
 
@@ -27,6 +28,56 @@ enum GenericStyle : std::uint8_t
     STYLE_LAST_PREDEFINED = STYLE_SINGLE_QUOTE_ESCAPE_INVALID
 };
 
+enum BlockKind
+{
+    BLOCK_OTHER,
+    BLOCK_FUNCTION
+};
+
+// Lines from the one opening a block to the one closing it
+struct Block
+{
+    int first;
+    int last;
+    int kind;
+};
+
+// A keyword opening or closing a block, an opening one is matched by a closing one of the same type
+struct BlockEdge
+{
+    int x;
+    int size;
+    int type;
+    bool open;
+    int kind;
+};
+
+// Something wrong with the text, and where
+struct Diagnostic
+{
+    Position pos;
+    int size;
+    String32 message;
+};
+
+// The statement on a line as far as the syntax tree is concerned.
+// Blocks work like block edges, a line opening one is matched by a line closing one of the same type.
+struct LineSyntax
+{
+    // Lexer specific, zero for lines without a statement
+    int kind = 0;
+
+    // Zero for lines that neither open nor close a block
+    int block = 0;
+    bool open = false;
+
+    // The keyword starting the statement, and the name it declares if any
+    int x = 0;
+    int size = 0;
+    int name_x = 0;
+    int name_size = 0;
+};
+
 class Lexer
 {
 private:
@@ -50,6 +101,26 @@ public:
 
     virtual void Style(Position start, Position stop) = 0;
 
+    // Style each line of text ends in as far as Style is concerned when resuming after it.
+    // Empty if the lexer can't work that out without styling everything.
+    virtual Vector<std::uint8_t> LineStates(StringView32 text);
+
+    // Advances state, a style LineStates gives, from the end of the line before to the end of this one.
+    // Returns false if the lexer can't work that out from the line alone.
+    virtual bool AdvanceLineState(StringView32 line, std::uint8_t & state);
+
+    // Adds the block keywords on a line, starting in the state the previous line ended in.
+    // Returns the state this line ends in, zero is the state at the start of the text.
+    virtual int ScanBlocks(StringView32 line, int state, Vector<BlockEdge> & edges);
+
+    // Parses the statement on a line, starting in the state the previous line ended in, and adds what is wrong with it.
+    // The diagnostics are left on line zero. Returns the state this line ends in, zero is the state at the start of the text.
+    virtual int ParseLine(StringView32 line, int state, LineSyntax & syntax, Vector<Diagnostic> & diagnostics);
+
+    // Why a statement of one kind can't be directly inside a block opened by another, empty if it can.
+    // Zero is outside of every block.
+    virtual String32 NestingError(int parent_kind, int kind);
+
     virtual ~Lexer() = default;
 };
 
@@ -1,6 +1,8 @@
 #include "LexerJass.hpp"
 
 #include "Buffer.hpp"
+#include "NativeDatabase.hpp"
+#include "ParserJass.hpp"
 #include "Theme.hpp"
 
 #include "SpecialCharacters.hpp"
@@ -9,6 +11,40 @@
 
 using namespace Jass;
 
+namespace
+{
+	std::uint8_t StyleOfState(Jass::LineState state)
+	{
+		switch (state)
+		{
+		case Jass::LineState::CommentBlock:
+			return STYLE_COMMENT_BLOCK;
+		case Jass::LineState::String:
+			return STYLE_DOUBLE_QUOTE_STRING;
+		case Jass::LineState::Rawcode:
+			return STYLE_SINGLE_QUOTE_STRING;
+		default:
+			return STYLE_DEFAULT;
+		}
+	}
+
+	// Only the styles Style resumes in differently, everything else starts over in code
+	Jass::LineState StateOfStyle(std::uint8_t style)
+	{
+		switch (style)
+		{
+		case STYLE_COMMENT_BLOCK:
+			return Jass::LineState::CommentBlock;
+		case STYLE_DOUBLE_QUOTE_STRING:
+			return Jass::LineState::String;
+		case STYLE_SINGLE_QUOTE_STRING:
+			return Jass::LineState::Rawcode;
+		default:
+			return Jass::LineState::Code;
+		}
+	}
+}
+
 void LexerJass::StyleToken(Token const& token, int start)
 {
 	int style = STYLE_DEFAULT;
@@ -54,6 +90,10 @@ void LexerJass::StyleToken(Token const& token, int start)
 		{
 			style = keywords[token.Value()];
 		}
+		else
+		{
+			style = NativeDatabase::Instance().Style(token.Value());
+		}
 		break;
 	default:
 		if (token.IsKeyword())
@@ -96,7 +136,7 @@ void LexerJass::Style(Position start, Position stop)
 		idx = last_token.Stop();
 		break;
 	case STYLE_SINGLE_QUOTE_STRING:
-		last_token = Jass::ReadStringLiteral(text, idx, false);
+		last_token = Jass::ReadRawcodeLiteral(text, idx, false);
 		StyleToken(last_token, 0);
 		idx = last_token.Stop();
 		break;
@@ -104,7 +144,7 @@ void LexerJass::Style(Position start, Position stop)
 		break;
 	}
 
-	for (Jass::Token const& token : Jass::Tokenize(text, idx))
+	for (Jass::Token const& token : Jass::TokenizeParallel(text, idx))
 	{
 		StyleToken(token, idx);
 		idx = token.Stop();
@@ -112,3 +152,127 @@ void LexerJass::Style(Position start, Position stop)
 
 	Parent()->SetStyle(text.size() - idx, STYLE_DEFAULT);
 }
+
+Vector<std::uint8_t> LexerJass::LineStates(StringView32 text)
+{
+	Vector<Jass::LineState> states = Jass::ScanLineStates(text);
+
+	Vector<std::uint8_t> styles(states.size());
+	for (int idx = 0; idx < states.size(); idx++)
+	{
+		styles[idx] = StyleOfState(states[idx]);
+	}
+
+	return styles;
+}
+
+bool LexerJass::AdvanceLineState(StringView32 line, std::uint8_t & state)
+{
+	state = StyleOfState(Jass::ScanLineState(line, StateOfStyle(state)));
+	return true;
+}
+
+int LexerJass::ScanBlocks(StringView32 line, int state, Vector<BlockEdge> & edges)
+{
+	LineState line_state = LineStateOf(state);
+	bool in_interface = state & IN_INTERFACE;
+
+	int idx = 0;
+	switch (line_state)
+	{
+	case LineState::CommentBlock:
+		idx = Jass::ReadCommentBlock(line, 0, false).Stop();
+		break;
+	case LineState::String:
+		idx = Jass::ReadStringLiteral(line, 0, false).Stop();
+		break;
+	case LineState::Rawcode:
+		idx = Jass::ReadRawcodeLiteral(line, 0, false).Stop();
+		break;
+	default:
+		break;
+	}
+
+	// Block keywords only ever start a statement, and there is one statement per line
+	Token token = NextToken(line, idx);
+	while (token.Is(TokenType::CommentBlock, TokenType::Private, TokenType::Public, TokenType::Static, TokenType::Constant) ||
+		(token.Is(TokenType::Identifier) && token.Value() == U"stub"))
+	{
+		token = NextToken(line, token.Stop());
+	}
+
+	TokenType type = token.Type();
+	if (token.Is(TokenType::Identifier) && token.Value() == U"library_once")
+	{
+		type = TokenType::Library;
+	}
+
+	auto add_edge = [&](TokenType edge_type, bool open)
+	{
+		BlockEdge edge;
+		edge.x = token.Start();
+		edge.size = token.Length();
+		edge.type = (int)edge_type;
+		edge.open = open;
+		edge.kind = edge_type == TokenType::Function || edge_type == TokenType::Method ? BLOCK_FUNCTION : BLOCK_OTHER;
+		edges.push_back(edge);
+	};
+
+	switch (type)
+	{
+	case TokenType::Function:
+		// Function interfaces are declarations
+		if (NextToken(line, token.Stop()).Is(TokenType::Interface)) break;
+
+		add_edge(type, true);
+		break;
+	case TokenType::Method:
+		// So are methods inside interfaces
+		if (in_interface) break;
+
+		add_edge(type, true);
+		break;
+	case TokenType::Interface:
+		in_interface = true;
+		add_edge(type, true);
+		break;
+	case TokenType::Globals:
+	case TokenType::Struct:
+	case TokenType::Module:
+	case TokenType::Scope:
+	case TokenType::Library:
+	case TokenType::Loop:
+	case TokenType::If:
+		add_edge(type, true);
+		break;
+	case TokenType::EndInterface:
+		in_interface = false;
+		add_edge(TokenType::Interface, false);
+		break;
+	case TokenType::EndGlobals:  add_edge(TokenType::Globals, false);  break;
+	case TokenType::EndFunction: add_edge(TokenType::Function, false); break;
+	case TokenType::EndMethod:   add_edge(TokenType::Method, false);   break;
+	case TokenType::EndStruct:   add_edge(TokenType::Struct, false);   break;
+	case TokenType::EndModule:   add_edge(TokenType::Module, false);   break;
+	case TokenType::EndScope:    add_edge(TokenType::Scope, false);    break;
+	case TokenType::EndLibrary:  add_edge(TokenType::Library, false);  break;
+	case TokenType::EndLoop:     add_edge(TokenType::Loop, false);     break;
+	case TokenType::EndIf:       add_edge(TokenType::If, false);       break;
+	default:
+		break;
+	}
+
+	line_state = Jass::ScanLineState(line, line_state);
+
+	return (int)line_state | (in_interface ? IN_INTERFACE : 0);
+}
+
+int LexerJass::ParseLine(StringView32 line, int state, LineSyntax & syntax, Vector<Diagnostic> & diagnostics)
+{
+	return Jass::ParseStatement(line, state, syntax, diagnostics);
+}
+
+String32 LexerJass::NestingError(int parent_kind, int kind)
+{
+	return Jass::NestingError((Jass::StatementKind)parent_kind, (Jass::StatementKind)kind);
+}
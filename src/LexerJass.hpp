@@ -28,6 +28,16 @@ public:
 
     virtual void Style(Position start, Position stop);
 
+    virtual Vector<std::uint8_t> LineStates(StringView32 text);
+
+    virtual bool AdvanceLineState(StringView32 line, std::uint8_t & state);
+
+    virtual int ScanBlocks(StringView32 line, int state, Vector<BlockEdge> & edges);
+
+    virtual int ParseLine(StringView32 line, int state, LineSyntax & syntax, Vector<Diagnostic> & diagnostics);
+
+    virtual String32 NestingError(int parent_kind, int kind);
+
     virtual ~LexerJass() = default;
 };
 
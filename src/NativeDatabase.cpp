@@ -0,0 +1,452 @@
+#include "NativeDatabase.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "String32.hpp"
+#include "TokenizerJass.hpp"
+#include "LexerJass.hpp"
+
+namespace
+{
+    constexpr char magic[4] = { 'J', 'N', 'D', 'B' };
+    constexpr std::uint32_t version = 1;
+
+    // Layout on disk, everything in native byte order:
+    //  Header
+    //  Record records[record_count], sorted by name
+    //  Parameter parameters[parameter_count]
+    //  char32_t pool[pool_size]
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t record_count;
+        std::uint32_t parameter_count;
+        std::uint32_t pool_size;
+        std::uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 24, "Header must not contain padding");
+
+    struct Declaration
+    {
+        String32 name;
+        NativeKind kind;
+        String32 return_type;
+        Vector<String32> parameter_types;
+        Vector<String32> parameter_names;
+    };
+
+    Vector<Jass::Token> MeaningfulTokens(StringView32 line)
+    {
+        Vector<Jass::Token> tokens;
+        for (Jass::Token & token : Jass::Tokenize(line))
+        {
+            if (token.IsComment() || token.Is(Jass::TokenType::Eof)) continue;
+            tokens.push_back(std::move(token));
+        }
+        return tokens;
+    }
+
+    // Parses "takes nothing returns type" or "takes type name, ... returns type" starting at idx
+    bool ParseSignature(Vector<Jass::Token> const& tokens, int idx, Declaration & declaration)
+    {
+        if (idx >= tokens.size() || !tokens[idx].Is(Jass::TokenType::Takes)) return false;
+        idx++;
+
+        if (idx < tokens.size() && tokens[idx].Is(Jass::TokenType::Nothing))
+        {
+            idx++;
+        }
+        else
+        {
+            while (idx + 1 < tokens.size())
+            {
+                if (!tokens[idx].Is(Jass::TokenType::Identifier))     return false;
+                if (!tokens[idx + 1].Is(Jass::TokenType::Identifier)) return false;
+
+                declaration.parameter_types.push_back(tokens[idx].Value());
+                declaration.parameter_names.push_back(tokens[idx + 1].Value());
+                idx += 2;
+
+                if (idx >= tokens.size() || !tokens[idx].Is(Jass::TokenType::Comma)) break;
+                idx++;
+            }
+        }
+
+        if (idx + 1 >= tokens.size() || !tokens[idx].Is(Jass::TokenType::Returns)) return false;
+
+        Jass::Token const& type = tokens[idx + 1];
+        if      (type.Is(Jass::TokenType::Nothing))    declaration.return_type = U"nothing";
+        else if (type.Is(Jass::TokenType::Identifier)) declaration.return_type = type.Value();
+        else                                            return false;
+
+        return true;
+    }
+
+    void ParseScript(StringView32 text, Vector<Declaration> & declarations)
+    {
+        bool in_globals = false;
+
+        int start = 0;
+        while (start <= text.size())
+        {
+            int stop = text.index_of(U'\n', start);
+            if (stop == -1) stop = text.size();
+
+            Vector<Jass::Token> tokens = MeaningfulTokens(text.middle_view(start, stop - start));
+            start = stop + 1;
+
+            if (tokens.empty()) continue;
+
+            int idx = 0;
+            bool constant = tokens[idx].Is(Jass::TokenType::Constant);
+            if (constant) idx++;
+
+            if (idx >= tokens.size()) continue;
+
+            Declaration declaration;
+
+            switch (tokens[idx].Type())
+            {
+            case Jass::TokenType::Globals:
+                in_globals = true;
+                continue;
+            case Jass::TokenType::EndGlobals:
+                in_globals = false;
+                continue;
+            case Jass::TokenType::Native:
+            case Jass::TokenType::Function:
+                if (idx + 1 >= tokens.size() || !tokens[idx + 1].Is(Jass::TokenType::Identifier)) continue;
+
+                declaration.name = tokens[idx + 1].Value();
+                declaration.kind = tokens[idx].Is(Jass::TokenType::Native) ? NativeKind::Native : NativeKind::Function;
+
+                if (!ParseSignature(tokens, idx + 2, declaration)) continue;
+                break;
+            case Jass::TokenType::Type:
+                if (idx + 1 >= tokens.size() || !tokens[idx + 1].Is(Jass::TokenType::Identifier)) continue;
+
+                declaration.name = tokens[idx + 1].Value();
+                declaration.kind = NativeKind::Type;
+                break;
+            case Jass::TokenType::Identifier:
+                if (!in_globals) continue;
+
+                // type [array] name [= value]
+                declaration.return_type = tokens[idx].Value();
+                idx++;
+
+                if (idx < tokens.size() && tokens[idx].Is(Jass::TokenType::Array)) idx++;
+                if (idx >= tokens.size() || !tokens[idx].Is(Jass::TokenType::Identifier)) continue;
+
+                declaration.name = tokens[idx].Value();
+                declaration.kind = constant ? NativeKind::Constant : NativeKind::Global;
+                break;
+            default:
+                continue;
+            }
+
+            declarations.push_back(std::move(declaration));
+        }
+    }
+}
+
+struct NativeDatabase::Record
+{
+    std::uint32_t name_offset;
+    std::uint32_t name_length;
+    NativeKind kind;
+    std::uint32_t return_type_offset;
+    std::uint32_t return_type_length;
+    std::uint32_t first_parameter;
+    std::uint32_t parameter_count;
+};
+
+struct NativeDatabase::Parameter
+{
+    std::uint32_t type_offset;
+    std::uint32_t type_length;
+    std::uint32_t name_offset;
+    std::uint32_t name_length;
+};
+
+static_assert(sizeof(NativeDatabase::Record) == 28, "Record must not contain padding");
+static_assert(sizeof(NativeDatabase::Parameter) == 16, "Parameter must not contain padding");
+
+NativeDatabase::Symbol::Symbol(NativeDatabase const* database, Record const* record) :
+    database(database),
+    record(record)
+{
+}
+
+bool NativeDatabase::Symbol::IsValid() const
+{
+    return record != nullptr;
+}
+
+StringView32 NativeDatabase::Symbol::Name() const
+{
+    return database->PoolView(record->name_offset, record->name_length);
+}
+
+NativeKind NativeDatabase::Symbol::Kind() const
+{
+    return record->kind;
+}
+
+int NativeDatabase::Symbol::Style() const
+{
+    switch (record->kind)
+    {
+    case NativeKind::Native:   return JASS_NATIVE;
+    case NativeKind::Function: return JASS_FUNCTION;
+    case NativeKind::Type:     return JASS_TYPE;
+    case NativeKind::Constant: return JASS_CONSTANT;
+    default:                   return STYLE_DEFAULT;
+    }
+}
+
+StringView32 NativeDatabase::Symbol::ReturnType() const
+{
+    return database->PoolView(record->return_type_offset, record->return_type_length);
+}
+
+int NativeDatabase::Symbol::ParameterCount() const
+{
+    return record->parameter_count;
+}
+
+StringView32 NativeDatabase::Symbol::ParameterType(int idx) const
+{
+    Parameter const& parameter = database->parameters[record->first_parameter + idx];
+    return database->PoolView(parameter.type_offset, parameter.type_length);
+}
+
+StringView32 NativeDatabase::Symbol::ParameterName(int idx) const
+{
+    Parameter const& parameter = database->parameters[record->first_parameter + idx];
+    return database->PoolView(parameter.name_offset, parameter.name_length);
+}
+
+NativeDatabase::~NativeDatabase()
+{
+    Close();
+}
+
+StringView32 NativeDatabase::PoolView(std::uint32_t offset, std::uint32_t length) const
+{
+    return StringView32(pool + offset, pool + offset + length);
+}
+
+void NativeDatabase::Close()
+{
+    if (data != nullptr) file.unmap(data);
+    file.close();
+
+    data = nullptr;
+    records = nullptr;
+    parameters = nullptr;
+    pool = nullptr;
+    record_count = 0;
+}
+
+NativeDatabase & NativeDatabase::Instance()
+{
+    static NativeDatabase database;
+    return database;
+}
+
+bool NativeDatabase::Build(Vector<QString> const& sources, QString const& filename)
+{
+    Vector<Declaration> declarations;
+
+    for (QString const& source : sources)
+    {
+        QFile input(source);
+        if (!input.open(QIODevice::ReadOnly)) return false;
+
+        String32 text = QString::fromUtf8(input.readAll()).replace("\r\n", "\n").toStdU32String();
+        ParseScript(text, declarations);
+    }
+
+    auto pred = [](Declaration const& lhs, Declaration const& rhs) { return lhs.name < rhs.name; };
+    std::stable_sort(declarations.begin(), declarations.end(), pred);
+
+    // blizzard.j can't redeclare anything from common.j, but keep the first one just in case
+    auto equal = [](Declaration const& lhs, Declaration const& rhs) { return lhs.name == rhs.name; };
+    declarations.erase(std::unique(declarations.begin(), declarations.end(), equal), declarations.end());
+
+    Vector<Record> records;
+    Vector<Parameter> parameters;
+    String32 pool;
+
+    HashMap<String32, std::uint32_t> pooled;
+    auto intern = [&](String32 const& str)
+    {
+        auto it = pooled.find(str);
+        if (it != pooled.end()) return it->second;
+
+        std::uint32_t offset = pool.size();
+        pool += str;
+        pooled[str] = offset;
+        return offset;
+    };
+
+    records.reserve(declarations.size());
+    for (Declaration const& declaration : declarations)
+    {
+        Record record;
+        record.name_offset = intern(declaration.name);
+        record.name_length = declaration.name.size();
+        record.kind = declaration.kind;
+        record.return_type_offset = intern(declaration.return_type);
+        record.return_type_length = declaration.return_type.size();
+        record.first_parameter = parameters.size();
+        record.parameter_count = declaration.parameter_types.size();
+        records.push_back(record);
+
+        for (int idx = 0; idx < declaration.parameter_types.size(); idx++)
+        {
+            Parameter parameter;
+            parameter.type_offset = intern(declaration.parameter_types[idx]);
+            parameter.type_length = declaration.parameter_types[idx].size();
+            parameter.name_offset = intern(declaration.parameter_names[idx]);
+            parameter.name_length = declaration.parameter_names[idx].size();
+            parameters.push_back(parameter);
+        }
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.record_count = records.size();
+    header.parameter_count = parameters.size();
+    header.pool_size = pool.size();
+
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+
+    QSaveFile output(filename);
+    if (!output.open(QIODevice::WriteOnly)) return false;
+
+    output.write((char const*)&header, sizeof(Header));
+    output.write((char const*)records.data(), records.size() * sizeof(Record));
+    output.write((char const*)parameters.data(), parameters.size() * sizeof(Parameter));
+    output.write((char const*)pool.data(), pool.size() * sizeof(char32_t));
+
+    return output.commit();
+}
+
+bool NativeDatabase::Open(QString const& filename)
+{
+    Close();
+
+    file.setFileName(filename);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    std::int64_t size = file.size();
+    if (size < (std::int64_t)sizeof(Header))
+    {
+        Close();
+        return false;
+    }
+
+    data = file.map(0, size);
+    if (data == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+
+    std::int64_t records_offset    = sizeof(Header);
+    std::int64_t parameters_offset = records_offset + std::int64_t(header.record_count) * sizeof(Record);
+    std::int64_t pool_offset       = parameters_offset + std::int64_t(header.parameter_count) * sizeof(Parameter);
+    std::int64_t expected_size     = pool_offset + std::int64_t(header.pool_size) * sizeof(char32_t);
+
+    bool valid =
+        std::memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+        header.version == version &&
+        expected_size == size;
+
+    if (!valid)
+    {
+        Close();
+        return false;
+    }
+
+    records      = (Record const*)(data + records_offset);
+    parameters   = (Parameter const*)(data + parameters_offset);
+    pool         = (char32_t const*)(data + pool_offset);
+    record_count = header.record_count;
+
+    return true;
+}
+
+bool NativeDatabase::Load(QString const& script_directory)
+{
+    QString filename = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/natives.jdb";
+
+    Vector<QString> sources;
+    for (QString name : { "common.j", "blizzard.j" })
+    {
+        QString source = script_directory + "/" + name;
+        if (QFileInfo(source).exists()) sources.push_back(source);
+    }
+
+    QFileInfo info(filename);
+
+    bool stale = !info.exists();
+    for (QString const& source : sources)
+    {
+        if (QFileInfo(source).lastModified() > info.lastModified()) stale = true;
+    }
+
+    if (stale && !sources.empty())
+    {
+        Build(sources, filename);
+    }
+
+    return Open(filename);
+}
+
+int NativeDatabase::Count() const
+{
+    return record_count;
+}
+
+NativeDatabase::Symbol NativeDatabase::At(int idx) const
+{
+    return Symbol(this, records + idx);
+}
+
+NativeDatabase::Symbol NativeDatabase::Find(StringView32 name) const
+{
+    auto pred = [this](Record const& record, StringView32 name)
+    {
+        return PoolView(record.name_offset, record.name_length) < name;
+    };
+
+    Record const* end = records + record_count;
+    Record const* it = std::lower_bound(records, end, name, pred);
+
+    if (it == end || PoolView(it->name_offset, it->name_length) != name) return Symbol();
+
+    return Symbol(this, it);
+}
+
+int NativeDatabase::Style(StringView32 name) const
+{
+    Symbol symbol = Find(name);
+    if (!symbol.IsValid()) return STYLE_DEFAULT;
+
+    return symbol.Style();
+}
@@ -0,0 +1,91 @@
+#ifndef NATIVEDATABASE_HPP
+#define NATIVEDATABASE_HPP
+
+#include <cstdint>
+
+#include <QFile>
+#include <QString>
+
+#include "StringView32.hpp"
+#include "Vector.hpp"
+
+enum class NativeKind : std::uint32_t
+{
+    Native,
+    Function,
+    Type,
+    Constant,
+    Global
+};
+
+// Declarations from common.j and blizzard.j, compiled once into a binary file and memory mapped
+class NativeDatabase
+{
+public:
+    struct Record;
+    struct Parameter;
+
+    class Symbol
+    {
+    private:
+        NativeDatabase const* database;
+        Record const* record;
+
+    public:
+        Symbol(NativeDatabase const* database = nullptr, Record const* record = nullptr);
+
+        bool IsValid() const;
+
+        StringView32 Name() const;
+        NativeKind Kind() const;
+        int Style() const;
+
+        StringView32 ReturnType() const;
+
+        int ParameterCount() const;
+        StringView32 ParameterType(int idx) const;
+        StringView32 ParameterName(int idx) const;
+    };
+
+private:
+    QFile file;
+
+    uchar * data = nullptr;
+
+    Record const* records = nullptr;
+    Parameter const* parameters = nullptr;
+    char32_t const* pool = nullptr;
+
+    int record_count = 0;
+
+    NativeDatabase() = default;
+    ~NativeDatabase();
+
+    NativeDatabase(NativeDatabase const& other) = delete;
+    NativeDatabase(NativeDatabase && other) = delete;
+
+    NativeDatabase & operator=(NativeDatabase const& other) = delete;
+    NativeDatabase & operator=(NativeDatabase && other) = delete;
+
+    StringView32 PoolView(std::uint32_t offset, std::uint32_t length) const;
+
+    void Close();
+
+public:
+    static NativeDatabase & Instance();
+
+    static bool Build(Vector<QString> const& sources, QString const& filename);
+
+    bool Open(QString const& filename);
+
+    // Opens the database for the scripts in directory, building it first if it's missing or out of date
+    bool Load(QString const& script_directory);
+
+    int Count() const;
+    Symbol At(int idx) const;
+
+    Symbol Find(StringView32 name) const;
+    int Style(StringView32 name) const;
+};
+
+#endif // NATIVEDATABASE_HPP
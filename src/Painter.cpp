@@ -8,8 +8,9 @@
 #include <QDebug>
 
 #include "Vector.hpp"
+#include "GlyphAtlas.hpp"
 
-Painter::Painter(QPaintDevice * widget) : painter(widget), clip_rect(painter.window())
+Painter::Painter(QPaintDevice * widget) : painter(widget), clip_rect(painter.window()), dirty_rect(clip_rect)
 {
     painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
 
@@ -18,6 +19,11 @@ Painter::Painter(QPaintDevice * widget) : painter(widget), clip_rect(painter.win
     text_option.setTabStopDistance(100);
 }
 
+Painter::Painter(QImage * image) : Painter(static_cast<QPaintDevice *>(image))
+{
+    this->image = image;
+}
+
 QRect Painter::Rect()
 {
     QRect r = clip_rect;
@@ -30,6 +36,13 @@ QRect Painter::ClipRect()
     return clip_rect;
 }
 
+QRect Painter::DirtyRect()
+{
+    QRect r = dirty_rect & clip_rect;
+    r.translate(-Origin());
+    return r;
+}
+
 QPoint Painter::Origin()
 {
     return clip_rect.topLeft();
@@ -48,7 +61,13 @@ int Painter::Y()
 void Painter::SetClipRect(QRect r)
 {
     clip_rect = r;
-    painter.setClipRect(r);
+    painter.setClipRect(r & dirty_rect);
+}
+
+void Painter::SetDirtyRect(QRect r)
+{
+    dirty_rect = r;
+    painter.setClipRect(clip_rect & dirty_rect);
 }
 
 void Painter::SetFont(QFont const& font)
@@ -143,3 +162,38 @@ void Painter::DrawText(int x, int y, int w, int h, StringView32 text)
     y += Y();
     painter.drawText(x, y, w, h, flags, QString::fromUcs4(text.data(), text.size()));
 }
+
+void Painter::DrawGlyphs(GlyphAtlas & atlas, int x, int y, StringView32 text)
+{
+    int cw = atlas.CellSize().width();
+    int ch = atlas.CellSize().height();
+
+    bool direct = image != nullptr && atlas.IsValid();
+    if (direct)
+    {
+        QImage::Format format = image->format();
+        direct = format == QImage::Format_RGB32 || format == QImage::Format_ARGB32_Premultiplied;
+    }
+
+    if (!direct)
+    {
+        DrawText(x, y, text.size() * cw, ch, text);
+        return;
+    }
+
+    QRgb color = painter.pen().color().rgba();
+
+    x += X();
+    y += Y();
+
+    for (int idx = 0; idx < text.size(); idx++)
+    {
+        if (!atlas.Draw(*image, clip_rect & dirty_rect, x, y, text[idx], color))
+        {
+            // Glyphs missing from the font go through Qt which knows about fallback fonts
+            painter.drawText(x, y, cw, ch, Qt::AlignTop | Qt::AlignLeft, QString::fromUcs4(&text[idx], 1));
+        }
+
+        x += cw;
+    }
+}
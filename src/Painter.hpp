@@ -2,6 +2,7 @@
 #define PAINTER_HPP
 
 #include <QPaintDevice>
+#include <QImage>
 
 #include <QPainter>
 #include <QFont>
@@ -10,25 +11,36 @@
 #include "String32.hpp"
 #include "StringView32.hpp"
 
+class GlyphAtlas;
+
 class Painter
 {
 private:
     QPainter painter;
 
+    // Set when painting into an image, glyphs from an atlas are then blended directly into its pixels
+    QImage * image = nullptr;
+
     QTextOption text_option;
 
     QRect clip_rect;
 
+    // Only this part of the device gets painted, it doesn't move the origin like the clip rect does
+    QRect dirty_rect;
+
 public:
     Painter(QPaintDevice * widget);
+    Painter(QImage * image);
 
     QRect Rect();
     QRect ClipRect();
+    QRect DirtyRect();
     QPoint Origin();
     int X();
     int Y();
 
     void SetClipRect(QRect r);
+    void SetDirtyRect(QRect r);
     void SetFont(QFont const& font);
     void SetPen(QPen const& pen);
 
@@ -39,6 +51,7 @@ public:
     void DrawCharacter(QRect rect, char32_t ch);
     void DrawText(QRect rect, StringView32 text, int flags = Qt::AlignHCenter | Qt::AlignVCenter);
     void DrawText(int x, int y, int w, int h, StringView32 text);
+    void DrawGlyphs(GlyphAtlas & atlas, int x, int y, StringView32 text);
 };
 
 #endif // PAINTER_HPP
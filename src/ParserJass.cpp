@@ -0,0 +1,881 @@
+#include "ParserJass.hpp"
+
+#include <algorithm>
+
+#include "SpecialCharacters.hpp"
+
+#include "TokenizerJass.hpp"
+
+namespace Jass
+{
+    namespace
+    {
+        // The word after //! of a preprocessor comment
+        StringView32 Directive(StringView32 line, Token const& comment)
+        {
+            int idx = comment.Start() + 3;
+            while (idx < comment.Stop() && IsSpace(line[idx])) idx++;
+
+            int start = idx;
+            while (idx < comment.Stop() && IsIdentifierChar(line[idx])) idx++;
+
+            return line.middle_view(start, idx - start);
+        }
+
+        bool StartsSkippedBlock(StringView32 directive)
+        {
+            return directive == U"textmacro" || directive == U"textmacro_once" || directive == U"novjass" ||
+                directive == U"inject" || directive == U"zinc";
+        }
+
+        bool EndsSkippedBlock(StringView32 directive)
+        {
+            return directive == U"endtextmacro" || directive == U"endnovjass" || directive == U"endinject" || directive == U"endzinc";
+        }
+
+        // Recursive descent over the tokens of a single statement, stopping at the first error
+        class Parser
+        {
+        private:
+            StringView32 line;
+            LineSyntax & syntax;
+            Vector<Diagnostic> & diagnostics;
+
+            Token token;
+            int last_stop;
+
+            // The line ends inside a string or rawcode, so whatever seems to be missing at its end is on the next one
+            bool continued;
+
+        public:
+            Parser(StringView32 line, int start, bool continued, LineSyntax & syntax, Vector<Diagnostic> & diagnostics) :
+                line(line),
+                syntax(syntax),
+                diagnostics(diagnostics),
+                token(TokenType::Unknown, start, start),
+                last_stop(start),
+                continued(continued)
+            {
+                Next();
+            }
+
+            Token const& Current() const
+            {
+                return token;
+            }
+
+            void Next()
+            {
+                last_stop = token.Stop();
+
+                token = NextToken(line, token.Stop());
+                while (token.IsComment()) token = NextToken(line, token.Stop());
+            }
+
+            // The token after the current one, without moving past it
+            Token Peek() const
+            {
+                Token next = NextToken(line, token.Stop());
+                while (next.IsComment()) next = NextToken(line, next.Stop());
+                return next;
+            }
+
+            bool Is(TokenType type) const
+            {
+                return token.Is(type);
+            }
+
+            bool IsWord(StringView32 word) const
+            {
+                return token.Is(TokenType::Identifier) && StringView32(token.Value()) == word;
+            }
+
+            // Whether the current token follows the last one without anything in between
+            bool Adjacent() const
+            {
+                return token.Start() == last_stop;
+            }
+
+            bool Accept(TokenType type)
+            {
+                if (!token.Is(type)) return false;
+
+                Next();
+                return true;
+            }
+
+            bool Fail(char32_t const* message)
+            {
+                if (token.Is(TokenType::Eof) && continued) return false;
+
+                Diagnostic diagnostic;
+                diagnostic.pos = { 0, token.Start() };
+                diagnostic.size = std::max(1, token.Length());
+                diagnostic.message = message;
+                diagnostics.push_back(std::move(diagnostic));
+                return false;
+            }
+
+            bool Expect(TokenType type, char32_t const* message)
+            {
+                return Accept(type) || Fail(message);
+            }
+
+            bool Name(bool declares)
+            {
+                if (!token.Is(TokenType::Identifier)) return Fail(U"Expected a name");
+
+                if (declares)
+                {
+                    syntax.name_x = token.Start();
+                    syntax.name_size = token.Length();
+                }
+
+                Next();
+                return true;
+            }
+
+            bool TypeName()
+            {
+                if (!token.Is(TokenType::Identifier)) return Fail(U"Expected a type");
+
+                Next();
+                return true;
+            }
+
+            // A name, possibly of a member
+            bool QualifiedName()
+            {
+                if (!Name(false)) return false;
+
+                while (Accept(TokenType::Dot))
+                {
+                    if (!Name(false)) return false;
+                }
+                return true;
+            }
+
+            bool Expression()
+            {
+                return Or();
+            }
+
+            bool Or()
+            {
+                if (!And()) return false;
+
+                while (Accept(TokenType::Or))
+                {
+                    if (!And()) return false;
+                }
+                return true;
+            }
+
+            bool And()
+            {
+                if (!Negation()) return false;
+
+                while (Accept(TokenType::And))
+                {
+                    if (!Negation()) return false;
+                }
+                return true;
+            }
+
+            // Not applies to the whole comparison after it
+            bool Negation()
+            {
+                if (Accept(TokenType::Not)) return Negation();
+
+                return Comparison();
+            }
+
+            bool Comparison()
+            {
+                if (!Sum()) return false;
+
+                while (token.Is(TokenType::Less, TokenType::LessEq, TokenType::More, TokenType::MoreEq, TokenType::Equal, TokenType::NotEqual))
+                {
+                    Next();
+                    if (!Sum()) return false;
+                }
+                return true;
+            }
+
+            bool Sum()
+            {
+                if (!Product()) return false;
+
+                while (token.Is(TokenType::Add, TokenType::Sub))
+                {
+                    Next();
+                    if (!Product()) return false;
+                }
+                return true;
+            }
+
+            bool Product()
+            {
+                if (!Sign()) return false;
+
+                while (token.Is(TokenType::Mul, TokenType::Div))
+                {
+                    Next();
+                    if (!Sign()) return false;
+                }
+                return true;
+            }
+
+            bool Sign()
+            {
+                if (token.Is(TokenType::Add, TokenType::Sub))
+                {
+                    Next();
+                    return Sign();
+                }
+
+                return Postfix();
+            }
+
+            bool Arguments()
+            {
+                if (Accept(TokenType::CloseParen)) return true;
+
+                do
+                {
+                    if (!Expression()) return false;
+                } while (Accept(TokenType::Comma));
+
+                return Expect(TokenType::CloseParen, U"Expected ')'");
+            }
+
+            // Members, array elements and calls, ends_in_call is set when the last of them is a call
+            bool Postfix(bool * ends_in_call = nullptr)
+            {
+                if (!Primary()) return false;
+
+                bool call = false;
+                for (;;)
+                {
+                    if (Accept(TokenType::Dot))
+                    {
+                        if (!Name(false)) return false;
+                        call = false;
+                    }
+                    else if (Accept(TokenType::OpenBracket))
+                    {
+                        if (!Expression()) return false;
+                        if (!Expect(TokenType::CloseBracket, U"Expected ']'")) return false;
+                        call = false;
+                    }
+                    else if (Accept(TokenType::OpenParen))
+                    {
+                        if (!Arguments()) return false;
+                        call = true;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+
+                if (ends_in_call != nullptr) *ends_in_call = call;
+                return true;
+            }
+
+            bool Primary()
+            {
+                switch (token.Type())
+                {
+                case TokenType::Number:
+                    // The tokenizer only reads digits, reals and hexadecimals are made of the tokens right after
+                    Next();
+                    if (Is(TokenType::Identifier) && Adjacent())
+                    {
+                        Next();
+                    }
+                    else if (Is(TokenType::Dot) && Adjacent())
+                    {
+                        Next();
+                        if (Is(TokenType::Number) && Adjacent()) Next();
+                    }
+                    return true;
+
+                case TokenType::Dot:
+                    // Either a real without its integer part or a member of this
+                    Next();
+                    if (Is(TokenType::Number) && Adjacent())
+                    {
+                        Next();
+                        return true;
+                    }
+                    return Name(false);
+
+                case TokenType::Unknown:
+                    // Hexadecimals written as $FF
+                    if (line[token.Start()] == U'$')
+                    {
+                        Next();
+                        if (token.Is(TokenType::Number, TokenType::Identifier) && Adjacent())
+                        {
+                            Next();
+                            return true;
+                        }
+                    }
+                    return Fail(U"Expected an expression");
+
+                case TokenType::String:
+                case TokenType::Rawcode:
+                case TokenType::True:
+                case TokenType::False:
+                case TokenType::Null:
+                case TokenType::Identifier:
+                    Next();
+                    return true;
+
+                case TokenType::OpenParen:
+                    Next();
+                    if (!Expression()) return false;
+                    return Expect(TokenType::CloseParen, U"Expected ')'");
+
+                case TokenType::Function:
+                    Next();
+                    return QualifiedName();
+
+                default:
+                    return Fail(U"Expected an expression");
+                }
+            }
+
+            bool Signature()
+            {
+                if (!Expect(TokenType::Takes, U"Expected 'takes'")) return false;
+
+                if (!Accept(TokenType::Nothing))
+                {
+                    do
+                    {
+                        if (!TypeName() || !Name(false)) return false;
+                    } while (Accept(TokenType::Comma));
+                }
+
+                if (!Expect(TokenType::Returns, U"Expected 'returns'")) return false;
+
+                return Accept(TokenType::Nothing) || TypeName();
+            }
+
+            bool Variable()
+            {
+                if (!TypeName()) return false;
+
+                bool array = Accept(TokenType::Array);
+                if (!Name(true)) return false;
+
+                // Struct members can be arrays of a fixed size
+                if (array && Accept(TokenType::OpenBracket))
+                {
+                    if (!Expression()) return false;
+                    if (!Expect(TokenType::CloseBracket, U"Expected ']'")) return false;
+                }
+
+                if (array && Is(TokenType::Assign)) return Fail(U"Arrays can't be initialized");
+
+                if (Accept(TokenType::Assign)) return Expression();
+                return true;
+            }
+
+            // The size of a struct or of a dynamic array type, with an optional limit after it
+            bool Size()
+            {
+                if (!Accept(TokenType::OpenBracket)) return true;
+
+                if (!Expression()) return false;
+                if (Accept(TokenType::Comma) && !Expression()) return false;
+
+                return Expect(TokenType::CloseBracket, U"Expected ']'");
+            }
+
+            bool Parents()
+            {
+                if (!Accept(TokenType::Extends)) return true;
+                if (Accept(TokenType::Array)) return Size();
+
+                do
+                {
+                    if (!TypeName()) return false;
+                } while (Accept(TokenType::Comma));
+                return true;
+            }
+
+            bool Requirements()
+            {
+                for (;;)
+                {
+                    if (Accept(TokenType::Initializer))
+                    {
+                        if (!QualifiedName()) return false;
+                    }
+                    else if (token.Is(TokenType::Requires, TokenType::Uses, TokenType::Needs))
+                    {
+                        Next();
+                        do
+                        {
+                            if (IsWord(U"optional")) Next();
+                            if (!Name(false)) return false;
+                        } while (Accept(TokenType::Comma));
+                    }
+                    else
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            bool OperatorName()
+            {
+                int start = token.Start();
+
+                if (Accept(TokenType::OpenBracket))
+                {
+                    if (!Expect(TokenType::CloseBracket, U"Expected ']'")) return false;
+                }
+                else if (token.Is(TokenType::Identifier, TokenType::Less, TokenType::More, TokenType::Equal, TokenType::NotEqual))
+                {
+                    Next();
+                }
+                else
+                {
+                    return Fail(U"Expected an operator");
+                }
+
+                // Setters end in an assignment
+                if (Is(TokenType::Assign) && Adjacent()) Next();
+
+                syntax.name_x = start;
+                syntax.name_size = last_stop - start;
+                return true;
+            }
+
+            bool Assignment()
+            {
+                if (!Postfix()) return false;
+
+                if (token.Is(TokenType::AssignAdd, TokenType::AssignSub, TokenType::AssignMul, TokenType::AssignDiv))
+                {
+                    return Fail(U"Only '=' can assign");
+                }
+
+                if (!Expect(TokenType::Assign, U"Expected '='")) return false;
+                return Expression();
+            }
+
+            bool Call()
+            {
+                bool call = false;
+                if (!Postfix(&call)) return false;
+
+                return call || Fail(U"Expected '('");
+            }
+
+            bool Condition()
+            {
+                if (!Expression()) return false;
+                return Expect(TokenType::Then, U"Expected 'then'");
+            }
+
+            // What a line starting with a name that isn't a keyword is.
+            // An assignment or a call missing its keyword is taken for one, so it doesn't also end up misplaced.
+            StatementKind WordKind() const
+            {
+                if (IsWord(U"keyword") || IsWord(U"hook")) return StatementKind::Declaration;
+
+                Token next = Peek();
+                if (next.Is(TokenType::Assign, TokenType::OpenBracket, TokenType::AssignAdd, TokenType::AssignSub, TokenType::AssignMul, TokenType::AssignDiv))
+                {
+                    return StatementKind::Set;
+                }
+                if (next.Is(TokenType::OpenParen, TokenType::Dot))
+                {
+                    return StatementKind::Call;
+                }
+
+                return StatementKind::Variable;
+            }
+
+            bool Word()
+            {
+                switch (WordKind())
+                {
+                case StatementKind::Declaration:
+                    if (IsWord(U"keyword"))
+                    {
+                        Next();
+                        return Name(true);
+                    }
+
+                    Next();
+                    return Name(true) && QualifiedName();
+
+                case StatementKind::Set:
+                    return Fail(U"Expected 'set' before an assignment");
+
+                case StatementKind::Call:
+                    return Fail(U"Expected 'call' before a function call");
+
+                default:
+                    return Variable();
+                }
+            }
+
+            // Returns whether the line is valid, nothing but comments may follow the statement
+            bool Statement(TokenType type, bool in_interface)
+            {
+                bool valid = true;
+
+                switch (type)
+                {
+                case TokenType::Globals:
+                case TokenType::Loop:
+                case TokenType::Else:
+                case TokenType::EndGlobals:
+                case TokenType::EndFunction:
+                case TokenType::EndLibrary:
+                case TokenType::EndScope:
+                case TokenType::EndStruct:
+                case TokenType::EndInterface:
+                case TokenType::EndModule:
+                case TokenType::EndMethod:
+                case TokenType::EndIf:
+                case TokenType::EndLoop:
+                    Next();
+                    break;
+
+                case TokenType::Type:
+                    Next();
+                    valid = Name(true) && Expect(TokenType::Extends, U"Expected 'extends'") && TypeName() &&
+                        (!Accept(TokenType::Array) || Size());
+                    break;
+
+                case TokenType::Native:
+                    Next();
+                    valid = Name(true) && Signature();
+                    break;
+
+                case TokenType::Function:
+                    Next();
+                    Accept(TokenType::Interface);
+                    valid = Name(true) && Signature();
+                    break;
+
+                case TokenType::Method:
+                    Next();
+                    valid = (Accept(TokenType::Operator) ? OperatorName() : Name(true)) && Signature();
+
+                    // Interfaces can give methods a default instead of making them required
+                    if (valid && in_interface && IsWord(U"defaults"))
+                    {
+                        Next();
+                        valid = Accept(TokenType::Nothing) || Expression();
+                    }
+                    break;
+
+                case TokenType::Identifier:
+                    valid = Word();
+                    break;
+
+                case TokenType::Library:
+                case TokenType::Scope:
+                    Next();
+                    valid = Name(true) && Requirements();
+                    break;
+
+                case TokenType::Struct:
+                    Next();
+                    valid = Name(true) && Size() && Parents();
+                    break;
+
+                case TokenType::Interface:
+                    Next();
+                    valid = Name(true) && Parents();
+                    break;
+
+                case TokenType::Module:
+                    Next();
+                    valid = Name(true);
+                    break;
+
+                case TokenType::Implement:
+                    Next();
+                    if (IsWord(U"optional")) Next();
+                    valid = Name(false);
+                    break;
+
+                case TokenType::Local:
+                    Next();
+                    valid = Variable();
+                    break;
+
+                case TokenType::Set:
+                    Next();
+                    valid = Assignment();
+                    break;
+
+                case TokenType::Call:
+                    Next();
+                    valid = Call();
+                    break;
+
+                case TokenType::Return:
+                    Next();
+                    valid = Is(TokenType::Eof) || Expression();
+                    break;
+
+                case TokenType::ExitWhen:
+                    Next();
+                    valid = Expression();
+                    break;
+
+                case TokenType::If:
+                case TokenType::ElseIf:
+                    Next();
+                    valid = Condition();
+                    break;
+
+                default:
+                    return Fail(U"Expected a statement");
+                }
+
+                return valid && (Is(TokenType::Eof) || Fail(U"Expected the end of the line"));
+            }
+        };
+
+        // What a line starting with the keyword is, and the type of block it opens or closes
+        StatementKind KindOf(TokenType type, bool in_interface, bool is_static, int & block, bool & open)
+        {
+            auto opens = [&](StatementKind kind)
+            {
+                block = (int)kind;
+                open = true;
+                return kind;
+            };
+
+            auto closes = [&](StatementKind kind, StatementKind opener)
+            {
+                block = (int)opener;
+                open = false;
+                return kind;
+            };
+
+            switch (type)
+            {
+            case TokenType::Globals:      return opens(StatementKind::Globals);
+            case TokenType::Function:     return opens(StatementKind::Function);
+            case TokenType::Library:      return opens(StatementKind::Library);
+            case TokenType::Scope:        return opens(StatementKind::Scope);
+            case TokenType::Struct:       return opens(StatementKind::Struct);
+            case TokenType::Interface:    return opens(StatementKind::Interface);
+            case TokenType::Module:       return opens(StatementKind::Module);
+            case TokenType::Loop:         return opens(StatementKind::Loop);
+            case TokenType::Method:       return in_interface ? StatementKind::MethodDeclaration : opens(StatementKind::Method);
+
+            // Static ifs are closed by endif like the others
+            case TokenType::If:
+                opens(StatementKind::If);
+                return is_static ? StatementKind::StaticIf : StatementKind::If;
+
+            case TokenType::EndGlobals:   return closes(StatementKind::EndGlobals, StatementKind::Globals);
+            case TokenType::EndFunction:  return closes(StatementKind::EndFunction, StatementKind::Function);
+            case TokenType::EndLibrary:   return closes(StatementKind::EndLibrary, StatementKind::Library);
+            case TokenType::EndScope:     return closes(StatementKind::EndScope, StatementKind::Scope);
+            case TokenType::EndStruct:    return closes(StatementKind::EndStruct, StatementKind::Struct);
+            case TokenType::EndInterface: return closes(StatementKind::EndInterface, StatementKind::Interface);
+            case TokenType::EndModule:    return closes(StatementKind::EndModule, StatementKind::Module);
+            case TokenType::EndMethod:    return closes(StatementKind::EndMethod, StatementKind::Method);
+            case TokenType::EndIf:        return closes(StatementKind::EndIf, StatementKind::If);
+            case TokenType::EndLoop:      return closes(StatementKind::EndLoop, StatementKind::Loop);
+
+            case TokenType::Type:         return StatementKind::Type;
+            case TokenType::Native:       return StatementKind::Native;
+            case TokenType::Implement:    return StatementKind::Implement;
+            case TokenType::Local:        return StatementKind::Local;
+            case TokenType::Set:          return StatementKind::Set;
+            case TokenType::Call:         return StatementKind::Call;
+            case TokenType::Return:       return StatementKind::Return;
+            case TokenType::ExitWhen:     return StatementKind::ExitWhen;
+            case TokenType::ElseIf:       return StatementKind::ElseIf;
+            case TokenType::Else:         return StatementKind::Else;
+            default:                      return StatementKind::None;
+            }
+        }
+
+        bool IsBody(StatementKind kind)
+        {
+            return kind == StatementKind::Function || kind == StatementKind::Method || kind == StatementKind::If || kind == StatementKind::Loop;
+        }
+    }
+
+    int ParseStatement(StringView32 line, int state, LineSyntax & syntax, Vector<Diagnostic> & diagnostics)
+    {
+        LineState line_state = LineStateOf(state);
+        bool in_interface = state & IN_INTERFACE;
+        bool in_preprocessor = state & IN_PREPROCESSOR;
+
+        LineState end_state = ScanLineState(line, line_state);
+
+        auto result = [&]()
+        {
+            return (int)end_state | (in_interface ? IN_INTERFACE : 0) | (in_preprocessor ? IN_PREPROCESSOR : 0);
+        };
+
+        int idx = 0;
+        switch (line_state)
+        {
+        case LineState::CommentBlock:
+            idx = ReadCommentBlock(line, 0, false).Stop();
+            break;
+        case LineState::String:
+        case LineState::Rawcode:
+            // The rest of a statement from a line before
+            return result();
+        default:
+            break;
+        }
+
+        Token first = NextToken(line, idx);
+        while (first.Is(TokenType::CommentBlock, TokenType::CommentLine)) first = NextToken(line, first.Stop());
+
+        if (first.Is(TokenType::PreprocessorComment))
+        {
+            StringView32 directive = Directive(line, first);
+
+            if (StartsSkippedBlock(directive)) in_preprocessor = true;
+            if (EndsSkippedBlock(directive))   in_preprocessor = false;
+
+            return result();
+        }
+
+        if (in_preprocessor) return result();
+
+        bool continued = end_state == LineState::String || end_state == LineState::Rawcode;
+
+        Parser parser(line, idx, continued, syntax, diagnostics);
+        if (parser.Is(TokenType::Eof)) return result();
+
+        // Statements only compiled into debug builds
+        if (parser.IsWord(U"debug")) parser.Next();
+
+        bool is_static = false;
+        for (;;)
+        {
+            if (parser.Is(TokenType::Static)) is_static = true;
+
+            if (parser.Current().Is(TokenType::Private, TokenType::Public, TokenType::Static, TokenType::Constant) ||
+                parser.IsWord(U"stub") || parser.IsWord(U"readonly") || parser.IsWord(U"delegate"))
+            {
+                parser.Next();
+                continue;
+            }
+            break;
+        }
+
+        Token const& keyword = parser.Current();
+        syntax.x = keyword.Start();
+        syntax.size = keyword.Length();
+
+        TokenType type = keyword.Type();
+        if (parser.IsWord(U"library_once")) type = TokenType::Library;
+
+        StatementKind kind = KindOf(type, in_interface, is_static, syntax.block, syntax.open);
+
+        if (type == TokenType::Function && parser.Peek().Is(TokenType::Interface))
+        {
+            kind = StatementKind::FunctionInterface;
+            syntax.block = 0;
+            syntax.open = false;
+        }
+        else if (type == TokenType::Identifier)
+        {
+            kind = parser.WordKind();
+        }
+
+        if (type == TokenType::Interface)    in_interface = true;
+        if (type == TokenType::EndInterface) in_interface = false;
+
+        syntax.kind = (int)kind;
+
+        parser.Statement(type, in_interface);
+
+        return result();
+    }
+
+    String32 NestingError(StatementKind parent, StatementKind kind)
+    {
+        // Static ifs pick what gets compiled, anything can be inside of them
+        if (parent == StatementKind::StaticIf) return {};
+
+        bool top_level = parent == StatementKind::None || parent == StatementKind::Library || parent == StatementKind::Scope;
+        bool aggregate = parent == StatementKind::Struct || parent == StatementKind::Module;
+
+        switch (kind)
+        {
+        case StatementKind::Local:
+            if (parent == StatementKind::Function || parent == StatementKind::Method) return {};
+            if (IsBody(parent)) return U"Locals have to be declared at the start of a function";
+            return U"Statements have to be inside a function";
+
+        case StatementKind::Set:
+        case StatementKind::Call:
+        case StatementKind::Return:
+        case StatementKind::ExitWhen:
+        case StatementKind::If:
+        case StatementKind::Loop:
+            if (IsBody(parent)) return {};
+            return U"Statements have to be inside a function";
+
+        case StatementKind::ElseIf:
+            if (parent == StatementKind::If) return {};
+            return U"elseif has to be inside an if";
+
+        case StatementKind::Else:
+            if (parent == StatementKind::If) return {};
+            return U"else has to be inside an if";
+
+        case StatementKind::Variable:
+            if (parent == StatementKind::Globals || parent == StatementKind::Interface || aggregate) return {};
+            if (IsBody(parent)) return U"Locals have to be declared with local";
+            return U"Variables have to be declared inside globals";
+
+        case StatementKind::Method:
+            if (aggregate) return {};
+            return U"Methods have to be inside a struct or module";
+
+        case StatementKind::MethodDeclaration:
+            if (parent == StatementKind::Interface) return {};
+            return U"Methods have to be inside a struct or module";
+
+        case StatementKind::Implement:
+            if (aggregate) return {};
+            return U"Modules can only be implemented inside a struct or module";
+
+        case StatementKind::Library:
+            if (parent == StatementKind::None) return {};
+            return U"Libraries can't be inside of anything";
+
+        case StatementKind::Globals:
+        case StatementKind::Type:
+        case StatementKind::Native:
+        case StatementKind::FunctionInterface:
+        case StatementKind::Function:
+        case StatementKind::Declaration:
+        case StatementKind::Scope:
+        case StatementKind::Struct:
+        case StatementKind::Interface:
+        case StatementKind::Module:
+            if (top_level) return {};
+            return U"Has to be at the top level, or inside a library or scope";
+
+        default:
+            return {};
+        }
+    }
+}
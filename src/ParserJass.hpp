@@ -0,0 +1,64 @@
+#ifndef PARSERJASS_HPP
+#define PARSERJASS_HPP
+
+#include "String32.hpp"
+#include "StringView32.hpp"
+
+#include "Lexer.hpp"
+
+namespace Jass {
+    // What a line holds, as kept in LineSyntax::kind
+    enum class StatementKind : int {
+        None,
+
+        Globals,
+        EndGlobals,
+        Variable,
+        Type,
+        Native,
+        FunctionInterface,
+        Function,
+        EndFunction,
+
+        // vJass keyword and hook declarations
+        Declaration,
+
+        Library,
+        EndLibrary,
+        Scope,
+        EndScope,
+        Struct,
+        EndStruct,
+        Interface,
+        EndInterface,
+        Module,
+        EndModule,
+        Method,
+        EndMethod,
+        MethodDeclaration,
+        Implement,
+
+        Local,
+        Set,
+        Call,
+        Return,
+        ExitWhen,
+        If,
+        StaticIf,
+        ElseIf,
+        Else,
+        EndIf,
+        Loop,
+        EndLoop
+    };
+
+    // Parses the statement on a line, starting in the state the previous line ended in, and checks its syntax.
+    // Expressions are checked but not kept, the tree is only made of statements.
+    // Returns the state the line ends in, zero is the state at the start of the text.
+    int ParseStatement(StringView32 line, int state, LineSyntax & syntax, Vector<Diagnostic> & diagnostics);
+
+    // Why a statement can't be directly inside a block, empty if it can
+    String32 NestingError(StatementKind parent, StatementKind kind);
+}
+
+#endif // PARSERJASS_HPP
@@ -0,0 +1,181 @@
+#include "QuickOpen.hpp"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QKeyEvent>
+#include <QVBoxLayout>
+
+#include "Workspace.hpp"
+
+namespace
+{
+    constexpr int MAX_RESULTS = 50;
+}
+
+QuickOpen::QuickOpen(QWidget * parent) :
+    QWidget(parent)
+{
+    // Closes by itself once anything else is clicked
+    setWindowFlags(Qt::Popup);
+
+    pattern = new QLineEdit(this);
+    results = new QListWidget(this);
+
+    results->setUniformItemSizes(true);
+    results->setFocusPolicy(Qt::NoFocus);
+
+    QVBoxLayout * layout = new QVBoxLayout(this);
+    layout->setContentsMargins(2, 2, 2, 2);
+    layout->setSpacing(2);
+    layout->addWidget(pattern);
+    layout->addWidget(results);
+
+    connect(pattern, &QLineEdit::textChanged,
+        [this](...)
+        {
+            Update();
+        }
+    );
+
+    connect(pattern, &QLineEdit::returnPressed,
+        [this](...)
+        {
+            Activate(results->currentRow());
+        }
+    );
+
+    connect(results, &QListWidget::itemActivated,
+        [this](QListWidgetItem * item)
+        {
+            Activate(results->row(item));
+        }
+    );
+}
+
+void QuickOpen::PromptFile()
+{
+    Workspace & workspace = Workspace::Instance();
+    if (workspace.Root().isEmpty()) return;
+
+    QDir base(workspace.Root());
+
+    Vector<QString> paths = workspace.TextFiles();
+
+    targets.clear();
+    targets.reserve(paths.size());
+
+    matcher.Clear();
+    matcher.Reserve(paths.size(), 0);
+
+    for (QString & path : paths)
+    {
+        Target target;
+        target.text = base.relativeFilePath(path);
+        target.path = std::move(path);
+        target.cursor = Cursor{};
+
+        matcher.Add(String32(target.text.toStdU32String()));
+        targets.push_back(std::move(target));
+    }
+
+    Show();
+}
+
+void QuickOpen::PromptSymbol()
+{
+    Workspace & workspace = Workspace::Instance();
+    if (workspace.Root().isEmpty()) return;
+
+    QDir base(workspace.Root());
+
+    targets.clear();
+    matcher.Clear();
+
+    for (auto const& entry : workspace.Definitions())
+    {
+        for (SymbolDefinition const& definition : entry.second)
+        {
+            Position pos = definition.location.pos;
+
+            Target target;
+            target.path = workspace.FilePath(definition.location.file);
+            target.cursor.start = pos;
+            target.cursor.stop = { pos.y, pos.x + entry.first.size() };
+            target.text = QString("%1    %2:%3")
+                .arg(QString::fromStdU32String(entry.first))
+                .arg(base.relativeFilePath(target.path))
+                .arg(pos.y + 1);
+
+            matcher.Add(entry.first);
+            targets.push_back(std::move(target));
+        }
+    }
+
+    Show();
+}
+
+void QuickOpen::Show()
+{
+    // Left from the last time, with candidates that may have changed since
+    filter = FuzzyFilter();
+
+    QWidget * window = parentWidget()->window();
+
+    int width = std::max(400, window->width() / 2);
+    resize(width, window->height() / 2);
+    move(window->mapToGlobal(QPoint((window->width() - width) / 2, 0)));
+
+    show();
+
+    pattern->clear();
+    pattern->setFocus();
+
+    Update();
+}
+
+void QuickOpen::Update()
+{
+    matches = matcher.Match(String32(pattern->text().toStdU32String()), MAX_RESULTS, &filter);
+
+    results->clear();
+    for (FuzzyMatch const& match : matches)
+    {
+        new QListWidgetItem(targets[match.candidate].text, results);
+    }
+
+    results->setCurrentRow(0);
+}
+
+void QuickOpen::Activate(int row)
+{
+    if (row < 0 || row >= matches.size()) return;
+
+    Target const& target = targets[matches[row].candidate];
+
+    hide();
+    emit Activated(target.path, target.cursor);
+}
+
+void QuickOpen::keyPressEvent(QKeyEvent * event)
+{
+    int count = results->count();
+    int row = results->currentRow();
+
+    switch (event->key())
+    {
+    case Qt::Key_Up:
+        if (count != 0) results->setCurrentRow((row + count - 1) % count);
+        return;
+
+    case Qt::Key_Down:
+        if (count != 0) results->setCurrentRow((row + 1) % count);
+        return;
+
+    case Qt::Key_Escape:
+        hide();
+        return;
+    }
+
+    QWidget::keyPressEvent(event);
+}
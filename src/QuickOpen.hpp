@@ -0,0 +1,57 @@
+#ifndef QUICKOPEN_HPP
+#define QUICKOPEN_HPP
+
+#include <QLineEdit>
+#include <QListWidget>
+#include <QWidget>
+
+#include "Vector.hpp"
+
+#include "Cursor.hpp"
+#include "FuzzyMatcher.hpp"
+
+// Opens a file of the workspace, or goes to a symbol defined in it, by typing a few of the characters of its name.
+// The candidates are ranked again on every key, only the best ones are listed.
+class QuickOpen : public QWidget
+{
+    Q_OBJECT
+
+private:
+    struct Target
+    {
+        QString path;
+        Cursor cursor;
+
+        // What is listed, the candidate itself is only what is matched against
+        QString text;
+    };
+
+    QLineEdit * pattern;
+    QListWidget * results;
+
+    Vector<Target> targets;
+
+    FuzzyMatcher matcher;
+    FuzzyFilter filter;
+
+    Vector<FuzzyMatch> matches;
+
+    void Show();
+    void Update();
+    void Activate(int row);
+
+signals:
+    void Activated(QString const& path, Cursor cursor);
+
+public:
+    explicit QuickOpen(QWidget * parent = nullptr);
+
+    void PromptFile();
+    void PromptSymbol();
+
+    // QWidget interface
+protected:
+    void keyPressEvent(QKeyEvent * event);
+};
+
+#endif // QUICKOPEN_HPP
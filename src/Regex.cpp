@@ -0,0 +1,894 @@
+#include "Regex.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#include "SpecialCharacters.hpp"
+
+namespace
+{
+    // Patterns that expand past this are rejected instead of eating memory
+    constexpr int MAX_NODES = 1 << 16;
+
+    // Cached DFA states are dropped once there are this many, even in the middle of a line
+    constexpr int MAX_STATES = 4096;
+
+    constexpr int MAX_REPEAT = 1000;
+
+    // Expressions are compiled on whatever thread needs them
+    std::atomic<int> next_id(0);
+
+    // Most forward scans die within a few characters, only the positions of longer ones are remembered
+    constexpr int REMEMBER_AFTER = 32;
+
+    int HexValue(char32_t ch)
+    {
+        if (ch >= '0' && ch <= '9') return ch - '0';
+        if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+        if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+        return -1;
+    }
+}
+
+int Regex::AddTerm(TermType type)
+{
+    Term term;
+    term.type = type;
+    terms.push_back(term);
+    return terms.size() - 1;
+}
+
+int Regex::ParseAlternate()
+{
+    int first = ParseConcat();
+    if (first == -1) return -1;
+
+    if (pos == source.size() || source[pos] != U'|') return first;
+
+    int term = AddTerm(TERM_ALTERNATE);
+    terms[term].children.push_back(first);
+
+    while (pos < source.size() && source[pos] == U'|')
+    {
+        pos++;
+
+        int next = ParseConcat();
+        if (next == -1) return -1;
+
+        terms[term].children.push_back(next);
+    }
+
+    return term;
+}
+
+int Regex::ParseConcat()
+{
+    int term = AddTerm(TERM_CONCAT);
+
+    while (pos < source.size() && source[pos] != U'|' && source[pos] != U')')
+    {
+        int child = ParseRepeat();
+        if (child == -1) return -1;
+
+        terms[term].children.push_back(child);
+    }
+
+    return term;
+}
+
+int Regex::ParseRepeat()
+{
+    int atom = ParseAtom();
+    if (atom == -1) return -1;
+
+    while (pos < source.size())
+    {
+        int min = 0;
+        int max = -1;
+
+        char32_t ch = source[pos];
+        if (ch == U'*')
+        {
+            pos++;
+        }
+        else if (ch == U'+')
+        {
+            min = 1;
+            pos++;
+        }
+        else if (ch == U'?')
+        {
+            max = 1;
+            pos++;
+        }
+        else if (ch == U'{')
+        {
+            // Braces that don't make up a count are matched literally
+            int save = pos++;
+
+            if (!ParseNumber(min))
+            {
+                pos = save;
+                break;
+            }
+
+            max = min;
+            if (pos < source.size() && source[pos] == U',')
+            {
+                pos++;
+
+                max = -1;
+                if (pos < source.size() && source[pos] != U'}' && !ParseNumber(max))
+                {
+                    pos = save;
+                    break;
+                }
+            }
+
+            if (pos == source.size() || source[pos] != U'}')
+            {
+                pos = save;
+                break;
+            }
+            pos++;
+
+            if (min > MAX_REPEAT || max > MAX_REPEAT || (max != -1 && max < min)) return -1;
+        }
+        else
+        {
+            break;
+        }
+
+        // Lazy and possessive quantifiers make no difference to leftmost-longest matches
+        if (pos < source.size() && (source[pos] == U'?' || source[pos] == U'+')) pos++;
+
+        int term = AddTerm(TERM_REPEAT);
+        terms[term].min = min;
+        terms[term].max = max;
+        terms[term].children.push_back(atom);
+
+        atom = term;
+    }
+
+    return atom;
+}
+
+int Regex::ParseAtom()
+{
+    char32_t ch = source[pos++];
+
+    switch (ch)
+    {
+    case U'(':
+    {
+        // Groups don't capture anyway
+        if (pos + 1 < source.size() && source[pos] == U'?' && source[pos + 1] == U':') pos += 2;
+
+        int inner = ParseAlternate();
+        if (inner == -1 || pos == source.size() || source[pos] != U')') return -1;
+
+        pos++;
+        return inner;
+    }
+    case U'*':
+    case U'+':
+    case U'?':
+        // Nothing to repeat
+        return -1;
+    case U'.':
+        return AddTerm(TERM_ANY);
+    case U'^':
+        return AddTerm(TERM_LINE_START);
+    case U'$':
+        return AddTerm(TERM_LINE_END);
+    case U'[':
+        return ParseClass();
+    case U'\\':
+    {
+        CharClass cls;
+        int kind = ParseEscape(cls, ch);
+        if (kind == -1) return -1;
+
+        if (kind == 1)
+        {
+            classes.push_back(cls);
+
+            int term = AddTerm(TERM_CLASS);
+            terms[term].cls = classes.size() - 1;
+            return term;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    int term = AddTerm(TERM_CHAR);
+    terms[term].ch = match_case ? ch : FoldCase(ch);
+    return term;
+}
+
+int Regex::ParseClass()
+{
+    CharClass cls;
+
+    if (pos < source.size() && source[pos] == U'^')
+    {
+        cls.negated = true;
+        pos++;
+    }
+
+    // A bracket right at the start is part of the class
+    bool first = true;
+
+    while (true)
+    {
+        if (pos == source.size()) return -1;
+
+        char32_t lo = source[pos];
+        if (lo == U']' && !first) break;
+
+        first = false;
+        pos++;
+
+        if (lo == U'\\')
+        {
+            CharClass sub;
+
+            int kind = ParseEscape(sub, lo);
+            if (kind == -1) return -1;
+
+            if (kind == 1)
+            {
+                cls.kinds |= sub.kinds;
+                cls.excluded_kinds |= sub.excluded_kinds;
+                continue;
+            }
+        }
+
+        char32_t hi = lo;
+        if (pos + 1 < source.size() && source[pos] == U'-' && source[pos + 1] != U']')
+        {
+            pos++;
+            hi = source[pos++];
+
+            if (hi == U'\\')
+            {
+                CharClass sub;
+                if (ParseEscape(sub, hi) != 0) return -1;
+            }
+
+            if (hi < lo) return -1;
+        }
+
+        cls.ranges.push_back({ lo, hi });
+    }
+
+    pos++;
+
+    classes.push_back(cls);
+
+    int term = AddTerm(TERM_CLASS);
+    terms[term].cls = classes.size() - 1;
+    return term;
+}
+
+int Regex::ParseEscape(CharClass & cls, char32_t & ch)
+{
+    if (pos == source.size()) return -1;
+
+    ch = source[pos++];
+
+    switch (ch)
+    {
+    case U'd': cls.kinds |= KIND_DIGIT; return 1;
+    case U'w': cls.kinds |= KIND_WORD;  return 1;
+    case U's': cls.kinds |= KIND_SPACE; return 1;
+
+    case U'D': cls.excluded_kinds |= KIND_DIGIT; return 1;
+    case U'W': cls.excluded_kinds |= KIND_WORD;  return 1;
+    case U'S': cls.excluded_kinds |= KIND_SPACE; return 1;
+
+    case U't': ch = U'\t'; return 0;
+    case U'n': ch = U'\n'; return 0;
+    case U'r': ch = U'\r'; return 0;
+    case U'f': ch = U'\f'; return 0;
+    case U'v': ch = U'\v'; return 0;
+
+    case U'x':
+    case U'u':
+    {
+        // \xHH, \uHHHH or either with any number of digits in braces
+        bool braced = pos < source.size() && source[pos] == U'{';
+        if (braced) pos++;
+
+        int digits = ch == U'x' ? 2 : 4;
+
+        char32_t value = 0;
+        int count = 0;
+        while (pos < source.size() && (braced || count < digits) && HexValue(source[pos]) != -1 && count < 8)
+        {
+            value = value * 16 + HexValue(source[pos++]);
+            count++;
+        }
+
+        if (count == 0 || (!braced && count != digits)) return -1;
+
+        if (braced)
+        {
+            if (pos == source.size() || source[pos] != U'}') return -1;
+            pos++;
+        }
+
+        ch = value;
+        return 0;
+    }
+    default:
+        break;
+    }
+
+    // Letters and digits are reserved for escapes that aren't supported, like word boundaries and backreferences
+    if (IsAsciiLetter(ch) || IsDigit(ch)) return -1;
+
+    return 0;
+}
+
+bool Regex::ParseNumber(int & value)
+{
+    int start = pos;
+
+    value = 0;
+    while (pos < source.size() && IsDigit(source[pos]))
+    {
+        value = std::min(value * 10 + (int)(source[pos] - U'0'), MAX_REPEAT + 1);
+        pos++;
+    }
+
+    return pos != start;
+}
+
+bool Regex::ClassContains(CharClass const& cls, char32_t ch) const
+{
+    for (auto const& range : cls.ranges)
+    {
+        if (ch >= range.first && ch <= range.second) return true;
+    }
+
+    if ((cls.kinds & KIND_DIGIT) && IsDigit(ch))          return true;
+    if ((cls.kinds & KIND_WORD)  && IsIdentifierChar(ch)) return true;
+    if ((cls.kinds & KIND_SPACE) && IsSpace(ch))          return true;
+
+    if ((cls.excluded_kinds & KIND_DIGIT) && !IsDigit(ch))          return true;
+    if ((cls.excluded_kinds & KIND_WORD)  && !IsIdentifierChar(ch)) return true;
+    if ((cls.excluded_kinds & KIND_SPACE) && !IsSpace(ch))          return true;
+
+    return false;
+}
+
+bool Regex::NodeMatches(Node const& node, char32_t ch) const
+{
+    switch (node.type)
+    {
+    case NODE_CHAR:
+        return node.ch == (match_case ? ch : FoldCase(ch));
+    case NODE_ANY:
+        return true;
+    case NODE_CLASS:
+    {
+        CharClass const& cls = classes[node.cls];
+
+        // Other cases of the character count before the class is negated, so [^a] doesn't match A either
+        bool found = ClassContains(cls, ch);
+        if (!found && !match_case)
+        {
+            found = ClassContains(cls, ToLower(ch)) || ClassContains(cls, ToUpper(ch));
+        }
+
+        return found != cls.negated;
+    }
+    default:
+        return false;
+    }
+}
+
+int Regex::Emit(Automaton & automaton, int term, int next, bool reverse)
+{
+    if (automaton.nodes.size() > MAX_NODES) return next;
+
+    auto add = [&automaton](NodeType type, char32_t ch, int cls, int out, int out1)
+    {
+        automaton.nodes.push_back({ type, ch, cls, out, out1 });
+        return automaton.nodes.size() - 1;
+    };
+
+    Term const& t = terms[term];
+
+    switch (t.type)
+    {
+    case TERM_EMPTY:
+        return next;
+    case TERM_CHAR:
+        return add(NODE_CHAR, t.ch, -1, next, -1);
+    case TERM_ANY:
+        return add(NODE_ANY, 0, -1, next, -1);
+    case TERM_CLASS:
+        return add(NODE_CLASS, 0, t.cls, next, -1);
+
+    // Backwards the line is read from its end
+    case TERM_LINE_START:
+        return add(reverse ? NODE_INPUT_END : NODE_INPUT_START, 0, -1, next, -1);
+    case TERM_LINE_END:
+        return add(reverse ? NODE_INPUT_START : NODE_INPUT_END, 0, -1, next, -1);
+
+    case TERM_CONCAT:
+        if (reverse)
+        {
+            for (int idx = 0; idx < t.children.size(); idx++) next = Emit(automaton, t.children[idx], next, reverse);
+        }
+        else
+        {
+            for (int idx = t.children.size() - 1; idx >= 0; idx--) next = Emit(automaton, t.children[idx], next, reverse);
+        }
+        return next;
+
+    case TERM_ALTERNATE:
+    {
+        int entry = Emit(automaton, t.children.back(), next, reverse);
+        for (int idx = t.children.size() - 2; idx >= 0; idx--)
+        {
+            int branch = Emit(automaton, t.children[idx], next, reverse);
+            entry = add(NODE_SPLIT, 0, -1, branch, entry);
+        }
+        return entry;
+    }
+
+    case TERM_REPEAT:
+    {
+        int child = t.children.front();
+
+        int entry = next;
+        if (t.max == -1)
+        {
+            int loop = add(NODE_SPLIT, 0, -1, -1, next);
+
+            int body = Emit(automaton, child, loop, reverse);
+            automaton.nodes[loop].out = body;
+
+            entry = loop;
+        }
+        else
+        {
+            // Every optional copy can skip straight to the end
+            for (int idx = t.min; idx < t.max; idx++)
+            {
+                int body = Emit(automaton, child, entry, reverse);
+                entry = add(NODE_SPLIT, 0, -1, body, next);
+            }
+        }
+
+        for (int idx = 0; idx < t.min; idx++) entry = Emit(automaton, child, entry, reverse);
+
+        return entry;
+    }
+    }
+
+    return next;
+}
+
+void Regex::Build(Automaton & automaton, int root, bool reverse, bool unanchored)
+{
+    automaton.nodes.clear();
+    automaton.nodes.push_back({ NODE_MATCH, 0, -1, -1, -1 });
+
+    automaton.start = Emit(automaton, root, 0, reverse);
+    automaton.unanchored = unanchored;
+
+    Dfa dfa;
+    dfa.marks.assign(automaton.nodes.size(), 0);
+
+    automaton.matches_empty = Reaches(automaton, dfa, { automaton.start }, true, true);
+}
+
+void Regex::ResetStates(Dfa & dfa)
+{
+    dfa.states.clear();
+    dfa.state_ids.clear();
+    dfa.accepting.clear();
+
+    dfa.table.clear();
+    dfa.wide_transitions.clear();
+
+    dfa.initial[0] = -1;
+    dfa.initial[1] = -1;
+}
+
+void Regex::Prepare(Cache & cache) const
+{
+    if (cache.regex_id == id) return;
+    cache.regex_id = id;
+
+    ResetStates(cache.forward);
+    cache.forward.marks.assign(forward.nodes.size(), 0);
+    cache.forward.generation = 0;
+
+    ResetStates(cache.backward);
+    cache.backward.marks.assign(backward.nodes.size(), 0);
+    cache.backward.generation = 0;
+}
+
+int Regex::AddState(Automaton const& automaton, Dfa & dfa, Vector<int> const& seeds, bool at_start) const
+{
+    // Follows splits and the assertions that hold, the nodes left are what the state is made of
+    dfa.generation++;
+
+    Vector<int> stack = seeds;
+    Vector<int> nodes;
+
+    while (!stack.empty())
+    {
+        int idx = stack.back();
+        stack.pop_back();
+
+        if (dfa.marks[idx] == dfa.generation) continue;
+        dfa.marks[idx] = dfa.generation;
+
+        Node const& node = automaton.nodes[idx];
+        switch (node.type)
+        {
+        case NODE_SPLIT:
+            stack.push_back(node.out1);
+            stack.push_back(node.out);
+            break;
+        case NODE_INPUT_START:
+            // Can't hold later on either, so it is dropped
+            if (at_start) stack.push_back(node.out);
+            break;
+        default:
+            nodes.push_back(idx);
+            break;
+        }
+    }
+
+    std::sort(nodes.begin(), nodes.end());
+
+    String32 key(nodes.size(), 0);
+    for (int idx = 0; idx < nodes.size(); idx++) key[idx] = (char32_t)nodes[idx];
+
+    auto it = dfa.state_ids.find(key);
+    if (it != dfa.state_ids.end()) return it->second;
+
+    State state;
+    state.hash = 14695981039346656037ull;
+    for (int idx : nodes) state.hash = (state.hash ^ (std::uint64_t)idx) * 1099511628211ull;
+
+    state.accepts = std::any_of(nodes.begin(), nodes.end(), [&automaton](int idx) { return automaton.nodes[idx].type == NODE_MATCH; });
+    state.accepts_at_end = state.accepts || Reaches(automaton, dfa, nodes, false, true);
+    state.dead = nodes.empty() && !automaton.unanchored;
+    state.nodes = std::move(nodes);
+
+    dfa.accepting.push_back(state.accepts || state.accepts_at_end);
+    dfa.states.push_back(std::move(state));
+    dfa.table.insert(dfa.table.size(), -1, 128);
+
+    int state_id = dfa.states.size() - 1;
+    dfa.state_ids[key] = state_id;
+    return state_id;
+}
+
+bool Regex::Reaches(Automaton const& automaton, Dfa & dfa, Vector<int> const& seeds, bool at_start, bool at_end) const
+{
+    dfa.generation++;
+
+    Vector<int> stack = seeds;
+    while (!stack.empty())
+    {
+        int idx = stack.back();
+        stack.pop_back();
+
+        if (dfa.marks[idx] == dfa.generation) continue;
+        dfa.marks[idx] = dfa.generation;
+
+        Node const& node = automaton.nodes[idx];
+        switch (node.type)
+        {
+        case NODE_MATCH:
+            return true;
+        case NODE_SPLIT:
+            stack.push_back(node.out1);
+            stack.push_back(node.out);
+            break;
+        case NODE_INPUT_START:
+            if (at_start) stack.push_back(node.out);
+            break;
+        case NODE_INPUT_END:
+            if (at_end) stack.push_back(node.out);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+int Regex::Initial(Automaton const& automaton, Dfa & dfa, bool at_start) const
+{
+    int & state = dfa.initial[at_start];
+    if (state == -1) state = AddState(automaton, dfa, { automaton.start }, at_start);
+    return state;
+}
+
+int Regex::Step(Automaton const& automaton, Dfa & dfa, int state, char32_t ch) const
+{
+    std::uint64_t wide_key = ((std::uint64_t)state << 32) | ch;
+
+    // Transitions are only worked out the first time they are taken
+    if (ch < 128)
+    {
+        int next = dfa.table[state * 128 + ch];
+        if (next != -1) return next;
+    }
+    else
+    {
+        auto it = dfa.wide_transitions.find(wide_key);
+        if (it != dfa.wide_transitions.end()) return it->second;
+    }
+
+    // A single long line can keep adding states, so the cache starts over from the state the scan is in
+    if (dfa.states.size() >= MAX_STATES)
+    {
+        Vector<int> nodes = dfa.states[state].nodes;
+
+        ResetStates(dfa);
+        state = AddState(automaton, dfa, nodes, false);
+
+        wide_key = ((std::uint64_t)state << 32) | ch;
+    }
+
+    Vector<int> seeds;
+    for (int idx : dfa.states[state].nodes)
+    {
+        Node const& node = automaton.nodes[idx];
+        if (NodeMatches(node, ch)) seeds.push_back(node.out);
+    }
+
+    if (automaton.unanchored) seeds.push_back(automaton.start);
+
+    int next = AddState(automaton, dfa, seeds, false);
+
+    if (ch < 128) dfa.table[state * 128 + ch] = next;
+    else          dfa.wide_transitions[wide_key] = next;
+
+    return next;
+}
+
+void Regex::ScanStarts(StringView32 line, int x, Cache & cache) const
+{
+    Dfa & dfa = cache.backward;
+    Vector<bool> & starts = cache.starts;
+
+    starts.assign(line.size() + 1, false);
+
+    // Read backwards, a match is accepted at the position it starts at
+    int state = Initial(backward, dfa, true);
+    starts[line.size()] = line.size() == 0 ? backward.matches_empty : dfa.states[state].accepts;
+
+    // Taken transitions are looked up straight from the table, which only moves when a state is added
+    int const* table = dfa.table.data();
+    char const* accepting = dfa.accepting.data();
+
+    for (int idx = line.size() - 1; idx >= x; idx--)
+    {
+        char32_t ch = line[idx];
+
+        int next = ch < 128 ? table[state * 128 + ch] : -1;
+        if (next == -1)
+        {
+            next = Step(backward, dfa, state, ch);
+
+            table = dfa.table.data();
+            accepting = dfa.accepting.data();
+        }
+        state = next;
+
+        if (accepting[state]) starts[idx] = idx == 0 ? dfa.states[state].accepts_at_end : dfa.states[state].accepts;
+    }
+}
+
+void Regex::ResetScanned(Cache & cache)
+{
+    // The heads are only filled in once a scan gets long enough to be remembered
+    cache.scanned_heads.clear();
+    cache.scanned.clear();
+}
+
+int Regex::LongestMatch(StringView32 line, int x, bool remember, Cache & cache) const
+{
+    Dfa & dfa = cache.forward;
+    Vector<int> & scanned_heads = cache.scanned_heads;
+    Vector<Scanned> & scanned = cache.scanned;
+    Vector<Scanned> & scan_path = cache.scan_path;
+
+    auto accepts = [&dfa, line](int state, int idx)
+    {
+        State const& current = dfa.states[state];
+        return idx == line.size() ? current.accepts_at_end : current.accepts;
+    };
+
+    if (line.size() == 0) return forward.matches_empty ? 0 : -1;
+
+    int state = Initial(forward, dfa, x == 0);
+    int stop = accepts(state, x) ? x : -1;
+
+    // Each position is scanned at most once in every state, a scan is stepped until it dies or meets an earlier one
+    int found_stop = -1;
+    int path_start = x + REMEMBER_AFTER;
+    scan_path.clear();
+
+    for (int idx = x; ; )
+    {
+        if (remember && idx >= path_start)
+        {
+            if (scanned_heads.empty()) scanned_heads.assign(line.size() + 1, -1);
+
+            std::uint64_t hash = dfa.states[state].hash;
+
+            int found = scanned_heads[idx];
+            while (found != -1 && scanned[found].hash != hash) found = scanned[found].next;
+
+            if (found != -1)
+            {
+                found_stop = scanned[found].stop;
+                stop = std::max(stop, found_stop);
+                break;
+            }
+
+            scan_path.push_back({ hash, accepts(state, idx) ? idx : -1, -1 });
+        }
+
+        if (idx == line.size()) break;
+
+        state = Step(forward, dfa, state, line[idx++]);
+        if (dfa.states[state].dead) break;
+
+        if (accepts(state, idx)) stop = idx;
+    }
+
+    // The furthest end after each position of the scan is the one the rest of it reached
+    for (int idx = scan_path.size() - 1; idx >= 0; idx--)
+    {
+        int pos = path_start + idx;
+        found_stop = std::max(found_stop, scan_path[idx].stop);
+
+        scanned.push_back({ scan_path[idx].hash, found_stop, scanned_heads[pos] });
+        scanned_heads[pos] = scanned.size() - 1;
+    }
+
+    return stop;
+}
+
+void Regex::CollectLiterals(int term, Vector<String32> & literals) const
+{
+    Term const& t = terms[term];
+
+    switch (t.type)
+    {
+    case TERM_CHAR:
+        literals.push_back(String32(1, t.ch));
+        break;
+    case TERM_CONCAT:
+    {
+        // Runs of characters are one literal, anything else in between splits them
+        String32 run;
+        for (int child : t.children)
+        {
+            TermType type = terms[child].type;
+
+            if (type == TERM_CHAR)
+            {
+                run += terms[child].ch;
+                continue;
+            }
+
+            // Assertions take up no room, so the characters on both sides are still next to each other
+            if (type == TERM_LINE_START || type == TERM_LINE_END) continue;
+
+            if (!run.empty()) literals.push_back(run);
+            run.clear();
+
+            CollectLiterals(child, literals);
+        }
+
+        if (!run.empty()) literals.push_back(run);
+        break;
+    }
+    case TERM_REPEAT:
+        if (t.min > 0) CollectLiterals(t.children[0], literals);
+        break;
+    default:
+        // Any branch of an alternation can match on its own, so none of them is required
+        break;
+    }
+}
+
+bool Regex::Compile(StringView32 pattern, bool case_sensitive)
+{
+    terms.clear();
+    classes.clear();
+
+    match_case = case_sensitive;
+    valid = false;
+
+    source = pattern;
+    pos = 0;
+
+    root = ParseAlternate();
+    if (root == -1 || pos != source.size()) return false;
+
+    Build(forward, root, false, false);
+    Build(backward, root, true, true);
+
+    if (forward.nodes.size() > MAX_NODES || backward.nodes.size() > MAX_NODES) return false;
+
+    id = next_id++;
+    valid = true;
+    return true;
+}
+
+bool Regex::IsValid() const
+{
+    return valid;
+}
+
+bool Regex::Find(StringView32 line, int x, int & start, int & stop, Cache & cache) const
+{
+    if (!valid || x > line.size()) return false;
+
+    Prepare(cache);
+    ScanStarts(line, x, cache);
+
+    for (int idx = x; idx <= line.size(); idx++)
+    {
+        if (!cache.starts[idx]) continue;
+
+        int end = LongestMatch(line, idx, false, cache);
+        if (end == -1) continue;
+
+        start = idx;
+        stop = end;
+        return true;
+    }
+
+    return false;
+}
+
+void Regex::FindAll(StringView32 line, Vector<std::pair<int, int>> & matches, Cache & cache) const
+{
+    if (!valid) return;
+
+    Prepare(cache);
+    ScanStarts(line, 0, cache);
+    ResetScanned(cache);
+
+    for (int idx = 0; idx <= line.size(); )
+    {
+        int end = cache.starts[idx] ? LongestMatch(line, idx, true, cache) : -1;
+        if (end == -1)
+        {
+            idx++;
+            continue;
+        }
+
+        matches.push_back({ idx, end });
+
+        // Empty matches would be found again at the same place
+        idx = end > idx ? end : idx + 1;
+    }
+}
+
+Vector<String32> Regex::Literals() const
+{
+    Vector<String32> literals;
+    if (valid) CollectLiterals(root, literals);
+    return literals;
+}
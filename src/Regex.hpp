@@ -0,0 +1,245 @@
+#ifndef REGEX_HPP
+#define REGEX_HPP
+
+#include <cstdint>
+#include <utility>
+
+#include "HashMap.hpp"
+#include "String32.hpp"
+#include "StringView32.hpp"
+#include "Vector.hpp"
+
+// Regular expressions run as a DFA that is built lazily while lines are searched, so there is no backtracking.
+// Matches are leftmost-longest and never span lines. Captures, backreferences and lookaround aren't supported.
+class Regex
+{
+private:
+    enum TermType
+    {
+        TERM_EMPTY,
+        TERM_CHAR,
+        TERM_ANY,
+        TERM_CLASS,
+        TERM_LINE_START,
+        TERM_LINE_END,
+        TERM_CONCAT,
+        TERM_ALTERNATE,
+        TERM_REPEAT
+    };
+
+    // Parse tree, compiled once forwards and once backwards
+    struct Term
+    {
+        TermType type;
+        char32_t ch = 0;
+        int cls = -1;
+
+        // Repetition count, max is -1 when unbounded
+        int min = 0;
+        int max = 0;
+
+        Vector<int> children;
+    };
+
+    enum CharKind
+    {
+        KIND_DIGIT = 1 << 0,
+        KIND_WORD  = 1 << 1,
+        KIND_SPACE = 1 << 2
+    };
+
+    struct CharClass
+    {
+        Vector<std::pair<char32_t, char32_t>> ranges;
+
+        // Character kinds that are in the class, and ones whose complement is
+        int kinds = 0;
+        int excluded_kinds = 0;
+
+        bool negated = false;
+    };
+
+    enum NodeType
+    {
+        NODE_CHAR,
+        NODE_ANY,
+        NODE_CLASS,
+        NODE_SPLIT,
+        NODE_INPUT_START,
+        NODE_INPUT_END,
+        NODE_MATCH
+    };
+
+    struct Node
+    {
+        NodeType type;
+        char32_t ch;
+        int cls;
+        int out;
+        int out1;
+    };
+
+    struct State
+    {
+        // Sorted nodes that consume a character, match or wait for the end of the input
+        Vector<int> nodes;
+
+        // Tells states apart even after they were dropped and added again under another id
+        std::uint64_t hash;
+
+        bool accepts;
+        bool accepts_at_end;
+        bool dead;
+    };
+
+    // An NFA, compiled once and only read while searching
+    struct Automaton
+    {
+        Vector<Node> nodes;
+        int start = 0;
+
+        // Unanchored automatons can start a match after every character
+        bool unanchored = false;
+
+        // Whether an empty line matches, where the input starts and ends at once
+        bool matches_empty = false;
+    };
+
+    // The DFA states found for an automaton so far
+    struct Dfa
+    {
+        Vector<State> states;
+        HashMap<String32, int> state_ids;
+
+        // Whether a state accepts anywhere, kept apart so the scan loop touches as little memory as it can
+        Vector<char> accepting;
+
+        // Transitions on ASCII characters are a table lookup, -1 until they are first taken
+        Vector<int> table;
+        HashMap<std::uint64_t, int> wide_transitions;
+
+        // Start states at the very start of the input and anywhere else
+        int initial[2] = { -1, -1 };
+
+        Vector<int> marks;
+        int generation = 0;
+    };
+
+    // A state a forward scan was in at some position, and the furthest match end it reached from there on
+    struct Scanned
+    {
+        std::uint64_t hash;
+        int stop;
+
+        // The next one at the same position, -1 at the last
+        int next;
+    };
+
+public:
+    // What searching builds up as it goes, the expression itself isn't changed so one cache per thread is enough
+    class Cache
+    {
+    private:
+        friend class Regex;
+
+        // The expression the states were built for, they are dropped when the cache is used with another one
+        int regex_id = -1;
+
+        Dfa forward;
+        Dfa backward;
+
+        // Match starts found by the last backward scan
+        Vector<bool> starts;
+
+        // Forward scans of the line FindAll searches, chained by position. A scan that gets to a position in a
+        // state an earlier one was in there goes on the same way, so it stops and takes the end the earlier one found.
+        Vector<int> scanned_heads;
+        Vector<Scanned> scanned;
+        Vector<Scanned> scan_path;
+
+    public:
+        Cache() = default;
+    };
+
+private:
+    Vector<Term> terms;
+    Vector<CharClass> classes;
+
+    int root = -1;
+
+    bool valid = false;
+    bool match_case = true;
+
+    // Tells compiled expressions apart, copies keep it since they build the same states
+    int id = -1;
+
+    Automaton forward;
+    Automaton backward;
+
+    // Parser
+    StringView32 source;
+    int pos = 0;
+
+    int AddTerm(TermType type);
+
+    int ParseAlternate();
+    int ParseConcat();
+    int ParseRepeat();
+    int ParseAtom();
+    int ParseClass();
+
+    // Returns 0 for a character, 1 for a class of them and -1 if the escape isn't supported
+    int ParseEscape(CharClass & cls, char32_t & ch);
+
+    bool ParseNumber(int & value);
+
+    // Ignores whether the class is negated
+    bool ClassContains(CharClass const& cls, char32_t ch) const;
+    bool NodeMatches(Node const& node, char32_t ch) const;
+
+    void CollectLiterals(int term, Vector<String32> & literals) const;
+
+    // Builds the nodes of a term in front of next and returns the first one
+    int Emit(Automaton & automaton, int term, int next, bool reverse);
+
+    void Build(Automaton & automaton, int root, bool reverse, bool unanchored);
+
+    static void ResetStates(Dfa & dfa);
+
+    // Starts the cache over if it was built for another expression
+    void Prepare(Cache & cache) const;
+
+    int AddState(Automaton const& automaton, Dfa & dfa, Vector<int> const& seeds, bool at_start) const;
+    // Follows splits and assertions from the seeds until a match is reached
+    bool Reaches(Automaton const& automaton, Dfa & dfa, Vector<int> const& seeds, bool at_start, bool at_end) const;
+
+    int Initial(Automaton const& automaton, Dfa & dfa, bool at_start) const;
+    int Step(Automaton const& automaton, Dfa & dfa, int state, char32_t ch) const;
+
+    // Marks where matches start from x on, scanning the line backwards
+    void ScanStarts(StringView32 line, int x, Cache & cache) const;
+
+    static void ResetScanned(Cache & cache);
+
+    // The end of the longest match starting at x, reusing earlier scans of the line if remember is set
+    int LongestMatch(StringView32 line, int x, bool remember, Cache & cache) const;
+
+public:
+    Regex() = default;
+
+    // Returns false if the pattern isn't valid
+    bool Compile(StringView32 pattern, bool case_sensitive);
+
+    bool IsValid() const;
+
+    // The leftmost match starting at or after x, and the longest one among those starting there
+    bool Find(StringView32 line, int x, int & start, int & stop, Cache & cache) const;
+
+    // Every match that doesn't overlap the ones before it
+    void FindAll(StringView32 line, Vector<std::pair<int, int>> & matches, Cache & cache) const;
+
+    // Strings every match contains, folded unless the expression matches case
+    Vector<String32> Literals() const;
+};
+
+#endif // REGEX_HPP
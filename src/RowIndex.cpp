@@ -0,0 +1,128 @@
+#include "RowIndex.hpp"
+
+#include <algorithm>
+
+void RowIndex::Build()
+{
+    int size = counts.size();
+
+    tree.assign(size + 1, 0);
+
+    total = 0;
+    irregular = 0;
+
+    for (int idx = 1; idx <= size; idx++)
+    {
+        int rows = counts[idx - 1];
+
+        total += rows;
+        irregular += rows != 1;
+
+        tree[idx] += rows;
+
+        int parent = idx + (idx & -idx);
+        if (parent <= size) tree[parent] += tree[idx];
+    }
+
+    stale = false;
+}
+
+void RowIndex::Reset(int line_count)
+{
+    counts.assign(line_count, 1);
+    Build();
+}
+
+void RowIndex::Insert(int line_idx, int count)
+{
+    counts.insert(line_idx, 1, count);
+    total += count;
+
+    stale = true;
+}
+
+void RowIndex::Remove(int line_idx, int count)
+{
+    for (int idx = line_idx; idx < line_idx + count; idx++)
+    {
+        total -= counts[idx];
+        irregular -= counts[idx] != 1;
+    }
+
+    counts.remove(line_idx, count);
+
+    stale = true;
+}
+
+int RowIndex::Rows(int line_idx) const
+{
+    return counts[line_idx];
+}
+
+void RowIndex::SetRows(int line_idx, int rows)
+{
+    int delta = rows - counts[line_idx];
+    if (delta == 0) return;
+
+    irregular += (rows != 1) - (counts[line_idx] != 1);
+
+    counts[line_idx] = rows;
+    total += delta;
+
+    if (stale) return;
+
+    for (int idx = line_idx + 1; idx < tree.size(); idx += idx & -idx)
+    {
+        tree[idx] += delta;
+    }
+}
+
+int RowIndex::RowCount() const
+{
+    return total;
+}
+
+int RowIndex::RowOf(int line_idx)
+{
+    // Every line is a row, which is all there is to know without the tree
+    if (irregular == 0) return line_idx;
+
+    if (stale) Build();
+
+    int row = 0;
+    for (int idx = line_idx; idx > 0; idx -= idx & -idx)
+    {
+        row += tree[idx];
+    }
+    return row;
+}
+
+int RowIndex::LineAt(int row)
+{
+    int size = counts.size();
+    if (irregular == 0) return std::min(std::max(row, 0), size);
+
+    if (stale) Build();
+
+    int step = 1;
+    while (step * 2 <= size) step *= 2;
+
+    // Walks down the tree to the last line whose rows all come before the given row
+    int line_idx = 0;
+    for (; step != 0; step /= 2)
+    {
+        int next = line_idx + step;
+        if (next <= size && tree[next] <= row)
+        {
+            line_idx = next;
+            row -= tree[next];
+        }
+    }
+
+    return line_idx;
+}
+
+bool RowIndex::IsUniform() const
+{
+    return irregular == 0;
+}
@@ -0,0 +1,48 @@
+#ifndef ROWINDEX_HPP
+#define ROWINDEX_HPP
+
+#include "Vector.hpp"
+
+// How many display rows every line takes, with prefix sums so rows and lines map to each other in O(log n)
+class RowIndex
+{
+private:
+    Vector<int> counts;
+
+    // Fenwick tree over counts, one based
+    Vector<int> tree;
+
+    // Lines were added or removed since the tree was built, it is only rebuilt once rows are looked up
+    bool stale = false;
+
+    int total = 0;
+
+    // Lines that don't take exactly one row
+    int irregular = 0;
+
+    void Build();
+
+public:
+    RowIndex() = default;
+
+    void Reset(int line_count);
+
+    // New lines take one row each
+    void Insert(int line_idx, int count);
+    void Remove(int line_idx, int count);
+
+    int Rows(int line_idx) const;
+    void SetRows(int line_idx, int rows);
+
+    int RowCount() const;
+
+    // The first row of the line
+    int RowOf(int line_idx);
+
+    // The line containing the row, lines without rows are skipped, the line count if the row is past the end
+    int LineAt(int row);
+
+    bool IsUniform() const;
+};
+
+#endif // ROWINDEX_HPP
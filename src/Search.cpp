@@ -0,0 +1,177 @@
+#include "Search.hpp"
+
+#include <cstring>
+
+#include "Simd.hpp"
+#include "SpecialCharacters.hpp"
+
+bool Search::MatchesAt(StringView32 line, int x) const
+{
+    char32_t const* text = line.data() + x;
+
+    if (flags & SEARCH_MATCH_CASE)
+    {
+        return std::memcmp(text, pattern.data(), pattern.size() * sizeof(char32_t)) == 0;
+    }
+
+    for (int idx = 0; idx < pattern.size(); idx++)
+    {
+        if (FoldCase(text[idx]) != pattern[idx]) return false;
+    }
+    return true;
+}
+
+bool Search::FindLiteral(StringView32 line, int x, int & start, int & stop) const
+{
+    int size = pattern.size();
+
+    // The last place the pattern can start at
+    int end = line.size() - size;
+
+    char32_t const* text = line.data();
+
+    int idx = x;
+
+#ifdef HAVE_SSE2
+    __m128i first0 = _mm_set1_epi32((int)first[0]);
+    __m128i first1 = _mm_set1_epi32((int)first[1]);
+    __m128i last0  = _mm_set1_epi32((int)last[0]);
+    __m128i last1  = _mm_set1_epi32((int)last[1]);
+
+    // Four candidates at a time, only the ones with the right characters at both ends are compared in full
+    for (; !fold_ends && idx + 3 <= end; idx += 4)
+    {
+        __m128i head = _mm_loadu_si128((__m128i const*)(text + idx));
+        __m128i tail = _mm_loadu_si128((__m128i const*)(text + idx + size - 1));
+
+        __m128i head_eq = _mm_or_si128(_mm_cmpeq_epi32(head, first0), _mm_cmpeq_epi32(head, first1));
+        __m128i tail_eq = _mm_or_si128(_mm_cmpeq_epi32(tail, last0), _mm_cmpeq_epi32(tail, last1));
+
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(head_eq, tail_eq)));
+
+        for (int lane = 0; mask != 0; lane++, mask >>= 1)
+        {
+            if ((mask & 1) && MatchesAt(line, idx + lane))
+            {
+                start = idx + lane;
+                stop = start + size;
+                return true;
+            }
+        }
+    }
+#endif
+
+    for (; idx <= end; idx++)
+    {
+        char32_t head = text[idx];
+        char32_t tail = text[idx + size - 1];
+
+        if (fold_ends)
+        {
+            if (FoldCase(head) != first[0] || FoldCase(tail) != last[0]) continue;
+        }
+        else
+        {
+            if (head != first[0] && head != first[1]) continue;
+            if (tail != last[0] && tail != last[1]) continue;
+        }
+
+        if (MatchesAt(line, idx))
+        {
+            start = idx;
+            stop = idx + size;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Search::SetPattern(StringView32 new_pattern, int new_flags)
+{
+    flags = new_flags;
+    pattern = String32(new_pattern);
+
+    valid = false;
+    if (pattern.empty()) return false;
+
+    if (flags & SEARCH_REGEX)
+    {
+        valid = regex.Compile(pattern, flags & SEARCH_MATCH_CASE);
+        return valid;
+    }
+
+    fold_ends = false;
+
+    if (flags & SEARCH_MATCH_CASE)
+    {
+        first[0] = first[1] = pattern.front();
+        last[0]  = last[1]  = pattern.back();
+    }
+    else
+    {
+        for (char32_t & ch : pattern) ch = FoldCase(ch);
+
+        first[0] = pattern.front();
+        first[1] = ToUpper(pattern.front());
+
+        last[0] = pattern.back();
+        last[1] = ToUpper(pattern.back());
+
+        fold_ends = HasFoldVariants(pattern.front()) || HasFoldVariants(pattern.back());
+    }
+
+    valid = true;
+    return true;
+}
+
+bool Search::IsValid() const
+{
+    return valid;
+}
+
+int Search::Flags() const
+{
+    return flags;
+}
+
+bool Search::Find(StringView32 line, int x, int & start, int & stop, Cache & cache) const
+{
+    if (!valid) return false;
+
+    if (flags & SEARCH_REGEX) return regex.Find(line, x, start, stop, cache);
+
+    return FindLiteral(line, x, start, stop);
+}
+
+void Search::FindAll(StringView32 line, int line_idx, Vector<Cursor> & matches, Cache & cache) const
+{
+    if (!valid) return;
+
+    if (flags & SEARCH_REGEX)
+    {
+        Vector<std::pair<int, int>> ranges;
+        regex.FindAll(line, ranges, cache);
+
+        for (auto const& range : ranges)
+        {
+            matches.push_back({ { line_idx, range.first }, { line_idx, range.second } });
+        }
+        return;
+    }
+
+    int start, stop;
+    for (int x = 0; FindLiteral(line, x, start, stop); x = stop)
+    {
+        matches.push_back({ { line_idx, start }, { line_idx, stop } });
+    }
+}
+
+Vector<String32> Search::Literals() const
+{
+    if (!valid) return {};
+
+    if (flags & SEARCH_REGEX) return regex.Literals();
+
+    return { pattern };
+}
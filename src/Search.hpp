@@ -0,0 +1,64 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include "String32.hpp"
+#include "StringView32.hpp"
+#include "Vector.hpp"
+
+#include "Cursor.hpp"
+#include "Regex.hpp"
+
+enum SearchFlag
+{
+    SEARCH_MATCH_CASE = 1 << 0,
+    SEARCH_REGEX      = 1 << 1
+};
+
+// A pattern searched for one line at a time, straight in the line storage of a buffer.
+// Literals are compared four characters at a time, regular expressions go through Regex.
+class Search
+{
+private:
+    // Folded unless the search matches case
+    String32 pattern;
+
+    int flags = 0;
+    bool valid = false;
+
+    // The first and last characters of the pattern in both cases, every candidate has them at both ends
+    char32_t first[2];
+    char32_t last[2];
+
+    // Other characters fold to an end of the pattern as well, so the ends of candidates are folded instead
+    bool fold_ends = false;
+
+    Regex regex;
+
+    bool FindLiteral(StringView32 line, int x, int & start, int & stop) const;
+
+    // Whether the pattern is at x in the line, given that its first and last characters are
+    bool MatchesAt(StringView32 line, int x) const;
+
+public:
+    // Regular expressions build their DFA in it while they search, every thread keeps its own
+    using Cache = Regex::Cache;
+
+    Search() = default;
+
+    // Returns false if the pattern is empty or isn't a valid regular expression
+    bool SetPattern(StringView32 new_pattern, int new_flags);
+
+    bool IsValid() const;
+    int Flags() const;
+
+    // The first match starting at or after x
+    bool Find(StringView32 line, int x, int & start, int & stop, Cache & cache) const;
+
+    // Every match in the line, none of them overlap
+    void FindAll(StringView32 line, int line_idx, Vector<Cursor> & matches, Cache & cache) const;
+
+    // Strings every match contains, folded unless the search matches case
+    Vector<String32> Literals() const;
+};
+
+#endif // SEARCH_HPP
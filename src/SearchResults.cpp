@@ -0,0 +1,204 @@
+#include "SearchResults.hpp"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QVBoxLayout>
+
+#include "Search.hpp"
+#include "Workspace.hpp"
+
+namespace
+{
+    // Past this the list is only slowing things down, the search is narrowed down instead
+    constexpr int MAX_MATCHES = 10000;
+
+    constexpr int MAX_LINE_LENGTH = 200;
+}
+
+SearchResults::SearchResults(QWidget * parent) :
+    QWidget(parent)
+{
+    pattern = new QLineEdit(this);
+    match_case = new QCheckBox("Match case", this);
+    regex = new QCheckBox("Regex", this);
+    status = new QLabel(this);
+    results = new QListWidget(this);
+
+    results->setUniformItemSizes(true);
+
+    QHBoxLayout * options = new QHBoxLayout();
+    options->setContentsMargins(0, 0, 0, 0);
+    options->addWidget(pattern, 1);
+    options->addWidget(match_case);
+    options->addWidget(regex);
+    options->addWidget(status);
+
+    QVBoxLayout * layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(2);
+    layout->addLayout(options);
+    layout->addWidget(results);
+
+    connect(pattern, &QLineEdit::returnPressed,
+        [this](...)
+        {
+            Start();
+        }
+    );
+
+    connect(results, &QListWidget::itemActivated,
+        [this](QListWidgetItem * item)
+        {
+            FileMatch const& match = matches[item->data(Qt::UserRole).toInt()];
+            emit MatchActivated(match.path, match.match);
+        }
+    );
+
+    drain_timer.setInterval(30);
+
+    connect(&drain_timer, &QTimer::timeout,
+        [this](...)
+        {
+            Drain();
+        }
+    );
+}
+
+void SearchResults::Prompt()
+{
+    QString const& root = Workspace::Instance().Root();
+
+    if (!root.isEmpty())
+    {
+        directory = root;
+    }
+    else
+    {
+        QString chosen = QFileDialog::getExistingDirectory(this, "Find in Folder", directory);
+        if (!chosen.isEmpty()) directory = chosen;
+    }
+
+    pattern->setFocus();
+    pattern->selectAll();
+}
+
+void SearchResults::Start()
+{
+    Cancel();
+
+    results->clear();
+    matches.clear();
+    file_count = 0;
+
+    if (directory.isEmpty()) directory = QFileDialog::getExistingDirectory(this, "Find in Folder");
+    if (directory.isEmpty()) return;
+
+    int flags = 0;
+    if (match_case->isChecked()) flags |= SEARCH_MATCH_CASE;
+    if (regex->isChecked()) flags |= SEARCH_REGEX;
+
+    Search search;
+    if (!search.SetPattern(String32(pattern->text().toStdU32String()), flags))
+    {
+        status->setText("Invalid pattern");
+        return;
+    }
+
+    Workspace & workspace = Workspace::Instance();
+
+    // The index answers straight away once it is built, until then and outside the workspace the files are walked
+    if (!workspace.Root().isEmpty() && directory == workspace.Root() && workspace.CanGrep())
+    {
+        Vector<FileMatch> found = workspace.Grep(search);
+        AddMatches(found);
+        UpdateStatus();
+        return;
+    }
+
+    file_search.Start(directory, search);
+    drain_timer.start();
+
+    UpdateStatus();
+}
+
+void SearchResults::Cancel()
+{
+    file_search.Cancel();
+    drain_timer.stop();
+}
+
+void SearchResults::Drain()
+{
+    // Checked first, so the matches of the last files are in what is taken once it is done
+    bool running = file_search.IsRunning();
+
+    Vector<FileMatch> found = file_search.Take();
+    AddMatches(found);
+
+    if (matches.size() >= MAX_MATCHES) Cancel();
+    if (!running) drain_timer.stop();
+
+    UpdateStatus();
+}
+
+void SearchResults::AddMatches(Vector<FileMatch> & found)
+{
+    QDir base(directory);
+
+    for (FileMatch & match : found)
+    {
+        if (matches.size() >= MAX_MATCHES) break;
+
+        // The matches of a file always arrive together
+        if (matches.empty() || matches.back().path != match.path) file_count++;
+
+        String32 const& line = match.line;
+
+        int start = 0;
+        while (start < line.size() && (line[start] == U' ' || line[start] == U'\t')) start++;
+
+        int count = std::min<int>(line.size() - start, MAX_LINE_LENGTH);
+
+        QString text = QString("%1:%2: %3")
+            .arg(base.relativeFilePath(match.path))
+            .arg(match.match.start.y + 1)
+            .arg(QString::fromUcs4(line.data() + start, count));
+
+        QListWidgetItem * item = new QListWidgetItem(text, results);
+        item->setData(Qt::UserRole, matches.size());
+
+        matches.push_back(std::move(match));
+    }
+}
+
+void SearchResults::UpdateStatus()
+{
+    QString text = QString("%1 matches in %2 files").arg(matches.size()).arg(file_count);
+
+    if (file_search.IsRunning())
+    {
+        text += QString(", %1 searched").arg(file_search.FilesSearched());
+    }
+    else if (matches.size() >= MAX_MATCHES)
+    {
+        text += ", stopped";
+    }
+
+    status->setText(text);
+}
+
+void SearchResults::keyPressEvent(QKeyEvent * event)
+{
+    if (event->key() == Qt::Key_Escape)
+    {
+        Cancel();
+        UpdateStatus();
+        return;
+    }
+
+    QWidget::keyPressEvent(event);
+}
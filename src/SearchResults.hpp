@@ -0,0 +1,60 @@
+#ifndef SEARCHRESULTS_HPP
+#define SEARCHRESULTS_HPP
+
+#include <QCheckBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QTimer>
+#include <QWidget>
+
+#include "Vector.hpp"
+
+#include "Cursor.hpp"
+#include "Grep.hpp"
+
+// Search in files. The workspace is searched through its index once that is built, anything else is walked and searched as it goes,
+// with the matches added to the list while the search runs.
+class SearchResults : public QWidget
+{
+    Q_OBJECT
+
+private:
+    QLineEdit * pattern;
+    QCheckBox * match_case;
+    QCheckBox * regex;
+    QLabel * status;
+    QListWidget * results;
+
+    QString directory;
+
+    FileSearch file_search;
+
+    // Matches found by the search are moved into the list this often
+    QTimer drain_timer;
+
+    Vector<FileMatch> matches;
+    int file_count = 0;
+
+    void Start();
+    void Cancel();
+
+    void Drain();
+    void AddMatches(Vector<FileMatch> & found);
+    void UpdateStatus();
+
+signals:
+    void MatchActivated(QString const& path, Cursor match);
+
+public:
+    explicit SearchResults(QWidget * parent = nullptr);
+
+    // Searches the workspace if one is open, otherwise asks for a directory
+    void Prompt();
+
+    // QWidget interface
+protected:
+    void keyPressEvent(QKeyEvent * event);
+};
+
+#endif // SEARCHRESULTS_HPP
@@ -0,0 +1,10 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// SSE2 is part of every x86-64 target, and of x86 ones built for it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#endif // SIMD_HPP
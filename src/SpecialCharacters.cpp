@@ -1,5 +1,9 @@
 #include "SpecialCharacters.hpp"
 
+#include <QChar>
+
+#include "HashSet.hpp"
+
 bool IsLineBreak(char32_t ch)
 {
     switch ((Spaces)ch)
@@ -67,6 +71,41 @@ bool IsIdentifierChar(char32_t ch)
     return IsDigit(ch) || IsAsciiLetter(ch) || ch == '_';
 }
 
+char32_t ToLower(char32_t ch)
+{
+    if (ch < 128) return ch >= 'A' && ch <= 'Z' ? ch + ('a' - 'A') : ch;
+    return QChar::toLower((uint)ch);
+}
+
+char32_t ToUpper(char32_t ch)
+{
+    if (ch < 128) return ch >= 'a' && ch <= 'z' ? ch - ('a' - 'A') : ch;
+    return QChar::toUpper((uint)ch);
+}
+
+char32_t FoldCase(char32_t ch)
+{
+    if (ch < 128) return ch >= 'A' && ch <= 'Z' ? ch + ('a' - 'A') : ch;
+    return QChar::toCaseFolded((uint)ch);
+}
+
+bool HasFoldVariants(char32_t ch)
+{
+    // Only a few characters fold to one that isn't their lower case, they are found once
+    static HashSet<char32_t> const folded = []
+    {
+        HashSet<char32_t> found;
+        for (char32_t other = 128; other < 0x110000; other++)
+        {
+            char32_t target = FoldCase(other);
+            if (target != other && ToUpper(target) != other) found.insert(target);
+        }
+        return found;
+    }();
+
+    return folded.count(FoldCase(ch)) != 0;
+}
+
 int TabWidth(int pos)
 {
     return 4 - (pos & 0b11);
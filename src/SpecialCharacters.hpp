@@ -1,6 +1,8 @@
 #ifndef SPECIALCHARACTERS_HPP
 #define SPECIALCHARACTERS_HPP
 
+#include <cstdint>
+
 enum class Spaces
 {
     CharacterTabulation     = 9,
@@ -47,6 +49,20 @@ bool IsDigit(char32_t ch);
 bool IsAsciiLetter(char32_t ch);
 bool IsIdentifierChar(char32_t ch);
 
+// Simple one to one mappings, characters that change length in another case are left alone
+char32_t ToLower(char32_t ch);
+char32_t ToUpper(char32_t ch);
+char32_t FoldCase(char32_t ch);
+
+// Whether characters other than its lower and upper case fold the same as ch, like the Kelvin sign and k
+bool HasFoldVariants(char32_t ch);
+
+// For byte searches over UTF-8, only ASCII is folded so no other byte can tell it differs just in case
+inline std::uint8_t FoldAscii(std::uint8_t byte)
+{
+    return byte >= 'A' && byte <= 'Z' ? byte + ('a' - 'A') : byte;
+}
+
 int TabWidth(int pos);
 
 #endif // SPECIALCHARACTERS_HPP
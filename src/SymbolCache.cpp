@@ -0,0 +1,180 @@
+#include "SymbolCache.hpp"
+
+#include <cstring>
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+    constexpr char magic[4] = { 'J', 'S', 'Y', 'M' };
+    constexpr std::uint32_t version = 1;
+
+    // Layout on disk, everything in native byte order:
+    //  Header
+    //  std::uint8_t line_states[line_count], padded to a multiple of 4
+    //  SymbolRecord symbols[symbol_count]
+    //  char32_t pool[pool_size]
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t hash;
+        std::uint32_t line_count;
+        std::uint32_t symbol_count;
+        std::uint32_t pool_size;
+        std::uint32_t reserved;
+    };
+
+    struct SymbolRecord
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint32_t style;
+    };
+
+    static_assert(sizeof(Header) == 32, "Header must not contain padding");
+    static_assert(sizeof(SymbolRecord) == 12, "SymbolRecord must not contain padding");
+
+    std::int64_t Align(std::int64_t size)
+    {
+        return (size + 3) & ~std::int64_t(3);
+    }
+}
+
+SymbolCache::SymbolCache()
+{
+    directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/symbols";
+    QDir().mkpath(directory);
+}
+
+QString SymbolCache::Filename(std::uint64_t hash) const
+{
+    return directory + "/" + QString::number(hash, 16) + ".jsym";
+}
+
+SymbolCache & SymbolCache::Instance()
+{
+    static SymbolCache cache;
+    return cache;
+}
+
+std::uint64_t SymbolCache::Hash(char const* data, std::int64_t size)
+{
+    constexpr std::uint64_t prime = 0x100000001b3ull;
+
+    std::uint64_t hash = 0xcbf29ce484222325ull ^ (std::uint64_t)size;
+
+    std::int64_t idx = 0;
+    for (; idx + 8 <= size; idx += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, data + idx, 8);
+
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+
+    for (; idx < size; idx++)
+    {
+        hash = (hash ^ (std::uint8_t)data[idx]) * prime;
+    }
+
+    return hash;
+}
+
+bool SymbolCache::Load(std::uint64_t hash, SymbolCacheEntry & entry) const
+{
+    QFile file(Filename(hash));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    std::int64_t size = file.size();
+    if (size < (std::int64_t)sizeof(Header)) return false;
+
+    uchar * data = file.map(0, size);
+    if (data == nullptr) return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+
+    std::int64_t states_offset  = sizeof(Header);
+    std::int64_t symbols_offset = states_offset + Align(header.line_count);
+    std::int64_t pool_offset    = symbols_offset + std::int64_t(header.symbol_count) * sizeof(SymbolRecord);
+    std::int64_t expected_size  = pool_offset + std::int64_t(header.pool_size) * sizeof(char32_t);
+
+    bool valid =
+        std::memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+        header.version == version &&
+        header.hash == hash &&
+        expected_size == size;
+
+    if (valid)
+    {
+        SymbolRecord const* records = (SymbolRecord const*)(data + symbols_offset);
+        char32_t const* pool = (char32_t const*)(data + pool_offset);
+
+        entry.line_states.assign(data + states_offset, data + states_offset + header.line_count);
+
+        entry.symbols.clear();
+        entry.symbols.reserve(header.symbol_count);
+        for (std::uint32_t idx = 0; idx < header.symbol_count; idx++)
+        {
+            SymbolRecord const& record = records[idx];
+
+            if (std::uint64_t(record.offset) + record.length > header.pool_size)
+            {
+                valid = false;
+                break;
+            }
+
+            entry.symbols[String32(pool + record.offset, record.length)] = record.style;
+        }
+    }
+
+    file.unmap(data);
+
+    return valid;
+}
+
+bool SymbolCache::Store(std::uint64_t hash, SymbolCacheEntry const& entry) const
+{
+    Header header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.hash = hash;
+    header.line_count = entry.line_states.size();
+    header.symbol_count = entry.symbols.size();
+
+    Vector<SymbolRecord> records;
+    records.reserve(entry.symbols.size());
+
+    String32 pool;
+    for (auto const& symbol : entry.symbols)
+    {
+        SymbolRecord record;
+        record.offset = pool.size();
+        record.length = symbol.first.size();
+        record.style  = symbol.second;
+        records.push_back(record);
+
+        pool += symbol.first;
+    }
+
+    header.pool_size = pool.size();
+
+    char const padding[4] = {};
+    std::int64_t padding_size = Align(header.line_count) - header.line_count;
+
+    QSaveFile file(Filename(hash));
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    file.write((char const*)&header, sizeof(Header));
+    file.write((char const*)entry.line_states.data(), entry.line_states.size());
+    file.write(padding, padding_size);
+    file.write((char const*)records.data(), records.size() * sizeof(SymbolRecord));
+    file.write((char const*)pool.data(), pool.size() * sizeof(char32_t));
+
+    return file.commit();
+}
@@ -0,0 +1,43 @@
+#ifndef SYMBOLCACHE_HPP
+#define SYMBOLCACHE_HPP
+
+#include <cstdint>
+
+#include <QString>
+
+#include "HashMap.hpp"
+#include "String32.hpp"
+#include "Vector.hpp"
+
+struct SymbolCacheEntry
+{
+    HashMap<String32, int> symbols;
+    Vector<std::uint8_t> line_states;
+};
+
+// Scraped symbols and line end states of previously opened files, stored on disk by content hash
+class SymbolCache
+{
+private:
+    QString directory;
+
+    SymbolCache();
+
+    SymbolCache(SymbolCache const& other) = delete;
+    SymbolCache(SymbolCache && other) = delete;
+
+    SymbolCache & operator=(SymbolCache const& other) = delete;
+    SymbolCache & operator=(SymbolCache && other) = delete;
+
+    QString Filename(std::uint64_t hash) const;
+
+public:
+    static SymbolCache & Instance();
+
+    static std::uint64_t Hash(char const* data, std::int64_t size);
+
+    bool Load(std::uint64_t hash, SymbolCacheEntry & entry) const;
+    bool Store(std::uint64_t hash, SymbolCacheEntry const& entry) const;
+};
+
+#endif // SYMBOLCACHE_HPP
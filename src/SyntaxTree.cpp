@@ -0,0 +1,401 @@
+#include "SyntaxTree.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    // A block that is open while the units are rebuilt
+    struct OpenBlock
+    {
+        SyntaxNode node;
+        int block;
+    };
+}
+
+void SyntaxTree::MarkDirty(int line_idx)
+{
+    dirty_first = std::min(dirty_first, line_idx);
+    dirty_last = std::max(dirty_last, line_idx);
+}
+
+void SyntaxTree::UpdateLineDiagnostics(Vector<int> const& parsed, Vector<Diagnostic> & diagnostics)
+{
+    if (parsed.empty()) return;
+
+    auto line_pred = [](Diagnostic const& diagnostic, int line_idx) { return diagnostic.pos.y < line_idx; };
+    auto first = std::lower_bound(line_diagnostics.begin(), line_diagnostics.end(), parsed.front(), line_pred);
+    auto last  = std::lower_bound(first, line_diagnostics.end(), parsed.back() + 1, line_pred);
+
+    // Old diagnostics of lines in between that weren't reparsed stay
+    Vector<Diagnostic> merged;
+
+    auto next = diagnostics.begin();
+    for (auto it = first; it != last; ++it)
+    {
+        if (std::binary_search(parsed.begin(), parsed.end(), it->pos.y)) continue;
+
+        while (next != diagnostics.end() && next->pos.y < it->pos.y) merged.push_back(std::move(*next++));
+        merged.push_back(std::move(*it));
+    }
+    while (next != diagnostics.end()) merged.push_back(std::move(*next++));
+
+    int idx = first - line_diagnostics.begin();
+    line_diagnostics.erase(first, last);
+    line_diagnostics.insert(line_diagnostics.begin() + idx, std::make_move_iterator(merged.begin()), std::make_move_iterator(merged.end()));
+}
+
+void SyntaxTree::Reset(int line_count)
+{
+    entries.clear();
+    entries.resize(line_count);
+
+    line_diagnostics.clear();
+    units.clear();
+
+    first_invalid = 0;
+    invalid_count = line_count;
+
+    dirty_first = 0;
+    dirty_last = line_count - 1;
+}
+
+void SyntaxTree::Insert(int line_idx, int count)
+{
+    entries.insert(line_idx, Entry(), count);
+
+    first_invalid = std::min(first_invalid, line_idx);
+    invalid_count += count;
+
+    if (dirty_first <= dirty_last)
+    {
+        if (dirty_first >= line_idx) dirty_first += count;
+        if (dirty_last >= line_idx)  dirty_last += count;
+    }
+
+    for (Diagnostic & diagnostic : line_diagnostics)
+    {
+        if (diagnostic.pos.y >= line_idx) diagnostic.pos.y += count;
+    }
+
+    // Units around the new lines grow, and are rebuilt anyway once the lines are parsed
+    for (Unit & unit : units)
+    {
+        if (unit.first >= line_idx)     unit.first += count;
+        if (unit.last >= line_idx)      unit.last += count;
+    }
+}
+
+void SyntaxTree::Remove(int line_idx, int count)
+{
+    for (int idx = line_idx; idx < line_idx + count; idx++)
+    {
+        if (!entries[idx].valid) invalid_count--;
+    }
+
+    entries.remove(line_idx, count);
+
+    auto removed = [&](Diagnostic const& diagnostic) { return diagnostic.pos.y >= line_idx && diagnostic.pos.y < line_idx + count; };
+    line_diagnostics.erase(std::remove_if(line_diagnostics.begin(), line_diagnostics.end(), removed), line_diagnostics.end());
+
+    for (Diagnostic & diagnostic : line_diagnostics)
+    {
+        if (diagnostic.pos.y >= line_idx + count) diagnostic.pos.y -= count;
+    }
+
+    auto shift = [&](int line)
+    {
+        if (line >= line_idx + count) return line - count;
+        return std::min(line, line_idx);
+    };
+
+    if (dirty_first <= dirty_last)
+    {
+        dirty_first = shift(dirty_first);
+        dirty_last = shift(dirty_last);
+    }
+
+    // Units starting in the removed lines are dropped, the ones around them are cut short until they are rebuilt
+    int kept = 0;
+    for (int idx = 0; idx < units.size(); idx++)
+    {
+        Unit & unit = units[idx];
+
+        if (unit.first >= line_idx && unit.first < line_idx + count) continue;
+
+        if (unit.first < line_idx && unit.last >= line_idx) unit.last = line_idx - 1;
+
+        unit.first = shift(unit.first);
+        unit.last = shift(unit.last);
+
+        if (kept != idx) units[kept] = std::move(unit);
+        kept++;
+    }
+    units.resize(kept);
+
+    // The line after the removed ones may start in a different state now
+    if (line_idx < entries.size()) Invalidate(line_idx);
+
+    if (!entries.empty()) MarkDirty(std::min(line_idx, entries.size() - 1));
+
+    first_invalid = std::min(first_invalid, line_idx);
+}
+
+void SyntaxTree::Invalidate(int line_idx)
+{
+    Entry & entry = entries[line_idx];
+    if (entry.valid)
+    {
+        entry.valid = false;
+        invalid_count++;
+    }
+
+    first_invalid = std::min(first_invalid, line_idx);
+}
+
+bool SyntaxTree::Update(Vector<String32> const& lines, Lexer & lexer, int & first_line, int & last_line)
+{
+    Vector<int> parsed;
+    Vector<Diagnostic> diagnostics;
+
+    for (int line_idx = first_invalid; line_idx < entries.size() && invalid_count > 0; line_idx++)
+    {
+        Entry & entry = entries[line_idx];
+        if (entry.valid) continue;
+
+        int state = line_idx == 0 ? 0 : entries[line_idx - 1].state;
+
+        int diagnostic_count = diagnostics.size();
+
+        entry.syntax = LineSyntax();
+        state = lexer.ParseLine(lines[line_idx], state, entry.syntax, diagnostics);
+
+        for (int idx = diagnostic_count; idx < diagnostics.size(); idx++)
+        {
+            diagnostics[idx].pos.y = line_idx;
+        }
+        parsed.push_back(line_idx);
+
+        if (state != entry.state && line_idx + 1 < entries.size()) Invalidate(line_idx + 1);
+
+        entry.state = state;
+        entry.valid = true;
+        invalid_count--;
+
+        MarkDirty(line_idx);
+    }
+
+    first_invalid = entries.size();
+
+    UpdateLineDiagnostics(parsed, diagnostics);
+
+    if (dirty_first > dirty_last) return false;
+
+    Rebuild(lines, lexer, first_line, last_line);
+
+    dirty_first = entries.size();
+    dirty_last = -1;
+
+    return true;
+}
+
+void SyntaxTree::Rebuild(Vector<String32> const& lines, Lexer & lexer, int & first_line, int & last_line)
+{
+    // The unit right before the changed lines is rebuilt too, a declaration after it may have been what ended it
+    auto unit_pred = [](Unit const& unit, int line_idx) { return unit.last + 1 < line_idx; };
+    int first_unit = std::lower_bound(units.begin(), units.end(), dirty_first, unit_pred) - units.begin();
+
+    int start = dirty_first;
+    if (first_unit < units.size()) start = std::min(start, units[first_unit].first);
+
+    Vector<Unit> rebuilt;
+    Vector<OpenBlock> stack;
+    Unit unit;
+
+    auto finish = [&](SyntaxNode && node, int line_idx)
+    {
+        unit.node = std::move(node);
+        unit.last = line_idx;
+        rebuilt.push_back(std::move(unit));
+        unit = Unit();
+    };
+
+    auto add_diagnostic = [&](int line_idx, int x, int size, String32 message)
+    {
+        Diagnostic diagnostic;
+        diagnostic.pos = { line_idx - unit.first, x };
+        diagnostic.size = size;
+        diagnostic.message = std::move(message);
+        unit.diagnostics.push_back(std::move(diagnostic));
+    };
+
+    auto close = [&](int line_idx)
+    {
+        SyntaxNode node = std::move(stack.back().node);
+        stack.pop_back();
+
+        node.last_line = line_idx - unit.first;
+
+        if (stack.empty()) finish(std::move(node), line_idx);
+        else               stack.back().node.children.push_back(std::move(node));
+    };
+
+    // Blocks cut short by something that can't be inside of them end on the line before it
+    auto close_unclosed = [&](int line_idx)
+    {
+        int open_line = unit.first + stack.back().node.first_line;
+        LineSyntax const& opener = entries[open_line].syntax;
+
+        add_diagnostic(open_line, opener.x, opener.size, U"Never closed");
+        close(line_idx);
+    };
+
+    auto parent_kind = [&](int depth)
+    {
+        return depth < 0 ? 0 : stack[depth].node.kind;
+    };
+
+    int next_unit = first_unit;
+
+    int line_idx = start;
+    for (; line_idx < entries.size(); line_idx++)
+    {
+        // Past the changed lines the old units are the same, once one starts where a new one could
+        if (stack.empty() && line_idx > dirty_last)
+        {
+            while (next_unit < units.size() && units[next_unit].first < line_idx) next_unit++;
+            if (next_unit < units.size() && units[next_unit].first == line_idx) break;
+        }
+
+        LineSyntax const& syntax = entries[line_idx].syntax;
+        if (syntax.kind == 0) continue;
+
+        if (stack.empty())
+        {
+            unit.first = line_idx;
+            unit.diagnostics.clear();
+        }
+
+        if (syntax.block != 0 && !syntax.open)
+        {
+            int depth = stack.size() - 1;
+            while (depth >= 0 && stack[depth].block != syntax.block) depth--;
+
+            if (depth < 0)
+            {
+                add_diagnostic(line_idx, syntax.x, syntax.size, U"Nothing to close");
+
+                SyntaxNode node;
+                node.kind = syntax.kind;
+                node.first_line = line_idx - unit.first;
+                node.last_line = node.first_line;
+
+                if (stack.empty()) finish(std::move(node), line_idx);
+                else               stack.back().node.children.push_back(std::move(node));
+                continue;
+            }
+
+            while (stack.size() > depth + 1) close_unclosed(line_idx - 1);
+            close(line_idx);
+            continue;
+        }
+
+        String32 error = lexer.NestingError(parent_kind(stack.size() - 1), syntax.kind);
+
+        // A declaration ends the blocks it can't be inside of, if it fits further out
+        if (!error.empty() && !stack.empty() && (syntax.open || lexer.NestingError(0, syntax.kind).empty()))
+        {
+            int depth = stack.size() - 2;
+            while (depth >= 0 && !lexer.NestingError(stack[depth].node.kind, syntax.kind).empty()) depth--;
+
+            if (depth >= 0 || lexer.NestingError(0, syntax.kind).empty())
+            {
+                while (stack.size() > depth + 1) close_unclosed(line_idx - 1);
+                error.clear();
+
+                if (stack.empty()) unit.first = line_idx;
+            }
+        }
+
+        if (!error.empty()) add_diagnostic(line_idx, syntax.x, syntax.size, std::move(error));
+
+        SyntaxNode node;
+        node.kind = syntax.kind;
+        node.first_line = line_idx - unit.first;
+        node.last_line = node.first_line;
+        node.name = lines[line_idx].middle(syntax.name_x, syntax.name_size);
+
+        if (syntax.open)          stack.push_back({ std::move(node), syntax.block });
+        else if (!stack.empty())  stack.back().node.children.push_back(std::move(node));
+        else                      finish(std::move(node), line_idx);
+    }
+
+    while (!stack.empty()) close_unclosed(entries.size() - 1);
+
+    if (line_idx == entries.size()) next_unit = units.size();
+
+    // Most edits stay inside of one unit, which is then replaced in place
+    int replaced = next_unit - first_unit;
+    if (replaced == rebuilt.size())
+    {
+        std::move(rebuilt.begin(), rebuilt.end(), units.begin() + first_unit);
+    }
+    else
+    {
+        units.remove(first_unit, replaced);
+        units.insert(units.begin() + first_unit, std::make_move_iterator(rebuilt.begin()), std::make_move_iterator(rebuilt.end()));
+    }
+
+    first_line = start;
+    last_line = line_idx - 1;
+}
+
+Vector<Diagnostic> SyntaxTree::Diagnostics(int first_line, int last_line) const
+{
+    Vector<Diagnostic> diagnostics;
+
+    auto line_pred = [](Diagnostic const& diagnostic, int line_idx) { return diagnostic.pos.y < line_idx; };
+    for (auto it = std::lower_bound(line_diagnostics.begin(), line_diagnostics.end(), first_line, line_pred); it != line_diagnostics.end() && it->pos.y <= last_line; ++it)
+    {
+        diagnostics.push_back(*it);
+    }
+
+    auto unit_pred = [](Unit const& unit, int line_idx) { return unit.last < line_idx; };
+    for (auto it = std::lower_bound(units.begin(), units.end(), first_line, unit_pred); it != units.end() && it->first <= last_line; ++it)
+    {
+        for (Diagnostic diagnostic : it->diagnostics)
+        {
+            diagnostic.pos.y += it->first;
+            if (diagnostic.pos.y >= first_line && diagnostic.pos.y <= last_line) diagnostics.push_back(std::move(diagnostic));
+        }
+    }
+
+    auto diagnostic_pred = [](Diagnostic const& lhs, Diagnostic const& rhs) { return lhs.pos < rhs.pos; };
+    std::stable_sort(diagnostics.begin(), diagnostics.end(), diagnostic_pred);
+
+    return diagnostics;
+}
+
+int SyntaxTree::UnitCount() const
+{
+    return units.size();
+}
+
+int SyntaxTree::UnitLine(int unit_idx) const
+{
+    return units[unit_idx].first;
+}
+
+SyntaxNode const& SyntaxTree::UnitNode(int unit_idx) const
+{
+    return units[unit_idx].node;
+}
+
+int SyntaxTree::UnitAt(int line_idx) const
+{
+    auto unit_pred = [](Unit const& unit, int line_idx) { return unit.last < line_idx; };
+    auto it = std::lower_bound(units.begin(), units.end(), line_idx, unit_pred);
+
+    if (it == units.end() || it->first > line_idx) return -1;
+    return it - units.begin();
+}
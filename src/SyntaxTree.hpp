@@ -0,0 +1,95 @@
+#ifndef SYNTAXTREE_HPP
+#define SYNTAXTREE_HPP
+
+#include "String32.hpp"
+#include "Vector.hpp"
+
+#include "Cursor.hpp"
+#include "Lexer.hpp"
+
+// A statement, and for one opening a block everything inside of it up to the statement closing it
+struct SyntaxNode
+{
+    int kind;
+    int first_line;
+    int last_line;
+
+    String32 name;
+
+    Vector<SyntaxNode> children;
+};
+
+// Statements per line, kept parallel to the lines of a buffer and reparsed only after they are invalidated, nested into a tree.
+// Every top level statement is the root of a unit, with lines counted from where the unit starts. An edit rebuilds the units
+// around the changed lines until the rebuilt ones line up with the old ones again, the rest only move.
+class SyntaxTree
+{
+private:
+    struct Entry
+    {
+        LineSyntax syntax;
+
+        // What the lexer ended the line in, -1 before the line is first parsed
+        int state = -1;
+        bool valid = false;
+    };
+
+    struct Unit
+    {
+        int first;
+        int last;
+
+        SyntaxNode node;
+
+        // Blocks that don't match up, and statements that can't be where they are
+        Vector<Diagnostic> diagnostics;
+    };
+
+    // Entries are plain values so adding a line only moves memory, diagnostics of lines are kept apart since few lines have any
+    Vector<Entry> entries;
+    Vector<Diagnostic> line_diagnostics;
+
+    Vector<Unit> units;
+
+    int first_invalid = 0;
+    int invalid_count = 0;
+
+    // Lines the units have to be rebuilt over, none while dirty_first is past dirty_last
+    int dirty_first = 0;
+    int dirty_last = -1;
+
+    void MarkDirty(int line_idx);
+
+    // Replaces the diagnostics of reparsed lines, sorted like the lines are
+    void UpdateLineDiagnostics(Vector<int> const& parsed, Vector<Diagnostic> & diagnostics);
+
+    // Rebuilds the units from the first one that could have changed, returns the lines that were rebuilt
+    void Rebuild(Vector<String32> const& lines, Lexer & lexer, int & first_line, int & last_line);
+
+public:
+    SyntaxTree() = default;
+
+    void Reset(int line_count);
+
+    void Insert(int line_idx, int count);
+    void Remove(int line_idx, int count);
+
+    void Invalidate(int line_idx);
+
+    // Reparses changed lines like BlockTree does and rebuilds the units around them.
+    // Returns whether anything changed, and if so the lines whose diagnostics may have.
+    bool Update(Vector<String32> const& lines, Lexer & lexer, int & first_line, int & last_line);
+
+    // Syntax errors and misplaced statements on the lines, sorted by position
+    Vector<Diagnostic> Diagnostics(int first_line, int last_line) const;
+
+    // Top level statements sorted by line, the lines of their nodes are relative to the first line of the unit
+    int UnitCount() const;
+    int UnitLine(int unit_idx) const;
+    SyntaxNode const& UnitNode(int unit_idx) const;
+
+    // The unit the line is part of, -1 if it is outside of all of them
+    int UnitAt(int line_idx) const;
+};
+
+#endif // SYNTAXTREE_HPP
@@ -259,6 +259,34 @@ public:
         return true;
     }
 
+    String32 IdentifierAt(Position pos) const
+    {
+        pos = ClampPosition(pos);
+
+        String32 const& line = Lines()[pos.y];
+
+        int start = pos.x;
+        int stop = pos.x;
+
+        while (start != 0 && IsIdentifierChar(line[start - 1])) start--;
+        while (stop < LineLength(pos.y) && IsIdentifierChar(line[stop])) stop++;
+
+        return line.middle(start, stop - start);
+    }
+
+    // The part of the identifier at the position that comes before it
+    String32 IdentifierBefore(Position pos) const
+    {
+        pos = ClampPosition(pos);
+
+        String32 const& line = Lines()[pos.y];
+
+        int start = pos.x;
+        while (start != 0 && IsIdentifierChar(line[start - 1])) start--;
+
+        return line.middle(start, pos.x - start);
+    }
+
     Position PrevPosition(Position pos, int count = 1) const noexcept
     {
         while (count != 0)
@@ -0,0 +1,61 @@
+#include "TextRunCache.hpp"
+
+#include "SpecialCharacters.hpp"
+
+void TextRunCache::Reset(int line_count)
+{
+    entries.clear();
+    entries.resize(line_count);
+}
+
+void TextRunCache::Insert(int line_idx, int count)
+{
+    entries.insert(line_idx, {}, count);
+}
+
+void TextRunCache::Remove(int line_idx, int count)
+{
+    entries.remove(line_idx, count);
+}
+
+void TextRunCache::Invalidate(int line_idx)
+{
+    entries[line_idx].valid = false;
+}
+
+Vector<TextRun> const& TextRunCache::Runs(int line_idx, StringView32 line, Vector<int> const& styles, int first, int last, int column)
+{
+    Entry & entry = entries[line_idx];
+    if (entry.valid && entry.first == first && entry.last == last) return entry.runs;
+
+    entry.runs.clear();
+
+    entry.first = first;
+    entry.last = last;
+
+    int x = first;
+    while (x < last)
+    {
+        if (line[x] == U'\t')
+        {
+            column += TabWidth(column);
+            x++;
+            continue;
+        }
+
+        TextRun run;
+        run.column = column;
+        run.offset = x;
+        run.style  = styles[x];
+
+        while (x < last && line[x] != U'\t' && styles[x] == run.style) x++;
+
+        run.size = x - run.offset;
+        column += run.size;
+
+        entry.runs.push_back(run);
+    }
+
+    entry.valid = true;
+    return entry.runs;
+}
@@ -0,0 +1,47 @@
+#ifndef TEXTRUNCACHE_HPP
+#define TEXTRUNCACHE_HPP
+
+#include "Vector.hpp"
+#include "StringView32.hpp"
+
+// A piece of a line drawn with a single style, tabs are never part of a run
+struct TextRun
+{
+    int column;
+    int offset;
+    int size;
+    int style;
+};
+
+// Draw runs per line, kept parallel to the lines of a buffer and rebuilt only after they are invalidated
+class TextRunCache
+{
+private:
+    struct Entry
+    {
+        bool valid = false;
+
+        // Only the characters in [first, last) are covered, long lines are never split whole
+        int first = 0;
+        int last = 0;
+
+        Vector<TextRun> runs;
+    };
+
+    Vector<Entry> entries;
+
+public:
+    TextRunCache() = default;
+
+    void Reset(int line_count);
+
+    void Insert(int line_idx, int count);
+    void Remove(int line_idx, int count);
+
+    void Invalidate(int line_idx);
+
+    // Column is where the character at first starts
+    Vector<TextRun> const& Runs(int line_idx, StringView32 line, Vector<int> const& styles, int first, int last, int column);
+};
+
+#endif // TEXTRUNCACHE_HPP
@@ -13,6 +13,39 @@ Style const& Theme::operator[](int idx) const
     return styles[idx];
 }
 
+QColor const& Theme::Color(ThemeColor color) const
+{
+    return colors[color];
+}
+
+void Theme::SetColor(ThemeColor color, QColor const& value)
+{
+    colors[color] = value;
+}
+
+QPen const& Theme::Pen(int style) const
+{
+    return style_pens[style];
+}
+
+QPen const& Theme::Pen(ThemeColor color) const
+{
+    return color_pens[color];
+}
+
+void Theme::Update()
+{
+    for (int idx = 0; idx < (int)styles.size(); idx++)
+    {
+        style_pens[idx] = QPen(styles[idx].forecolor);
+    }
+
+    for (int idx = 0; idx < COLOR_COUNT; idx++)
+    {
+        color_pens[idx] = QPen(colors[idx]);
+    }
+}
+
 ThemeManager::ThemeManager()
 {
     Theme theme;
@@ -32,6 +65,16 @@ ThemeManager::ThemeManager()
     theme[JASS_CONSTANT].forecolor = QColor(184, 215, 163);
     theme[JASS_TYPE].forecolor = QColor(78, 201, 176) ;
 
+    theme.SetColor(COLOR_TEXT_BACKGROUND, QColor(38, 50, 56));
+    theme.SetColor(COLOR_MARGIN_BACKGROUND, QColor(30, 42, 48));
+    theme.SetColor(COLOR_MARGIN_FOREGROUND, QColor(191, 191, 191));
+    theme.SetColor(COLOR_SELECTION, QColor(85, 85, 85));
+    theme.SetColor(COLOR_SELECTION_BORDER, QColor(0, 0, 0));
+    theme.SetColor(COLOR_CURSOR, QColor(255, 204, 0));
+    theme.SetColor(COLOR_ERROR, QColor(240, 80, 80));
+
+    theme.Update();
+
     themes.push_back(theme);
 
     current_theme = 0;
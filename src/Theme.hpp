@@ -4,6 +4,7 @@
 #include <array>
 
 #include <QColor>
+#include <QPen>
 
 #include "String32.hpp"
 #include "Vector.hpp"
@@ -13,10 +14,28 @@ struct Style
     QColor forecolor;
 };
 
+// Colors of the editor itself rather than of the text
+enum ThemeColor
+{
+    COLOR_TEXT_BACKGROUND,
+    COLOR_MARGIN_BACKGROUND,
+    COLOR_MARGIN_FOREGROUND,
+    COLOR_SELECTION,
+    COLOR_SELECTION_BORDER,
+    COLOR_CURSOR,
+    COLOR_ERROR,
+    COLOR_COUNT
+};
+
 class Theme
 {
 private:
     std::array<Style, std::numeric_limits<std::uint8_t>::max()> styles;
+    std::array<QColor, COLOR_COUNT> colors;
+
+    // Built by Update so painting never has to construct a pen
+    std::array<QPen, std::numeric_limits<std::uint8_t>::max()> style_pens;
+    std::array<QPen, COLOR_COUNT> color_pens;
 
 public:
     Theme() = default;
@@ -24,6 +43,13 @@ public:
     Style & operator[](int idx);
     Style const& operator[](int idx) const;
 
+    QColor const& Color(ThemeColor color) const;
+    void SetColor(ThemeColor color, QColor const& value);
+
+    QPen const& Pen(int style) const;
+    QPen const& Pen(ThemeColor color) const;
+
+    // Has to be called after changing any style or color
     void Update();
 };
 
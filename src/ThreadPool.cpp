@@ -0,0 +1,160 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    // Index of the worker running on this thread, -1 on threads outside the pool
+    thread_local int current_worker = -1;
+}
+
+ThreadPool::ThreadPool()
+{
+    int count = std::max(1, (int)std::thread::hardware_concurrency());
+
+    workers.reserve(count);
+    for (int idx = 0; idx < count; idx++)
+    {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    threads.reserve(count);
+    for (int idx = 0; idx < count; idx++)
+    {
+        threads.emplace_back([this, idx] { Run(idx); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    condition.notify_all();
+
+    for (std::thread & thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    if (current_worker != -1)
+    {
+        Worker & worker = *workers[current_worker];
+
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+
+    // Taking the lock orders this with a thread that just found nothing and is about to sleep
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+    }
+
+    condition.notify_one();
+}
+
+bool ThreadPool::TakeTask(int worker, std::function<void()> & task)
+{
+    if (queued == 0) return false;
+
+    // Newest first from the own queue, its data is most likely still in cache
+    if (worker != -1)
+    {
+        Worker & own = *workers[worker];
+
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!tasks.empty())
+        {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+
+    // Oldest first from the others, those tend to be the biggest pieces of work
+    int count = workers.size();
+    for (int offset = 1; offset <= count; offset++)
+    {
+        int victim = (std::max(worker, 0) + offset) % count;
+        if (victim == worker) continue;
+
+        Worker & other = *workers[victim];
+
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty())
+        {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::Run(int worker)
+{
+    current_worker = worker;
+
+    for (;;)
+    {
+        std::function<void()> task;
+        if (TakeTask(worker, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return stopping || queued > 0; });
+
+        if (stopping && queued == 0) return;
+    }
+}
+
+bool ThreadPool::RunPendingTask()
+{
+    // Threads outside the pool could pick up something long that has nothing to do with what they wait for
+    if (current_worker == -1) return false;
+
+    std::function<void()> task;
+    if (!TakeTask(current_worker, task)) return false;
+
+    task();
+    return true;
+}
+
+ThreadPool & ThreadPool::Instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+int ThreadPool::ThreadCount() const
+{
+    return threads.size();
+}
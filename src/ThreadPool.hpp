@@ -0,0 +1,105 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Vector.hpp"
+
+// Every thread has its own queue and takes work from the others when it runs out.
+// Tasks submitted from a task stay on the same thread unless another one is idle, which keeps recursive work local.
+class ThreadPool
+{
+private:
+    struct Worker
+    {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+
+    Vector<std::thread> threads;
+    Vector<std::unique_ptr<Worker>> workers;
+
+    // Tasks submitted from outside the pool
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    // Tasks waiting in any queue, idle threads sleep while this is zero
+    std::atomic<int> queued{ 0 };
+
+    bool stopping = false;
+
+    ThreadPool();
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const& other) = delete;
+    ThreadPool(ThreadPool && other) = delete;
+
+    ThreadPool & operator=(ThreadPool const& other) = delete;
+    ThreadPool & operator=(ThreadPool && other) = delete;
+
+    void Enqueue(std::function<void()> task);
+    void Run(int worker);
+
+    // Takes a task from the own queue first, then the shared one, then the front of another thread's queue
+    bool TakeTask(int worker, std::function<void()> & task);
+
+public:
+    static ThreadPool & Instance();
+
+    int ThreadCount() const;
+
+    template <typename Function>
+    auto Submit(Function function) -> std::future<decltype(function())>
+    {
+        using ResultType = decltype(function());
+
+        auto task = std::make_shared<std::packaged_task<ResultType()>>(std::move(function));
+        std::future<ResultType> result = task->get_future();
+
+        Enqueue([task] { (*task)(); });
+
+        return result;
+    }
+
+    // Runs one waiting task if called from a thread of the pool, returns false if it didn't
+    bool RunPendingTask();
+
+    // Calls function(idx) for every idx in [0, count) and waits for all of them
+    template <typename Function>
+    void ParallelFor(int count, Function function)
+    {
+        Vector<std::future<void>> results;
+        results.reserve(count);
+
+        for (int idx = 0; idx < count; idx++)
+        {
+            results.push_back(Submit([&function, idx] { function(idx); }));
+        }
+
+        // Everything has to finish before function goes out of scope, even if something threw.
+        // A pool thread helps out meanwhile, so this also works from inside a task.
+        for (std::future<void> & result : results)
+        {
+            while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                if (!RunPendingTask()) result.wait_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        for (std::future<void> & result : results)
+        {
+            result.get();
+        }
+    }
+};
+
+#endif // THREADPOOL_HPP
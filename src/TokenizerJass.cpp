@@ -1,8 +1,10 @@
 #include "TokenizerJass.hpp"
 
+#include <algorithm>
 #include <map>
 
 #include "SpecialCharacters.hpp"
+#include "ThreadPool.hpp"
 
 #include "LexerJass.hpp"
 
@@ -10,6 +12,73 @@ namespace Jass
 {
     namespace
     {
+        // Below this it's not worth splitting the work up
+        constexpr int parallel_min_chunk_size = 1 << 16;
+
+        // NOTE@Daniel:
+        //  This has to agree with NextToken and the Read* functions on where
+        //  comments, strings and rawcodes start and stop, but nothing else
+        template <typename Callback>
+        LineState ScanLineEnds(StringView32 text, int start, Callback on_line_end, LineState state = LineState::Code)
+        {
+
+            int size = text.size();
+
+            int idx = start;
+            while (idx < size)
+            {
+                char32_t ch = text[idx];
+                char32_t next = idx + 1 < size ? text[idx + 1] : U'\0';
+
+                switch (state)
+                {
+                case LineState::Code:
+                    if (ch == U'/' && next == U'*')
+                    {
+                        state = LineState::CommentBlock;
+                        idx += 2;
+                        continue;
+                    }
+                    if (ch == U'/' && next == U'/')
+                    {
+                        while (idx < size && text[idx] != U'\n' && text[idx] != U'\0') idx++;
+                        continue;
+                    }
+                    if (ch == U'"')  state = LineState::String;
+                    if (ch == U'\'') state = LineState::Rawcode;
+                    break;
+                case LineState::CommentBlock:
+                    if (ch == U'*' && next == U'/')
+                    {
+                        state = LineState::Code;
+                        idx += 2;
+                        continue;
+                    }
+                    break;
+                case LineState::String:
+                    if (ch == U'"')
+                    {
+                        state = LineState::Code;
+                    }
+                    else if ((ch == U'\\' || ch == U'|') && idx + 1 < size)
+                    {
+                        idx++;
+                        ch = next;
+                    }
+                    break;
+                case LineState::Rawcode:
+                    if (ch == U'\'' || ch == U'\0') state = LineState::Code;
+                    break;
+                }
+
+                if (ch == U'\n') on_line_end(idx, state);
+
+                idx++;
+            }
+
+            return state;
+        }
+
         static HashMap<StringView32, TokenType> keywords
         {
             {U"globals", TokenType::Globals},
@@ -427,6 +496,96 @@ namespace Jass
         return tokens;
     }
 
+    Vector<int> FindSafeBoundaries(StringView32 text, int start, int min_distance)
+    {
+        Vector<int> boundaries;
+
+        int last = start;
+        ScanLineEnds(text, start,
+            [&](int idx, LineState state)
+            {
+                int line_start = idx + 1;
+                if (state == LineState::Code && line_start - last >= min_distance && line_start < text.size())
+                {
+                    boundaries.push_back(line_start);
+                    last = line_start;
+                }
+            }
+        );
+
+        return boundaries;
+    }
+
+    Vector<LineState> ScanLineStates(StringView32 text)
+    {
+        Vector<LineState> states;
+
+        LineState last_state = ScanLineEnds(text, 0,
+            [&](int, LineState state)
+            {
+                states.push_back(state);
+            }
+        );
+
+        states.push_back(last_state);
+
+        return states;
+    }
+
+    LineState ScanLineState(StringView32 line, LineState state)
+    {
+        return ScanLineEnds(line, 0, [](int, LineState) {}, state);
+    }
+
+    Vector<Token> TokenizeParallel(StringView32 text, int start)
+    {
+        ThreadPool & pool = ThreadPool::Instance();
+
+        int size = text.size() - start;
+        if (size < 2 * parallel_min_chunk_size || pool.ThreadCount() == 1)
+        {
+            return Tokenize(text, start);
+        }
+
+        int chunk_size = std::max(parallel_min_chunk_size, size / (pool.ThreadCount() * 4));
+
+        Vector<int> boundaries = FindSafeBoundaries(text, start, chunk_size);
+        boundaries.push_front(start);
+        boundaries.push_back(text.size());
+
+        int chunk_count = boundaries.size() - 1;
+
+        Vector<Vector<Token>> chunks(chunk_count);
+        pool.ParallelFor(chunk_count,
+            [&](int idx)
+            {
+                StringView32 chunk = text.middle_view(0, boundaries[idx + 1]);
+                chunks[idx] = Tokenize(chunk, boundaries[idx]);
+
+                // Trailing whitespace makes a chunk end in Eof, which only the last one should have
+                if (idx != chunk_count - 1 && !chunks[idx].empty() && chunks[idx].back().Is(TokenType::Eof))
+                {
+                    chunks[idx].pop_back();
+                }
+            }
+        );
+
+        int token_count = 0;
+        for (Vector<Token> const& chunk : chunks)
+        {
+            token_count += chunk.size();
+        }
+
+        Vector<Token> tokens;
+        tokens.reserve(token_count);
+        for (Vector<Token> & chunk : chunks)
+        {
+            tokens += std::move(chunk);
+        }
+
+        return tokens;
+    }
+
     int NextMeaningfullToken(Vector<Token> const& tokens, int idx)
     {
         for (;;)
@@ -442,7 +601,7 @@ namespace Jass
     {
         HashMap<String32, int> keywords;
 
-        Vector<Token> tokens = Tokenize(text);
+        Vector<Token> tokens = TokenizeParallel(text);
 
         keywords.reserve(tokens.size() / 20);
 
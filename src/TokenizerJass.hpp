@@ -1,6 +1,8 @@
 #ifndef TOKENIZERJASS_HPP
 #define TOKENIZERJASS_HPP
 
+#include <cstdint>
+
 #include "String32.hpp"
 #include "Vector.hpp"
 #include "HashMap.hpp"
@@ -122,6 +124,28 @@ namespace Jass {
         KeywordLast = Return
     };
 
+    // What a line ends inside of, as far as the next line is concerned
+    enum class LineState : std::uint8_t {
+        Code,
+        CommentBlock,
+        String,
+        Rawcode
+    };
+
+    // The block and syntax trees keep a wider state per line, the LineState in the low bits and flags above it
+    constexpr int LINE_STATE_MASK = 3;
+
+    // Between interface and endinterface
+    constexpr int IN_INTERFACE = 4;
+
+    // Between preprocessor directives whose lines aren't vJass, like a textmacro and its endtextmacro
+    constexpr int IN_PREPROCESSOR = 8;
+
+    inline LineState LineStateOf(int state)
+    {
+        return (LineState)(state & LINE_STATE_MASK);
+    }
+
     class Token
     {
     private:
@@ -171,6 +195,17 @@ namespace Jass {
 
     Vector<Token> Tokenize(StringView32 text, int start = 0);
 
+    // Line starts at which the previous line ends outside of any comment, string or rawcode.
+    // Tokenizing from one of these gives the same tokens as tokenizing from the beginning.
+    Vector<int> FindSafeBoundaries(StringView32 text, int start, int min_distance);
+
+    Vector<Token> TokenizeParallel(StringView32 text, int start = 0);
+
+    Vector<LineState> ScanLineStates(StringView32 text);
+
+    // What a single line ends inside of when it starts inside of state
+    LineState ScanLineState(StringView32 line, LineState state);
+
     int NextMeaningfullToken(Vector<Token> const& tokens, int idx = 0);
 
     HashMap<String32, int> Scrape(StringView32 text);
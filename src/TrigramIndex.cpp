@@ -0,0 +1,1005 @@
+#include "TrigramIndex.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "SpecialCharacters.hpp"
+#include "SymbolCache.hpp"
+#include "ThreadPool.hpp"
+
+namespace
+{
+    constexpr char magic[4] = { 'J', 'T', 'R', 'I' };
+    constexpr std::uint32_t version = 1;
+
+    // Lines are added to a chunk until it is at least this big
+    constexpr int chunk_size = 32 * 1024;
+
+    // Files indexed at once, so only that many files worth of trigram lists are held before they become postings
+    constexpr int batch_size = 64;
+
+    // Layout on disk, everything in native byte order:
+    //  Header
+    //  FileRecord files[file_count]
+    //  ChunkRecord chunks[chunk_count]
+    //  TrigramRecord trigrams[trigram_count], sorted by key
+    //  char pool[pool_size], UTF-8 paths padded to a multiple of 8
+    //  std::uint8_t postings[posting_size]
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t file_count;
+        std::uint32_t chunk_count;
+        std::uint32_t trigram_count;
+        std::uint32_t pool_size;
+        std::uint64_t posting_size;
+    };
+
+    struct FileRecord
+    {
+        std::uint32_t path_offset;
+        std::uint32_t path_length;
+        std::int64_t size;
+        std::int64_t modified;
+    };
+
+    struct ChunkRecord
+    {
+        std::uint32_t file;
+        std::uint32_t first_line;
+        std::uint32_t size;
+        std::uint32_t reserved;
+        std::uint64_t offset;
+    };
+
+    // Chunk ids as the difference to the one before, seven bits per byte
+    struct TrigramRecord
+    {
+        std::uint32_t key;
+        std::uint32_t count;
+        std::uint64_t offset;
+    };
+
+    static_assert(sizeof(Header) == 32, "Header must not contain padding");
+    static_assert(sizeof(FileRecord) == 24, "FileRecord must not contain padding");
+    static_assert(sizeof(ChunkRecord) == 24, "ChunkRecord must not contain padding");
+    static_assert(sizeof(TrigramRecord) == 16, "TrigramRecord must not contain padding");
+
+    std::int64_t Align(std::int64_t size)
+    {
+        return (size + 7) & ~std::int64_t(7);
+    }
+
+    template <typename Type>
+    void Append(QByteArray & image, Type const* data, std::int64_t count)
+    {
+        image.append((char const*)data, count * sizeof(Type));
+    }
+}
+
+void TrigramIndex::Postings::Append(int chunk)
+{
+    std::uint32_t delta = chunk - last;
+    while (delta >= 0x80)
+    {
+        bytes.push_back(0x80 | (delta & 0x7F));
+        delta >>= 7;
+    }
+    bytes.push_back(delta);
+
+    last = chunk;
+    count++;
+}
+
+void TrigramIndex::SortTrigrams(Vector<std::uint32_t> & keys, Vector<std::uint32_t> & scratch)
+{
+    // Keys are 24 bits, so three passes of a radix sort beat comparing them by a wide margin
+    constexpr int bits = 8;
+    constexpr int buckets = 1 << bits;
+
+    scratch.resize(keys.size());
+
+    for (int shift = 0; shift < 24; shift += bits)
+    {
+        int counts[buckets] = {};
+        for (std::uint32_t key : keys)
+        {
+            counts[(key >> shift) & (buckets - 1)]++;
+        }
+
+        int offset = 0;
+        for (int & count : counts)
+        {
+            int size = count;
+            count = offset;
+            offset += size;
+        }
+
+        for (std::uint32_t key : keys)
+        {
+            scratch[counts[(key >> shift) & (buckets - 1)]++] = key;
+        }
+
+        std::swap(keys, scratch);
+    }
+}
+
+TrigramIndex::IndexedFile TrigramIndex::IndexFile(QString const& path)
+{
+    IndexedFile indexed;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return indexed;
+
+    std::int64_t size = file.size();
+    if (size == 0) return indexed;
+
+    uchar const* data = file.map(0, size);
+    if (data == nullptr) return indexed;
+
+    Vector<std::uint32_t> keys;
+    Vector<std::uint32_t> scratch;
+
+    Chunk chunk;
+    chunk.file = -1;
+    chunk.first_line = 0;
+    chunk.offset = 0;
+
+    auto finish = [&](std::int64_t end)
+    {
+        SortTrigrams(keys, scratch);
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        chunk.size = end - chunk.offset;
+        indexed.chunks.push_back(chunk);
+        indexed.trigrams.push_back(std::move(keys));
+
+        keys.clear();
+    };
+
+    int line = 0;
+
+    // The last three bytes, trigrams never cross a line break
+    std::uint32_t window = 0;
+    int window_size = 0;
+
+    for (std::int64_t idx = 0; idx < size; idx++)
+    {
+        std::uint8_t byte = data[idx];
+
+        // Looks like a binary file after all
+        if (byte == 0)
+        {
+            indexed.chunks.clear();
+            indexed.trigrams.clear();
+
+            file.unmap((uchar *)data);
+            return indexed;
+        }
+
+        if (byte == '\n' || byte == '\r')
+        {
+            window_size = 0;
+        }
+        else
+        {
+            window = ((window << 8) | FoldAscii(byte)) & 0xFFFFFF;
+            if (++window_size >= 3) keys.push_back(window);
+        }
+
+        if (byte != '\n') continue;
+
+        line++;
+
+        if (idx + 1 - chunk.offset >= chunk_size)
+        {
+            finish(idx + 1);
+
+            chunk.first_line = line;
+            chunk.offset = idx + 1;
+        }
+    }
+
+    if (chunk.offset < size) finish(size);
+
+    file.unmap((uchar *)data);
+
+    return indexed;
+}
+
+void TrigramIndex::LiteralTrigrams(String32 const& literal, bool match_case, Vector<std::uint32_t> & keys)
+{
+    Vector<std::uint8_t> bytes;
+    Vector<char> folds;
+    for (char32_t ch : literal)
+    {
+        int count = bytes.size();
+        EncodeUtf8(ch, bytes);
+
+        // Other cases of a character outside ASCII are different bytes altogether, so are the ones that fold to ASCII
+        folds.insert(folds.size(), !match_case && (ch >= 0x80 || HasFoldVariants(ch)), bytes.size() - count);
+    }
+
+    for (int idx = 0; idx + 2 < bytes.size(); idx++)
+    {
+        bool usable = true;
+        for (int offset = 0; offset < 3; offset++)
+        {
+            std::uint8_t byte = bytes[idx + offset];
+            if (byte == '\n' || byte == '\r' || folds[idx + offset]) usable = false;
+        }
+        if (!usable) continue;
+
+        keys.push_back((FoldAscii(bytes[idx]) << 16) | (FoldAscii(bytes[idx + 1]) << 8) | FoldAscii(bytes[idx + 2]));
+    }
+}
+
+void TrigramIndex::Decode(uchar const* data, std::int64_t size, int count, int limit, Vector<int> & ids)
+{
+    std::int64_t pos = 0;
+    int id = -1;
+
+    for (int idx = 0; idx < count; idx++)
+    {
+        std::uint32_t delta = 0;
+        for (int shift = 0; pos < size; shift += 7)
+        {
+            std::uint8_t byte = data[pos++];
+            delta |= std::uint32_t(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+
+        // Only a damaged file has ids out of order or past the last chunk
+        if (delta == 0 || delta > std::uint32_t(limit - 1 - id)) return;
+
+        id += delta;
+        ids.push_back(id);
+    }
+}
+
+void TrigramIndex::Reset()
+{
+    Close();
+
+    files.clear();
+    chunks.clear();
+    file_ids.clear();
+    added.clear();
+
+    mapped_chunks = 0;
+}
+
+void TrigramIndex::Close()
+{
+    if (mapped_data != nullptr) mapped.unmap(mapped_data);
+    mapped.close();
+
+    mapped_data = nullptr;
+    image.clear();
+
+    trigram_records = nullptr;
+    posting_data = nullptr;
+    posting_size = 0;
+    trigram_count = 0;
+}
+
+bool TrigramIndex::Parse(uchar const* data, std::int64_t size)
+{
+    if (size < (std::int64_t)sizeof(Header)) return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+
+    std::int64_t files_offset    = sizeof(Header);
+    std::int64_t chunks_offset   = files_offset + std::int64_t(header.file_count) * sizeof(FileRecord);
+    std::int64_t trigrams_offset = chunks_offset + std::int64_t(header.chunk_count) * sizeof(ChunkRecord);
+    std::int64_t pool_offset     = trigrams_offset + std::int64_t(header.trigram_count) * sizeof(TrigramRecord);
+    std::int64_t postings_offset = pool_offset + Align(header.pool_size);
+    std::int64_t expected_size   = postings_offset + std::int64_t(header.posting_size);
+
+    bool valid =
+        std::memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+        header.version == version &&
+        expected_size == size;
+
+    if (!valid) return false;
+
+    FileRecord const* file_records = (FileRecord const*)(data + files_offset);
+    ChunkRecord const* chunk_records = (ChunkRecord const*)(data + chunks_offset);
+    char const* pool = (char const*)(data + pool_offset);
+
+    files.clear();
+    chunks.clear();
+    file_ids.clear();
+    added.clear();
+
+    files.reserve(header.file_count);
+    for (std::uint32_t idx = 0; idx < header.file_count; idx++)
+    {
+        FileRecord const& record = file_records[idx];
+        if (std::uint64_t(record.path_offset) + record.path_length > header.pool_size) return false;
+
+        File file;
+        file.path = QString::fromUtf8(pool + record.path_offset, record.path_length);
+        file.size = record.size;
+        file.modified = record.modified;
+        file.live = true;
+
+        file_ids[file.path.toStdU32String()] = idx;
+        files.push_back(file);
+    }
+
+    chunks.reserve(header.chunk_count);
+    for (std::uint32_t idx = 0; idx < header.chunk_count; idx++)
+    {
+        ChunkRecord const& record = chunk_records[idx];
+        if (record.file >= header.file_count) return false;
+
+        Chunk chunk;
+        chunk.file = record.file;
+        chunk.first_line = record.first_line;
+        chunk.offset = record.offset;
+        chunk.size = record.size;
+        chunks.push_back(chunk);
+    }
+
+    trigram_records = data + trigrams_offset;
+    trigram_count = header.trigram_count;
+
+    posting_data = data + postings_offset;
+    posting_size = header.posting_size;
+
+    mapped_chunks = header.chunk_count;
+
+    return true;
+}
+
+bool TrigramIndex::Load()
+{
+    Close();
+
+    mapped.setFileName(filename);
+    if (!mapped.open(QIODevice::ReadOnly)) return false;
+
+    std::int64_t size = mapped.size();
+    if (size > 0) mapped_data = mapped.map(0, size);
+
+    if (mapped_data == nullptr || !Parse(mapped_data, size))
+    {
+        Reset();
+        return false;
+    }
+
+    return true;
+}
+
+void TrigramIndex::Save()
+{
+    // Only live files are written, so every chunk gets a new id
+    Vector<int> file_remap(files.size(), -1);
+    Vector<int> chunk_remap(chunks.size(), -1);
+
+    Vector<FileRecord> file_records;
+    Vector<ChunkRecord> chunk_records;
+    QByteArray pool;
+
+    for (int idx = 0; idx < files.size(); idx++)
+    {
+        File const& file = files[idx];
+        if (!file.live) continue;
+
+        QByteArray path = file.path.toUtf8();
+
+        FileRecord record;
+        record.path_offset = pool.size();
+        record.path_length = path.size();
+        record.size = file.size;
+        record.modified = file.modified;
+
+        file_remap[idx] = file_records.size();
+        file_records.push_back(record);
+
+        pool.append(path);
+    }
+
+    for (int idx = 0; idx < chunks.size(); idx++)
+    {
+        Chunk const& chunk = chunks[idx];
+        if (file_remap[chunk.file] == -1) continue;
+
+        ChunkRecord record;
+        record.file = file_remap[chunk.file];
+        record.first_line = chunk.first_line;
+        record.size = chunk.size;
+        record.reserved = 0;
+        record.offset = chunk.offset;
+
+        chunk_remap[idx] = chunk_records.size();
+        chunk_records.push_back(record);
+    }
+
+    Vector<std::uint32_t> added_keys;
+    added_keys.reserve(added.size());
+    for (auto const& entry : added)
+    {
+        added_keys.push_back(entry.first);
+    }
+    std::sort(added_keys.begin(), added_keys.end());
+
+    TrigramRecord const* records = (TrigramRecord const*)trigram_records;
+
+    Vector<TrigramRecord> trigrams;
+    Vector<std::uint8_t> postings;
+    Vector<int> ids;
+
+    // Both lists of keys are sorted, so this is a merge
+    int mapped_idx = 0;
+    int added_idx = 0;
+    while (mapped_idx < trigram_count || added_idx < added_keys.size())
+    {
+        std::uint32_t key = std::numeric_limits<std::uint32_t>::max();
+        if (mapped_idx < trigram_count)      key = std::min(key, records[mapped_idx].key);
+        if (added_idx < added_keys.size())   key = std::min(key, added_keys[added_idx]);
+
+        ids.clear();
+
+        if (mapped_idx < trigram_count && records[mapped_idx].key == key)
+        {
+            TrigramRecord const& record = records[mapped_idx++];
+            if (record.offset <= std::uint64_t(posting_size))
+            {
+                Decode(posting_data + record.offset, posting_size - record.offset, record.count, mapped_chunks, ids);
+            }
+        }
+
+        if (added_idx < added_keys.size() && added_keys[added_idx] == key)
+        {
+            Postings const& list = added.at(added_keys[added_idx++]);
+            Decode(list.bytes.data(), list.bytes.size(), list.count, chunks.size(), ids);
+        }
+
+        Postings merged;
+        for (int id : ids)
+        {
+            if (chunk_remap[id] != -1) merged.Append(chunk_remap[id]);
+        }
+
+        if (merged.count == 0) continue;
+
+        TrigramRecord record;
+        record.key = key;
+        record.count = merged.count;
+        record.offset = postings.size();
+        trigrams.push_back(record);
+
+        postings.insert(postings.end(), merged.bytes.begin(), merged.bytes.end());
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.file_count = file_records.size();
+    header.chunk_count = chunk_records.size();
+    header.trigram_count = trigrams.size();
+    header.pool_size = pool.size();
+    header.posting_size = postings.size();
+
+    pool.append(QByteArray(Align(pool.size()) - pool.size(), 0));
+
+    QByteArray new_image;
+    new_image.reserve(sizeof(Header) + file_records.size() * sizeof(FileRecord) + chunk_records.size() * sizeof(ChunkRecord) +
+                      trigrams.size() * sizeof(TrigramRecord) + pool.size() + postings.size());
+
+    Append(new_image, &header, 1);
+    Append(new_image, file_records.data(), file_records.size());
+    Append(new_image, chunk_records.data(), chunk_records.size());
+    Append(new_image, trigrams.data(), trigrams.size());
+    Append(new_image, pool.constData(), pool.size());
+    Append(new_image, postings.data(), postings.size());
+
+    // The old file can't be replaced while it is mapped, and everything from it is in the new image by now
+    Close();
+
+    QSaveFile file(filename);
+    if (file.open(QIODevice::WriteOnly) && file.write(new_image) == new_image.size() && file.commit() && Load()) return;
+
+    image = new_image;
+    Parse((uchar const*)image.constData(), image.size());
+}
+
+bool TrigramIndex::Sync(Vector<QString> const& paths, Vector<int> const& removed)
+{
+    struct Pending
+    {
+        QString path;
+        std::int64_t size;
+        std::int64_t modified;
+    };
+
+    Vector<Pending> pending;
+    for (QString const& path : paths)
+    {
+        QFileInfo info(path);
+
+        Pending file;
+        file.path = path;
+        file.size = info.size();
+        file.modified = info.lastModified().toMSecsSinceEpoch();
+
+        auto it = file_ids.find(path.toStdU32String());
+        if (it != file_ids.end())
+        {
+            File const& known = files[it->second];
+            if (known.live && known.size == file.size && known.modified == file.modified) continue;
+        }
+
+        pending.push_back(file);
+    }
+
+    for (int file : removed)
+    {
+        files[file].live = false;
+    }
+
+    for (int first = 0; first < pending.size(); first += batch_size)
+    {
+        int count = std::min(batch_size, pending.size() - first);
+
+        Vector<IndexedFile> indexed(count);
+        ThreadPool::Instance().ParallelFor(count,
+            [&](int idx)
+            {
+                indexed[idx] = IndexFile(pending[first + idx].path);
+            }
+        );
+
+        for (int idx = 0; idx < count; idx++)
+        {
+            Pending const& file = pending[first + idx];
+            AddFile(file.path, file.size, file.modified, indexed[idx]);
+        }
+    }
+
+    return !pending.empty() || !removed.empty();
+}
+
+void TrigramIndex::AddFile(QString const& path, std::int64_t size, std::int64_t modified, IndexedFile & indexed)
+{
+    String32 key = path.toStdU32String();
+
+    auto it = file_ids.find(key);
+    if (it != file_ids.end()) files[it->second].live = false;
+
+    int file_id = files.size();
+
+    File file;
+    file.path = path;
+    file.size = size;
+    file.modified = modified;
+    file.live = true;
+    files.push_back(file);
+
+    file_ids[key] = file_id;
+
+    for (int idx = 0; idx < indexed.chunks.size(); idx++)
+    {
+        int chunk_id = chunks.size();
+
+        Chunk chunk = indexed.chunks[idx];
+        chunk.file = file_id;
+        chunks.push_back(chunk);
+
+        for (std::uint32_t trigram : indexed.trigrams[idx])
+        {
+            added[trigram].Append(chunk_id);
+        }
+    }
+}
+
+void TrigramIndex::Watch(QString const& directory)
+{
+    watcher->addPath(directory);
+}
+
+void TrigramIndex::WatchFiles(Vector<QString> const& paths)
+{
+    HashSet<String32> watched;
+    for (QString const& path : watcher->files())
+    {
+        watched.insert(path.toStdU32String());
+    }
+
+    QStringList added;
+    for (QString const& path : paths)
+    {
+        if (watched.insert(path.toStdU32String()).second) added.append(path);
+    }
+
+    if (!added.isEmpty()) watcher->addPaths(added);
+}
+
+TrigramIndex::Found TrigramIndex::Build()
+{
+    Reset();
+    Load();
+
+    Found found;
+    HashSet<String32> seen;
+
+    QDirIterator it(root, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        QFileInfo info(it.next());
+        QString path = info.absoluteFilePath();
+
+        if (info.isDir())
+        {
+            found.directories.push_back(path);
+        }
+        else if (IsTextFile(path))
+        {
+            found.files.push_back(path);
+            seen.insert(path.toStdU32String());
+        }
+    }
+
+    Vector<int> removed;
+    for (int idx = 0; idx < files.size(); idx++)
+    {
+        if (files[idx].live && seen.count(files[idx].path.toStdU32String()) == 0) removed.push_back(idx);
+    }
+
+    if (Sync(found.files, removed)) Save();
+
+    return found;
+}
+
+TrigramIndex::Found TrigramIndex::Rescan(HashSet<String32> const& directories, HashSet<String32> const& paths, QStringList const& watched)
+{
+    Found found;
+    HashSet<String32> seen;
+
+    Vector<int> removed;
+
+    auto add = [&](QString const& path)
+    {
+        if (IsTextFile(path) && seen.insert(path.toStdU32String()).second) found.files.push_back(path);
+    };
+
+    for (String32 const& key : paths)
+    {
+        QString path = QString::fromStdU32String(key);
+        if (QFileInfo::exists(path))
+        {
+            add(path);
+            continue;
+        }
+
+        auto it = file_ids.find(key);
+        if (it != file_ids.end() && files[it->second].live) removed.push_back(it->second);
+    }
+
+    for (String32 const& key : directories)
+    {
+        QString directory = QString::fromStdU32String(key);
+
+        for (QFileInfo const& info : QDir(directory).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot))
+        {
+            QString path = info.absoluteFilePath();
+
+            if (info.isFile())
+            {
+                add(path);
+                continue;
+            }
+
+            if (watched.contains(path)) continue;
+
+            // A new directory, everything in it is new as well
+            found.directories.push_back(path);
+
+            QDirIterator it(path, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+            while (it.hasNext())
+            {
+                QFileInfo inner(it.next());
+                if (inner.isDir()) found.directories.push_back(inner.absoluteFilePath());
+                else               add(inner.absoluteFilePath());
+            }
+        }
+
+        // Files under the directory that are gone, including the ones in directories removed from it
+        QString prefix = directory + "/";
+        for (int idx = 0; idx < files.size(); idx++)
+        {
+            File const& file = files[idx];
+            if (file.live && file.path.startsWith(prefix) && !QFileInfo::exists(file.path)) removed.push_back(idx);
+        }
+    }
+
+    Sync(found.files, removed);
+
+    return found;
+}
+
+void TrigramIndex::Refresh()
+{
+    if ((dirty.empty() && changed.empty()) || update.valid()) return;
+
+    HashSet<String32> directories;
+    std::swap(directories, dirty);
+
+    HashSet<String32> paths;
+    std::swap(paths, changed);
+
+    QStringList watched = watcher->directories();
+
+    update = ThreadPool::Instance().Submit(
+        [this, directories = std::move(directories), paths = std::move(paths), watched]
+        {
+            return Rescan(directories, paths, watched);
+        }
+    );
+}
+
+void TrigramIndex::PostingsOf(std::uint32_t key, Vector<int> & ids) const
+{
+    TrigramRecord const* records = (TrigramRecord const*)trigram_records;
+
+    auto pred = [](TrigramRecord const& record, std::uint32_t key) { return record.key < key; };
+    TrigramRecord const* it = std::lower_bound(records, records + trigram_count, key, pred);
+
+    if (it != records + trigram_count && it->key == key && it->offset <= std::uint64_t(posting_size))
+    {
+        Decode(posting_data + it->offset, posting_size - it->offset, it->count, mapped_chunks, ids);
+    }
+
+    // Chunks indexed since all have higher ids, so the list stays sorted
+    auto added_it = added.find(key);
+    if (added_it != added.end())
+    {
+        Postings const& list = added_it->second;
+        Decode(list.bytes.data(), list.bytes.size(), list.count, chunks.size(), ids);
+    }
+}
+
+Vector<std::uint32_t> TrigramIndex::Trigrams(Search const& search)
+{
+    bool match_case = search.Flags() & SEARCH_MATCH_CASE;
+
+    Vector<std::uint32_t> keys;
+    for (String32 const& literal : search.Literals())
+    {
+        LiteralTrigrams(literal, match_case, keys);
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    return keys;
+}
+
+Vector<int> TrigramIndex::Candidates(Vector<std::uint32_t> & keys) const
+{
+    Vector<int> candidates;
+
+    // Nothing narrows the search down, every chunk has to be looked at
+    if (keys.empty())
+    {
+        for (int idx = 0; idx < chunks.size(); idx++)
+        {
+            if (files[chunks[idx].file].live) candidates.push_back(idx);
+        }
+        return candidates;
+    }
+
+    Vector<std::pair<Vector<int>, std::uint32_t>> lists(keys.size());
+    for (int idx = 0; idx < keys.size(); idx++)
+    {
+        lists[idx].second = keys[idx];
+
+        PostingsOf(keys[idx], lists[idx].first);
+        if (lists[idx].first.empty()) return candidates;
+    }
+
+    // Starting from the shortest list keeps every intersection small
+    auto pred = [](auto const& lhs, auto const& rhs) { return lhs.first.size() < rhs.first.size(); };
+    std::sort(lists.begin(), lists.end(), pred);
+
+    for (int idx = 0; idx < keys.size(); idx++)
+    {
+        keys[idx] = lists[idx].second;
+    }
+
+    candidates = std::move(lists[0].first);
+
+    Vector<int> intersection;
+    for (int idx = 1; idx < lists.size() && !candidates.empty(); idx++)
+    {
+        Vector<int> const& list = lists[idx].first;
+
+        intersection.clear();
+        std::set_intersection(candidates.begin(), candidates.end(), list.begin(), list.end(), std::back_inserter(intersection));
+        std::swap(candidates, intersection);
+    }
+
+    auto dead = [this](int chunk) { return !files[chunks[chunk].file].live; };
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), dead), candidates.end());
+
+    return candidates;
+}
+
+TrigramIndex::~TrigramIndex()
+{
+    if (update.valid()) update.wait();
+
+    Close();
+}
+
+void TrigramIndex::Open(QString const& directory)
+{
+    // An update of the last directory still uses everything that is about to be replaced
+    if (update.valid()) update.wait();
+
+    root = QFileInfo(directory).absoluteFilePath();
+
+    QString index_directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/index";
+    QDir().mkpath(index_directory);
+
+    QByteArray root_bytes = root.toUtf8();
+    std::uint64_t hash = SymbolCache::Hash(root_bytes.constData(), root_bytes.size());
+
+    filename = index_directory + "/" + QString::number(hash, 16) + ".jtri";
+
+    watcher = std::make_unique<QFileSystemWatcher>();
+    dirty.clear();
+    changed.clear();
+
+    QObject::connect(watcher.get(), &QFileSystemWatcher::directoryChanged,
+        [this](QString const& path)
+        {
+            dirty.insert(path.toStdU32String());
+            Refresh();
+        }
+    );
+
+    QObject::connect(watcher.get(), &QFileSystemWatcher::fileChanged,
+        [this](QString const& path)
+        {
+            changed.insert(path.toStdU32String());
+            Refresh();
+        }
+    );
+
+    Watch(root);
+
+    update = ThreadPool::Instance().Submit(
+        [this]
+        {
+            return Build();
+        }
+    );
+}
+
+bool TrigramIndex::IsOpen() const
+{
+    return !root.isEmpty();
+}
+
+bool TrigramIndex::IsReady()
+{
+    if (!IsOpen()) return false;
+
+    if (update.valid())
+    {
+        if (update.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+
+        Found found = update.get();
+
+        for (QString const& directory : found.directories)
+        {
+            Watch(directory);
+        }
+
+        WatchFiles(found.files);
+    }
+
+    // Changes seen while the last update ran need another one
+    Refresh();
+
+    return !update.valid();
+}
+
+int TrigramIndex::FileCount() const
+{
+    int count = 0;
+    for (File const& file : files)
+    {
+        if (file.live) count++;
+    }
+    return count;
+}
+
+int TrigramIndex::ChunkCount() const
+{
+    return chunks.size();
+}
+
+Vector<QString> TrigramIndex::FilePaths()
+{
+    Vector<QString> paths;
+    if (!IsReady()) return paths;
+
+    for (File const& file : files)
+    {
+        if (file.live) paths.push_back(file.path);
+    }
+
+    return paths;
+}
+
+Vector<FileMatch> TrigramIndex::Find(Search const& search)
+{
+    Vector<FileMatch> matches;
+    if (!search.IsValid() || !IsReady()) return matches;
+
+    Vector<std::uint32_t> keys = Trigrams(search);
+    Vector<int> candidates = Candidates(keys);
+
+    // Lines without the longest literal can't match either, so they aren't even decoded
+    Needle needle(search);
+
+    // Chunks of a file have consecutive ids, so the candidates of each file are next to each other
+    Vector<int> group_starts;
+    for (int idx = 0; idx < candidates.size(); idx++)
+    {
+        if (idx == 0 || chunks[candidates[idx]].file != chunks[candidates[idx - 1]].file) group_starts.push_back(idx);
+    }
+    group_starts.push_back(candidates.size());
+
+    int group_count = group_starts.size() - 1;
+
+    Vector<Vector<FileMatch>> groups(group_count);
+    ThreadPool::Instance().ParallelFor(group_count,
+        [&](int group)
+        {
+            Search::Cache cache;
+
+            File const& file = files[chunks[candidates[group_starts[group]]].file];
+
+            QFile source(file.path);
+            if (!source.open(QIODevice::ReadOnly)) return;
+
+            std::int64_t size = source.size();
+            uchar const* data = size > 0 ? source.map(0, size) : nullptr;
+            if (data == nullptr) return;
+
+            for (int idx = group_starts[group]; idx < group_starts[group + 1]; idx++)
+            {
+                Chunk const& chunk = chunks[candidates[idx]];
+
+                // Changed since it was indexed and the watcher hasn't said so yet
+                if (chunk.offset + chunk.size > size) continue;
+
+                GrepLines(file.path, data, chunk.offset, chunk.offset + chunk.size, chunk.first_line, search, cache, needle, groups[group]);
+            }
+
+            source.unmap((uchar *)data);
+        }
+    );
+
+    for (Vector<FileMatch> & group : groups)
+    {
+        std::move(group.begin(), group.end(), std::back_inserter(matches));
+    }
+
+    return matches;
+}
@@ -0,0 +1,181 @@
+#ifndef TRIGRAMINDEX_HPP
+#define TRIGRAMINDEX_HPP
+
+#include <cstdint>
+#include <future>
+#include <memory>
+
+#include <QByteArray>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QString>
+#include <QStringList>
+
+#include "HashMap.hpp"
+#include "HashSet.hpp"
+#include "String32.hpp"
+#include "Vector.hpp"
+
+#include "Cursor.hpp"
+#include "Grep.hpp"
+#include "Search.hpp"
+
+// Which runs of lines in the text files of a directory tree contain each sequence of three bytes.
+// Searches only read the runs that contain every trigram of the pattern, instead of every file.
+// The index is kept on disk between sessions and mapped straight into memory, files that changed since are indexed again on their own.
+// Building and refreshing it runs on the thread pool, the index can only be searched while neither is running.
+class TrigramIndex
+{
+private:
+    struct File
+    {
+        QString path;
+        std::int64_t size;
+        std::int64_t modified;
+
+        // False once the file is gone or a newer copy of it was indexed
+        bool live;
+    };
+
+    // Consecutive whole lines of a file, the unit a search is narrowed down to
+    struct Chunk
+    {
+        int file;
+        int first_line;
+        std::int64_t offset;
+        int size;
+    };
+
+    // Chunk ids of a trigram, delta encoded as they are appended
+    struct Postings
+    {
+        Vector<std::uint8_t> bytes;
+        int count = 0;
+        int last = -1;
+
+        void Append(int chunk);
+    };
+
+    // A file read and split into chunks, before its chunks have ids
+    struct IndexedFile
+    {
+        int file;
+        Vector<Chunk> chunks;
+        Vector<Vector<std::uint32_t>> trigrams;
+    };
+
+    QString root;
+    QString filename;
+
+    Vector<File> files;
+    Vector<Chunk> chunks;
+
+    // The latest entry for every path
+    HashMap<String32, int> file_ids;
+
+    // Postings of the first mapped_chunks chunks stay in the index file, which is mapped while it is open.
+    // If the file can't be written, the same image is kept in memory instead.
+    QFile mapped;
+    uchar * mapped_data = nullptr;
+    QByteArray image;
+
+    uchar const* trigram_records = nullptr;
+    uchar const* posting_data = nullptr;
+    std::int64_t posting_size = 0;
+    int trigram_count = 0;
+    int mapped_chunks = 0;
+
+    // Postings of chunks indexed since the index file was written
+    HashMap<std::uint32_t, Postings> added;
+
+    // What an update found that the watcher has to be told about
+    struct Found
+    {
+        Vector<QString> directories;
+        Vector<QString> files;
+    };
+
+    // Directories and files with changes that Refresh hasn't looked at yet.
+    // Files are watched on their own, a directory isn't reported when a file in it is rewritten in place.
+    std::unique_ptr<QFileSystemWatcher> watcher;
+    HashSet<String32> dirty;
+    HashSet<String32> changed;
+
+    // Owns everything above but the watcher while it runs
+    std::future<Found> update;
+
+    static void SortTrigrams(Vector<std::uint32_t> & keys, Vector<std::uint32_t> & scratch);
+
+    static IndexedFile IndexFile(QString const& path);
+
+    // Every trigram a line containing the literal has, or none when it is too short to have any
+    static void LiteralTrigrams(String32 const& literal, bool match_case, Vector<std::uint32_t> & keys);
+
+    // Stops early rather than reading past size or returning ids from limit on
+    static void Decode(uchar const* data, std::int64_t size, int count, int limit, Vector<int> & ids);
+
+    void Reset();
+    void Close();
+
+    // Takes over the files, chunks and postings of an index image
+    bool Parse(uchar const* data, std::int64_t size);
+
+    bool Load();
+    void Save();
+
+    // Indexes the paths that are new or changed and drops the removed files, returns whether anything changed
+    bool Sync(Vector<QString> const& paths, Vector<int> const& removed);
+
+    void AddFile(QString const& path, std::int64_t size, std::int64_t modified, IndexedFile & indexed);
+
+    void Watch(QString const& directory);
+
+    // Watches the files that aren't yet, a file that was removed and came back has to be watched again
+    void WatchFiles(Vector<QString> const& paths);
+
+    // Loads the index file and indexes what changed since it was written
+    Found Build();
+
+    // Indexes the changed files and the ones that changed in the directories, the watched directories are known already
+    Found Rescan(HashSet<String32> const& directories, HashSet<String32> const& paths, QStringList const& watched);
+
+    // Starts an update for the directories and files the watcher reported, unless one is running
+    void Refresh();
+
+    // Every trigram a match of the search has, sorted
+    static Vector<std::uint32_t> Trigrams(Search const& search);
+
+    void PostingsOf(std::uint32_t key, Vector<int> & ids) const;
+
+    // Chunks that can contain a match, sorted. The keys are reordered from the rarest to the most common.
+    Vector<int> Candidates(Vector<std::uint32_t> & keys) const;
+
+public:
+    TrigramIndex() = default;
+    ~TrigramIndex();
+
+    TrigramIndex(TrigramIndex const& other) = delete;
+    TrigramIndex(TrigramIndex && other) = delete;
+
+    TrigramIndex & operator=(TrigramIndex const& other) = delete;
+    TrigramIndex & operator=(TrigramIndex && other) = delete;
+
+    // Loads the index of the directory from disk if there is one and brings it up to date in the background
+    void Open(QString const& directory);
+
+    bool IsOpen() const;
+
+    // Whether the index is up to date with the changes seen so far, picks up an update that finished meanwhile
+    bool IsReady();
+
+    int FileCount() const;
+    int ChunkCount() const;
+
+    // Every indexed file, none while the index isn't ready
+    Vector<QString> FilePaths();
+
+    // Every match in the indexed files, in the order the files were found. None while the index isn't ready.
+    Vector<FileMatch> Find(Search const& search);
+};
+
+#endif // TRIGRAMINDEX_HPP
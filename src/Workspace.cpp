@@ -0,0 +1,339 @@
+#include "Workspace.hpp"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#include "ThreadPool.hpp"
+#include "TokenizerJass.hpp"
+
+namespace
+{
+    bool IsModifier(Jass::Token const& token)
+    {
+        return token.Is(Jass::TokenType::Private, Jass::TokenType::Public, Jass::TokenType::Static, Jass::TokenType::Constant);
+    }
+
+    String32 PathKey(QString const& path)
+    {
+        return QFileInfo(path).absoluteFilePath().toStdU32String();
+    }
+}
+
+Workspace::FileIndex Workspace::IndexText(StringView32 text, int file)
+{
+    FileIndex index;
+
+    // NOTE@Daniel:
+    //  Files are already indexed in parallel, so this has to stay on the calling thread
+    Vector<Jass::Token> tokens = Jass::Tokenize(text);
+
+    Vector<int> line_starts = { 0 };
+    for (int idx = 0; idx < text.size(); idx++)
+    {
+        if (text[idx] == U'\n') line_starts.push_back(idx + 1);
+    }
+
+    int line = 0;
+    auto position = [&](Jass::Token const& token)
+    {
+        while (line + 1 < line_starts.size() && line_starts[line + 1] <= token.Start()) line++;
+
+        Position pos;
+        pos.y = line;
+        pos.x = token.Start() - line_starts[line];
+        return pos;
+    };
+
+    auto define = [&](Jass::Token const& token, SymbolKind kind)
+    {
+        SymbolDefinition definition;
+        definition.kind = kind;
+        definition.location.file = file;
+        definition.location.pos = position(token);
+        index.definitions[token.Value()].push_back(definition);
+    };
+
+    bool in_globals = false;
+    bool statement_start = true;
+
+    int statement_line = -1;
+
+    for (int idx = 0; idx < tokens.size(); idx++)
+    {
+        Jass::Token const& token = tokens[idx];
+        if (token.IsComment() || token.Is(Jass::TokenType::Eof)) continue;
+
+        Position pos = position(token);
+        if (pos.y != statement_line)
+        {
+            statement_line = pos.y;
+            statement_start = true;
+        }
+
+        if (token.Is(Jass::TokenType::Identifier))
+        {
+            index.references[token.Value()].push_back(pos);
+        }
+
+        if (!statement_start) continue;
+        if (IsModifier(token)) continue;
+
+        statement_start = false;
+
+        int next_idx = Jass::NextMeaningfullToken(tokens, idx + 1);
+        if (next_idx == -1) break;
+
+        Jass::Token const& next = tokens[next_idx];
+
+        switch (token.Type())
+        {
+        case Jass::TokenType::Globals:    in_globals = true;  break;
+        case Jass::TokenType::EndGlobals: in_globals = false; break;
+        case Jass::TokenType::Function:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Function);
+            break;
+        case Jass::TokenType::Native:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Native);
+            break;
+        case Jass::TokenType::Type:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Type);
+            break;
+        case Jass::TokenType::Struct:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Struct);
+            break;
+        case Jass::TokenType::Interface:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Interface);
+            break;
+        case Jass::TokenType::Module:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Module);
+            break;
+        case Jass::TokenType::Method:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Method);
+            break;
+        case Jass::TokenType::Library:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Library);
+            break;
+        case Jass::TokenType::Scope:
+            if (next.Is(Jass::TokenType::Identifier)) define(next, SymbolKind::Scope);
+            break;
+        case Jass::TokenType::Identifier:
+            // type [array] name [= value]
+            if (in_globals)
+            {
+                if (next.Is(Jass::TokenType::Array))
+                {
+                    next_idx = Jass::NextMeaningfullToken(tokens, next_idx + 1);
+                    if (next_idx == -1) break;
+                }
+
+                Jass::Token const& name = tokens[next_idx];
+                if (name.Is(Jass::TokenType::Identifier)) define(name, SymbolKind::Global);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return index;
+}
+
+void Workspace::AddIndex(int file)
+{
+    FileIndex const& index = files[file];
+
+    for (auto const& entry : index.definitions)
+    {
+        definitions[entry.first] += entry.second;
+    }
+
+    for (auto const& entry : index.references)
+    {
+        reference_files[entry.first].push_back(file);
+    }
+}
+
+void Workspace::RemoveIndex(int file)
+{
+    FileIndex const& index = files[file];
+
+    for (auto const& entry : index.definitions)
+    {
+        Vector<SymbolDefinition> & list = definitions[entry.first];
+
+        auto pred = [file](SymbolDefinition const& definition) { return definition.location.file == file; };
+        list.erase(std::remove_if(list.begin(), list.end(), pred), list.end());
+
+        if (list.empty()) definitions.remove(entry.first);
+    }
+
+    for (auto const& entry : index.references)
+    {
+        Vector<int> & list = reference_files[entry.first];
+        list.erase(std::remove(list.begin(), list.end(), file), list.end());
+
+        if (list.empty()) reference_files.remove(entry.first);
+    }
+}
+
+Workspace & Workspace::Instance()
+{
+    static Workspace workspace;
+    return workspace;
+}
+
+String32 Workspace::ReadFile(QString const& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+
+    return QString::fromUtf8(file.readAll()).replace("\r\n", "\n").toStdU32String();
+}
+
+QString const& Workspace::Root() const
+{
+    return root;
+}
+
+void Workspace::Open(QString const& directory)
+{
+    root = directory;
+
+    files.clear();
+    file_ids.clear();
+    definitions.clear();
+    reference_files.clear();
+
+    QStringList filters;
+    filters << "*.j" << "*.vj" << "*.ai";
+
+    QDirIterator it(directory, filters, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        FileIndex index;
+        index.path = QFileInfo(it.next()).absoluteFilePath();
+
+        file_ids[index.path.toStdU32String()] = files.size();
+        files.push_back(std::move(index));
+    }
+
+    ThreadPool::Instance().ParallelFor(files.size(),
+        [this](int idx)
+        {
+            QString path = files[idx].path;
+
+            files[idx] = IndexText(ReadFile(path), idx);
+            files[idx].path = path;
+        }
+    );
+
+    for (int idx = 0; idx < files.size(); idx++)
+    {
+        AddIndex(idx);
+    }
+
+    text_index.Open(directory);
+}
+
+void Workspace::UpdateFile(QString const& path, StringView32 text)
+{
+    int file = FileId(path);
+    if (file == -1)
+    {
+        file = files.size();
+        files.emplace_back();
+        file_ids[PathKey(path)] = file;
+    }
+    else
+    {
+        RemoveIndex(file);
+    }
+
+    files[file] = IndexText(text, file);
+    files[file].path = QFileInfo(path).absoluteFilePath();
+
+    AddIndex(file);
+}
+
+int Workspace::FileCount() const
+{
+    return files.size();
+}
+
+QString const& Workspace::FilePath(int file) const
+{
+    return files[file].path;
+}
+
+int Workspace::FileId(QString const& path) const
+{
+    auto it = file_ids.find(PathKey(path));
+    if (it == file_ids.end()) return -1;
+
+    return it->second;
+}
+
+HashMap<String32, Vector<SymbolDefinition>> const& Workspace::Definitions() const
+{
+    return definitions;
+}
+
+Vector<SymbolDefinition> Workspace::Definitions(String32 const& name) const
+{
+    auto it = definitions.find(name);
+    if (it == definitions.end()) return {};
+
+    return it->second;
+}
+
+Vector<SymbolLocation> Workspace::References(String32 const& name) const
+{
+    Vector<SymbolLocation> locations;
+
+    auto it = reference_files.find(name);
+    if (it == reference_files.end()) return locations;
+
+    for (int file : it->second)
+    {
+        for (Position pos : files[file].references.at(name))
+        {
+            SymbolLocation location;
+            location.file = file;
+            location.pos = pos;
+            locations.push_back(location);
+        }
+    }
+
+    return locations;
+}
+
+bool Workspace::CanGrep()
+{
+    return text_index.IsReady();
+}
+
+Vector<FileMatch> Workspace::Grep(Search const& search)
+{
+    return text_index.Find(search);
+}
+
+Vector<QString> Workspace::TextFiles()
+{
+    if (text_index.IsReady()) return text_index.FilePaths();
+
+    Vector<QString> paths;
+    if (root.isEmpty()) return paths;
+
+    QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        QString path = QFileInfo(it.next()).absoluteFilePath();
+        if (IsTextFile(path)) paths.push_back(path);
+    }
+
+    return paths;
+}
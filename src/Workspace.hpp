@@ -0,0 +1,110 @@
+#ifndef WORKSPACE_HPP
+#define WORKSPACE_HPP
+
+#include <cstdint>
+
+#include <QString>
+
+#include "HashMap.hpp"
+#include "String32.hpp"
+#include "Vector.hpp"
+
+#include "Cursor.hpp"
+#include "Search.hpp"
+#include "TrigramIndex.hpp"
+
+enum class SymbolKind : std::uint8_t
+{
+    Function,
+    Native,
+    Global,
+    Type,
+    Struct,
+    Interface,
+    Module,
+    Method,
+    Library,
+    Scope
+};
+
+struct SymbolLocation
+{
+    int file;
+    Position pos;
+};
+
+struct SymbolDefinition
+{
+    SymbolKind kind;
+    SymbolLocation location;
+};
+
+// Definitions and references of every symbol in the .j/.vj files of a directory tree
+class Workspace
+{
+private:
+    struct FileIndex
+    {
+        QString path;
+
+        HashMap<String32, Vector<SymbolDefinition>> definitions;
+        HashMap<String32, Vector<Position>> references;
+    };
+
+    QString root;
+
+    Vector<FileIndex> files;
+    HashMap<String32, int> file_ids;
+
+    HashMap<String32, Vector<SymbolDefinition>> definitions;
+
+    // Which files reference a name, the positions are in the FileIndex
+    HashMap<String32, Vector<int>> reference_files;
+
+    // Covers the data files next to the scripts as well
+    TrigramIndex text_index;
+
+    Workspace() = default;
+
+    Workspace(Workspace const& other) = delete;
+    Workspace(Workspace && other) = delete;
+
+    Workspace & operator=(Workspace const& other) = delete;
+    Workspace & operator=(Workspace && other) = delete;
+
+    static FileIndex IndexText(StringView32 text, int file);
+
+    void AddIndex(int file);
+    void RemoveIndex(int file);
+
+public:
+    static Workspace & Instance();
+
+    static String32 ReadFile(QString const& path);
+
+    QString const& Root() const;
+
+    void Open(QString const& directory);
+
+    // Reindexes a single file, typically after it was edited
+    void UpdateFile(QString const& path, StringView32 text);
+
+    int FileCount() const;
+    QString const& FilePath(int file) const;
+    int FileId(QString const& path) const;
+
+    HashMap<String32, Vector<SymbolDefinition>> const& Definitions() const;
+    Vector<SymbolDefinition> Definitions(String32 const& name) const;
+    Vector<SymbolLocation> References(String32 const& name) const;
+
+    // Whether Grep can answer from the text index, it is built in the background after the workspace is opened
+    bool CanGrep();
+
+    // Every match in the text files of the workspace, as they are on disk
+    Vector<FileMatch> Grep(Search const& search);
+
+    // Every text file of the workspace, not only the scripts. Walks the directory while the text index is being built.
+    Vector<QString> TextFiles();
+};
+
+#endif // WORKSPACE_HPP
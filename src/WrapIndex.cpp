@@ -0,0 +1,157 @@
+#include "WrapIndex.hpp"
+
+#include <algorithm>
+
+#include "SpecialCharacters.hpp"
+
+void WrapIndex::Reset(int line_count)
+{
+    entries.clear();
+    entries.resize(line_count);
+
+    scan = 0;
+}
+
+void WrapIndex::Insert(int line_idx, int count)
+{
+    entries.insert(line_idx, {}, count);
+
+    scan = std::min(scan, line_idx);
+}
+
+void WrapIndex::Remove(int line_idx, int count)
+{
+    entries.remove(line_idx, count);
+
+    if (scan > line_idx) scan = std::max(line_idx, scan - count);
+}
+
+void WrapIndex::Invalidate(int line_idx, int x)
+{
+    Entry & entry = entries[line_idx];
+
+    // The break ending a row is only decided by characters in the row after it
+    int row = std::upper_bound(entry.starts.begin(), entry.starts.end(), x) - entry.starts.begin();
+
+    entry.trusted = std::min(entry.trusted, std::max(0, row - 1));
+    entry.valid = false;
+
+    scan = std::min(scan, line_idx);
+}
+
+void WrapIndex::InvalidateAll()
+{
+    for (Entry & entry : entries)
+    {
+        entry.trusted = 0;
+        entry.valid = false;
+    }
+
+    scan = 0;
+}
+
+int WrapIndex::Width() const
+{
+    return width;
+}
+
+void WrapIndex::SetWidth(int columns)
+{
+    columns = std::max(1, columns);
+    if (columns == width) return;
+
+    width = columns;
+    InvalidateAll();
+}
+
+bool WrapIndex::IsValid(int line_idx) const
+{
+    return entries[line_idx].valid;
+}
+
+int WrapIndex::Wrap(int line_idx, StringView32 line)
+{
+    Entry & entry = entries[line_idx];
+
+    if (!entry.valid)
+    {
+        entry.starts.resize(entry.trusted);
+        entry.columns.resize(entry.trusted);
+
+        int row_start  = entry.trusted == 0 ? 0 : entry.starts.back();
+        int row_column = entry.trusted == 0 ? 0 : entry.columns.back();
+
+        int column = row_column;
+
+        // Rows break after the last space that fits, or mid word if there is none
+        int break_idx = -1;
+        int break_column = 0;
+
+        for (int idx = row_start; idx < line.size(); idx++)
+        {
+            char32_t ch = line[idx];
+
+            int w = ch == U'\t' ? TabWidth(column) : 1;
+
+            while (idx > row_start && column + w - row_column > width)
+            {
+                if (break_idx > row_start)
+                {
+                    row_start  = break_idx;
+                    row_column = break_column;
+                }
+                else
+                {
+                    row_start  = idx;
+                    row_column = column;
+                }
+
+                entry.starts.push_back(row_start);
+                entry.columns.push_back(row_column);
+
+                break_idx = -1;
+            }
+
+            column += w;
+
+            if (IsSpace(ch))
+            {
+                break_idx = idx + 1;
+                break_column = column;
+            }
+        }
+
+        entry.trusted = entry.starts.size();
+        entry.valid = true;
+    }
+
+    return entry.starts.size() + 1;
+}
+
+int WrapIndex::NextPending()
+{
+    while (scan < entries.size() && entries[scan].valid) scan++;
+
+    return scan < entries.size() ? scan : -1;
+}
+
+int WrapIndex::Rows(int line_idx) const
+{
+    return entries[line_idx].starts.size() + 1;
+}
+
+int WrapIndex::RowStart(int line_idx, int row) const
+{
+    return row == 0 ? 0 : entries[line_idx].starts[row - 1];
+}
+
+int WrapIndex::RowColumn(int line_idx, int row) const
+{
+    return row == 0 ? 0 : entries[line_idx].columns[row - 1];
+}
+
+int WrapIndex::RowAt(int line_idx, int x) const
+{
+    Vector<int> const& starts = entries[line_idx].starts;
+    return std::upper_bound(starts.begin(), starts.end(), x) - starts.begin();
+}
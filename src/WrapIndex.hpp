@@ -0,0 +1,61 @@
+#ifndef WRAPINDEX_HPP
+#define WRAPINDEX_HPP
+
+#include "Vector.hpp"
+#include "StringView32.hpp"
+
+// Where every line is split into display rows for the current wrap width
+class WrapIndex
+{
+private:
+    struct Entry
+    {
+        // Index and tab adjusted column of the first character of every row after the first
+        Vector<int> starts;
+        Vector<int> columns;
+
+        // How many of the starts are still correct, the rest are kept as an estimate until the line is wrapped
+        int trusted = 0;
+        bool valid = false;
+    };
+
+    Vector<Entry> entries;
+
+    int width = 80;
+
+    // Lines before this one are all wrapped
+    int scan = 0;
+
+public:
+    WrapIndex() = default;
+
+    void Reset(int line_count);
+
+    void Insert(int line_idx, int count);
+    void Remove(int line_idx, int count);
+
+    // Characters before x are unchanged, so are the rows ending before the one containing it
+    void Invalidate(int line_idx, int x = 0);
+    void InvalidateAll();
+
+    int Width() const;
+    void SetWidth(int columns);
+
+    bool IsValid(int line_idx) const;
+
+    // Returns the new row count of the line
+    int Wrap(int line_idx, StringView32 line);
+
+    // The first line that still has to be wrapped, or -1
+    int NextPending();
+
+    int Rows(int line_idx) const;
+
+    int RowStart(int line_idx, int row) const;
+    int RowColumn(int line_idx, int row) const;
+
+    // A position on a row boundary belongs to the row it starts
+    int RowAt(int line_idx, int x) const;
+};
+
+#endif // WRAPINDEX_HPP
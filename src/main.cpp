@@ -2,12 +2,14 @@
 
 #include "Clipboard.hpp"
 #include "Editor.hpp"
+#include "NativeDatabase.hpp"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
     Clipboard::Instance();
+    NativeDatabase::Instance().Load(QApplication::applicationDirPath() + "/scripts");
     Editor w;
     w.show();
 